@@ -59,6 +59,7 @@ set(header_rpcore
     "${PROJECT_SOURCE_DIR}/render_pipeline/rpcore/render_pipeline.hpp"
     "${PROJECT_SOURCE_DIR}/render_pipeline/rpcore/render_stage.hpp"
     "${PROJECT_SOURCE_DIR}/render_pipeline/rpcore/render_target.hpp"
+    "${PROJECT_SOURCE_DIR}/render_pipeline/rpcore/resource_registry.hpp"
     "${PROJECT_SOURCE_DIR}/render_pipeline/rpcore/rpobject.hpp"
     "${PROJECT_SOURCE_DIR}/render_pipeline/rpcore/stage_manager.hpp"
 )
@@ -128,6 +129,7 @@ set(header_rpcore_stages
 
 set(header_rpcore_util
     "${PROJECT_SOURCE_DIR}/render_pipeline/rpcore/util/basic_effects.hpp"
+    "${PROJECT_SOURCE_DIR}/render_pipeline/rpcore/util/camera_matrices.hpp"
     "${PROJECT_SOURCE_DIR}/render_pipeline/rpcore/util/cubemap_filter.hpp"
     "${PROJECT_SOURCE_DIR}/render_pipeline/rpcore/util/generic.hpp"
     "${PROJECT_SOURCE_DIR}/render_pipeline/rpcore/util/line_node.hpp"
@@ -136,6 +138,7 @@ set(header_rpcore_util
     "${PROJECT_SOURCE_DIR}/render_pipeline/rpcore/util/points_node.hpp"
     "${PROJECT_SOURCE_DIR}/render_pipeline/rpcore/util/post_process_region.hpp"
     "${PROJECT_SOURCE_DIR}/render_pipeline/rpcore/util/primitives.hpp"
+    "${PROJECT_SOURCE_DIR}/render_pipeline/rpcore/util/raw_texture_file.hpp"
     "${PROJECT_SOURCE_DIR}/render_pipeline/rpcore/util/rpgeomnode.hpp"
     "${PROJECT_SOURCE_DIR}/render_pipeline/rpcore/util/rpmaterial.hpp"
     "${PROJECT_SOURCE_DIR}/render_pipeline/rpcore/util/rprender_state.hpp"
@@ -253,6 +256,7 @@ set(source_rpcore
     "${PROJECT_SOURCE_DIR}/src/rpcore/render_pipeline.cpp"
     "${PROJECT_SOURCE_DIR}/src/rpcore/render_stage.cpp"
     "${PROJECT_SOURCE_DIR}/src/rpcore/render_target.cpp"
+    "${PROJECT_SOURCE_DIR}/src/rpcore/resource_registry.cpp"
     "${PROJECT_SOURCE_DIR}/src/rpcore/rpobject.cpp"
     "${PROJECT_SOURCE_DIR}/src/rpcore/stage_manager.cpp"
 )
@@ -329,6 +333,7 @@ set(source_rpcore_stages
 
 set(source_rpcore_util
     "${PROJECT_SOURCE_DIR}/src/rpcore/util/basic_effects.cpp"
+    "${PROJECT_SOURCE_DIR}/src/rpcore/util/camera_matrices.cpp"
     "${PROJECT_SOURCE_DIR}/src/rpcore/util/cubemap_filter.cpp"
     "${PROJECT_SOURCE_DIR}/src/rpcore/util/display_shader_builder.cpp"
     "${PROJECT_SOURCE_DIR}/src/rpcore/util/display_shader_builder.hpp"
@@ -341,6 +346,7 @@ set(source_rpcore_util
     "${PROJECT_SOURCE_DIR}/src/rpcore/util/points_node.cpp"
     "${PROJECT_SOURCE_DIR}/src/rpcore/util/post_process_region.cpp"
     "${PROJECT_SOURCE_DIR}/src/rpcore/util/primitives.cpp"
+    "${PROJECT_SOURCE_DIR}/src/rpcore/util/raw_texture_file.cpp"
     "${PROJECT_SOURCE_DIR}/src/rpcore/util/rpgeomnode.cpp"
     "${PROJECT_SOURCE_DIR}/src/rpcore/util/rprender_state.cpp"
     "${PROJECT_SOURCE_DIR}/src/rpcore/util/shader_input_blocks.cpp"
@@ -52,6 +52,7 @@ public:
     static TextFont* font;
     static LVecBase2i resolution;               //!< rendering resolution (can be scaled)
     static LVecBase2i native_resolution;        //!< screen resolution
+    static bool headless;                       //!< pipeline runs without GPU rendering (see pipeline.headless)
 };
 
 }
@@ -27,7 +27,7 @@
 #include <unordered_map>
 #include <utility>
 
-#include <render_pipeline/rpcore/config.hpp>
+#include <render_pipeline/rpcore/resource_registry.hpp>
 
 namespace rpcore {
 
@@ -44,8 +44,9 @@ public:
 
     static const std::unordered_map<std::string, ComponentFormatType> FORMAT_MAPPING;
 
-    // All registered images
-    static std::vector<Image*> REGISTERED_IMAGES;
+    /** All registered images. Deprecated, use ResourceRegistry instead. */
+    [[deprecated("Use ResourceRegistry::get_entries() instead.")]]
+    static const ResourceRegistry::ImageView REGISTERED_IMAGES;
 
     /** Creates a new buffer texture. */
     static std::unique_ptr<Image> create_buffer(const std::string& name, int size, const std::string& component_format);
@@ -71,8 +72,11 @@ public:
     static const ComponentFormatType& convert_texture_format(const std::string& comp_type);
 
     Image(const std::string& name);
+    Image(const Image&) = delete;
     ~Image();
 
+    Image& operator=(const Image&) = delete;
+
     void setup_buffer(int size, const std::string& component_format);
     void setup_counter();
     void setup_2d(int w, int h, const std::string& component_format);
@@ -102,6 +106,7 @@ public:
 private:
     int sort_;
     PT(Texture) texture_;
+    ResourceRegistry::Handle registry_handle_;
 };
 
 // ************************************************************************************************
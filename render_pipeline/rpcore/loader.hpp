@@ -25,12 +25,16 @@
 #include <shader.h>
 #include <nodePath.h>
 
+#include <memory>
+
 #include <render_pipeline/rpcore/rpobject.hpp>
 
 class TextFont;
 
 namespace rpcore {
 
+class TextureStreamer;
+
 /**
  * Generic loader class used by the pipeline. All loading of assets happens
  * here, which enables us to keep track of used resources.
@@ -38,15 +42,72 @@ namespace rpcore {
 class RENDER_PIPELINE_DECL RPLoader : public RPObject
 {
 public:
+    /**
+     * Handle of a texture which is loaded by load_texture_async.
+     *
+     * The texture is a placeholder until the file is loaded. Then, the mipmap
+     * tail is uploaded first and higher mipmap levels are streamed in over the
+     * next frames within the upload budget.
+     */
+    class RENDER_PIPELINE_DECL AsyncTexture
+    {
+    public:
+        class Impl;
+
+        AsyncTexture(std::unique_ptr<Impl> impl);
+        ~AsyncTexture();
+
+        Texture* get_texture() const;
+
+        /** Return true if all mipmap levels are resident or the loading failed. */
+        bool is_done() const;
+
+        /** Return the finest mipmap level in the texture, or -1 if nothing is loaded. */
+        int get_resident_level() const;
+
+        float get_priority() const;
+
+        /**
+         * Set the priority, for example, screen size of objects using the texture.
+         * Textures with higher priority are loaded and streamed in earlier.
+         */
+        void set_priority(float priority);
+
+        /** Stop loading and streaming. The texture keeps the resident levels. */
+        void cancel();
+
+    private:
+        friend class TextureStreamer;
+
+        std::unique_ptr<Impl> impl_;
+    };
+
     /** Loads a 2D-texture from disk. */
     static Texture* load_texture(const Filename& filename);
 
+    /**
+     * Loads a 2D-texture from disk in a loader thread.
+     *
+     * @param   priority    initial priority. @see AsyncTexture::set_priority
+     */
+    static std::shared_ptr<AsyncTexture> load_texture_async(const Filename& filename, float priority=0.0f);
+
+    /** Set the maximum bytes of texture images which are streamed in per frame. */
+    static void set_texture_upload_budget(size_t bytes_per_frame);
+    static size_t get_texture_upload_budget();
+
     /** Loads a cube map from disk. */
     static Texture* load_cube_map(const Filename& filename, bool read_mipmaps=false);
 
     /** Loads a 3D-texture from disk. */
     static Texture* load_3d_texture(const Filename& filename);
 
+    /**
+     * Loads a texture from a raw texture container (.rptex) on disk.
+     * @see RawTextureFile
+     */
+    static PT(Texture) load_raw_texture(const Filename& filename);
+
     /** Loads a font from disk. */
     static TextFont* load_font(const Filename& filename);
 
@@ -62,11 +123,16 @@ public:
     /**
      * Loads a texture from the given filename and dimensions. If only
      * one dimensions is specified, the other dimensions are assumed to be
-     * equal. This internally loads the texture into ram, splits it into smaller
-     * sub-images, and then calls the load_3d_texture from the Panda loader
+     * equal. This internally loads the texture into ram and copies the tiles
+     * directly into the pages of a new 3D texture, which is kept in the TexturePool.
+     *
+     * @return  The 3D texture, or nullptr if the texture could not be loaded.
      */
     static Texture* load_sliced_3d_texture(const Filename& filename, int tile_size_x, int tile_size_y, int num_tiles);
 
+    /** Creates a 3D-texture from tiles in the RAM image of the given 2D-texture. */
+    static PT(Texture) create_sliced_3d_texture(Texture* source, int tile_size_x, int tile_size_y, int num_tiles);
+
     RPLoader();
 };
 
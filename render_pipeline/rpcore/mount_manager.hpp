@@ -22,6 +22,7 @@
 
 #pragma once
 
+#include <chrono>
 #include <memory>
 
 #include <render_pipeline/rpcore/rpobject.hpp>
@@ -84,8 +85,47 @@ public:
     bool get_do_cleanup() const;
     void set_do_cleanup(bool cleanup);
 
+    /**
+     * Acquires the lock of an instance directory in the write path.
+     *
+     * Each process uses its own "instance-<N>" directory in the write path
+     * and the directory is locked by an OS file lock on "instance.lock" file.
+     * The lock is released by the OS when the process exits, even if it crashed.
+     *
+     * @return  true if the lock is acquired or if no write path is used.
+     */
     bool get_lock();
 
+    /** Returns the directory of this process in the write path. Empty if ramdisk is used. */
+    const Filename& get_instance_path() const;
+
+    /**
+     * Sets the limits of the shared cache directory ("cache" in the write path).
+     * Files older than @p max_age are removed when mounting, and the oldest files are
+     * removed until the total size is less than @p max_size. Files used after the
+     * start of a running instance are never removed.
+     */
+    void set_cache_limits(size_t max_size, std::chrono::hours max_age);
+
+    /**
+     * Writes @p content to @p path, unless the file already has the same content.
+     *
+     * The content is written to a temporary file and then renamed to @p path,
+     * so other readers do not see partially written file.
+     *
+     * @return  false if writing is failed.
+     */
+    static bool write_temp_file(const Filename& path, const std::string& content);
+
+    /**
+     * Stores @p content in the shared cache (/$$rptemp/cache) with content-addressed name,
+     * "$$<prefix>-<hash><extension>". If the file exists already, it is reused
+     * and its modification time is updated.
+     *
+     * @return  Path of the file, or empty path if writing is failed.
+     */
+    static Filename store_cache_file(const std::string& prefix, const std::string& content, const std::string& extension);
+
     /** Returns whether the MountManager was already mounted by calling mount(). */
     bool is_mounted() const;
 
@@ -99,9 +139,10 @@ public:
      * /$rpconfig/ (Mounted from config/, may be set by user)
      * + pipeline.yaml
      * + ...
-     * /$$rptemp/ (Either ramdisk or user specified)
+     * /$$rptemp/ (Either ramdisk or instance directory in user specified path)
      * + day_time_config
      * + shader_auto_config
+     * + cache/ (Content-addressed files shared by instances)
      * + ...
      * /$$rpshader/ (Link to /$$rp/rpcore/shader)
      */
@@ -30,24 +30,28 @@
 #include "pandabase.h"
 #include "luse.h"
 
+#include <render_pipeline/rpcore/config.hpp>
+
 NotifyCategoryDecl(gpucommand, EXPORT_CLASS, EXPORT_TEMPL);
 
 namespace rpcore {
 
+// Maximum amount of 32-bit words of a single command, including the header
 #define GPU_COMMAND_ENTRIES 32
 
-// Packs integers by storing their binary representation in floats
-// This only works if the command and light buffer is 32bit floating point.
-#define PACK_INT_AS_FLOAT 0
-
-
 /**
  * @brief Class for storing data to be transferred to the GPU.
  * @details This class can be seen like a packet, to be transferred to the GPU.
  *   It has a command type, which tells the GPU what to do once it recieved this
- *   "packet". It stores a limited amount of floating point components.
+ *   "packet". It stores a limited amount of 32-bit words.
+ *
+ *   The first word is a header, storing the command type in the lower 16 bits
+ *   and the size of the command in words (including the header) in the upper
+ *   16 bits. Integers and floats are stored with their binary representation.
+ *   In half precision mode, floats and integers are converted to 16-bit
+ *   floats, and two of them are packed into a single word.
  */
-class GPUCommand
+class RENDER_PIPELINE_DECL GPUCommand
 {
     PUBLISHED:
         /**
@@ -76,17 +80,22 @@ class GPUCommand
         inline void push_mat3(const LMatrix3f &v);
         inline void push_mat4(const LMatrix4f &v);
 
-        inline static bool get_uses_integer_packing();
+        inline void set_half_precision(bool half_precision);
+        inline size_t get_size() const;
 
-        void write_to(const PTA_uchar &dest, size_t command_index);
+        size_t write_to(const PTA_uchar &dest, size_t offset) const;
         void write(std::ostream &out) const;
 
     private:
-        inline float convert_int_to_float(int v) const;
+        inline void push_word(uint32_t v);
+        inline void push_half(float v);
+        inline static uint16_t float_to_half(float v);
 
         CommandType _command_type;
         size_t _current_index;
-        float _data[GPU_COMMAND_ENTRIES];
+        bool _half_precision;
+        bool _half_pending;
+        uint32_t _data[GPU_COMMAND_ENTRIES];
 };
 
 }
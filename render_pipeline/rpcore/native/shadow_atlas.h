@@ -30,6 +30,8 @@
 #include "pandabase.h"
 #include "lvecBase4.h"
 
+#include <render_pipeline/rpcore/config.hpp>
+
 NotifyCategoryDecl(shadowatlas, EXPORT_CLASS, EXPORT_TEMPL);
 
 namespace rpcore {
@@ -39,7 +41,7 @@ namespace rpcore {
  * @details This class manages the shadow atlas. It handles finding and reserving
  *   space for new shadow maps.
  */
-class ShadowAtlas
+class RENDER_PIPELINE_DECL ShadowAtlas
 {
 PUBLISHED:
     ShadowAtlas(size_t size, size_t tile_size = 32);
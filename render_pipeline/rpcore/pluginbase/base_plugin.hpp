@@ -26,6 +26,7 @@
 
 #include <vector>
 #include <unordered_map>
+#include <unordered_set>
 #include <functional>
 
 #include <boost/dll/shared_library_load_mode.hpp>
@@ -116,6 +117,9 @@ public:
 
     void add_stage(std::unique_ptr<RenderStage> stage);
 
+    /** Returns the stages added by the plugin. */
+    std::vector<RenderStage*> get_stages() const;
+
     template <class T>
     auto get_setting(const std::string& setting_id, const std::string& plugin_id = "") const;
 
@@ -160,6 +164,14 @@ public:
     virtual void on_unload() {}
     ///@}
 
+    /**
+     * Applies changed settings, which are not runtime settings, to the stages
+     * of the plugin before the stages are created again by StageManager::rebuild_stages.
+     *
+     * @return  false if the settings cannot be applied without restarting the pipeline.
+     */
+    virtual bool on_stage_rebuild(const std::unordered_set<std::string>& changed_settings) { return false; }
+
     void on_setting_changed(const std::string& setting_id);
 
 protected:
@@ -57,6 +57,21 @@ public:
      */
     void set_time(const std::string& time);
 
+    /**
+     * Pauses or resumes the day time. While paused, changes of the time are
+     * not applied to the shader inputs, but edited settings still are.
+     */
+    void set_paused(bool paused);
+
+    /** Returns whether the day time is paused. */
+    bool is_paused() const;
+
+    /**
+     * Returns the number of updates which were skipped, because neither the
+     * time nor any setting changed.
+     */
+    size_t get_skipped_updates() const;
+
     /** Returns the current time as formatted string, e.g. 12:34. */
     std::string get_formatted_time() const;
 
@@ -40,11 +40,18 @@ namespace rpcore {
 class SmoothConnectedCurve;
 
 /** DayBase setting type for all setting types. */
-class DayBaseType : public RPObject
+class RENDER_PIPELINE_DECL DayBaseType : public RPObject
 {
 public:
     using ValueType = std::pair<LVecBase3, int>;
 
+    /**
+     * Amount of intervals of the baked lookup table. The table stores one
+     * more sample, so that the end of the day can be interpolated without
+     * wrapping around.
+     */
+    static constexpr int LUT_RESOLUTION = 1024;
+
 public:
     DayBaseType(YAML::Node& data, const std::string& id="DayBaseType");
     virtual ~DayBaseType();
@@ -73,12 +80,43 @@ public:
     /** Serializes the setting to a yaml string. */
     std::string serialize() const;
 
+    /** Returns whether the curves still have the default control points. */
+    bool is_default() const;
+
+    /** Returns the amount of components of the value, 1 or 3. */
+    int get_num_components() const { return _curves[1] == nullptr ? 1 : 3; }
+
+    /**
+     * Returns the lookup table of the shader input values, which stores
+     * LUT_RESOLUTION + 1 samples of get_num_components() floats each.
+     * The table is baked on first use after the curves changed, so settings
+     * of disabled plugins are never baked.
+     */
+    const std::vector<float>& get_lut() const;
+
+    /**
+     * Returns a counter which is incremented whenever the curves of any
+     * setting change. This can be used to detect edited settings.
+     */
+    static size_t get_lut_generation();
+
 protected:
+    /** Remembers the current control points as defaults, see is_default(). */
+    void store_default_control_points();
+
+    /** Marks the lookup table to be baked again on next use. */
+    void invalidate_lut();
+
     std::string _type;
     std::string _label;
     std::string _description;
 
     std::array<SmoothConnectedCurve*, 3> _curves;
+
+private:
+    std::vector<std::vector<LVecBase2>> _default_control_points;
+    mutable std::vector<float> _lut;
+    mutable bool _lut_dirty = true;
 };
 
 /** Setting type storing a single scalar. */
@@ -53,6 +53,22 @@ public:
 
     typedef std::unique_ptr<BasePlugin> (PluginCreatorType)(RenderPipeline&);
 
+    /** Result of reload_setting_overrides(). */
+    struct SettingsReloadResult
+    {
+        /** Settings whose value changed, for each plugin. */
+        std::unordered_map<PluginIDType, std::unordered_set<std::string>> changed_settings;
+
+        /** IDs of the stages which were created again for changed settings, which are not runtime settings. */
+        std::vector<std::string> rebuilt_stages;
+
+        /** IDs of the stages whose shaders were reloaded. The rebuilt stages are not included. */
+        std::vector<std::string> reloaded_stages;
+
+        /** Whether some changes, like the enabled plugins or non-runtime settings, require to restart the pipeline. */
+        bool requires_restart = false;
+    };
+
 public:
     /** Release handle of loaded DLLs. */
     static void release_all_dll();
@@ -68,6 +84,10 @@ public:
     /**
      * Loads all plugins and their settings, and also constructs instances
      * of the main plugin classes for all enabled plugins.
+     *
+     * The configurations are parsed and the shared libraries are imported on
+     * worker threads. The plugin hooks are called in dependency order, so that
+     * required plugins are called first (and unloaded last).
      */
     void load();
 
@@ -101,18 +121,43 @@ public:
      */
     void load_setting_overrides(const Filename& override_path);
 
+    /**
+     * Loads the override file again, and applies only the settings which differ
+     * from the current values, without reloading the pipeline. Settings which
+     * are not in the file are reset to their defaults.
+     *
+     * The changed settings are passed to the plugins, and only the shaders of
+     * the stages which use changed defines are reloaded, as well as the effects.
+     * For settings which are not runtime settings, the stages of the plugin are
+     * created again if the plugin supports it in BasePlugin::on_stage_rebuild.
+     * Changes of the enabled plugins and of the other settings are not fully
+     * applied, see SettingsReloadResult::requires_restart.
+     */
+    SettingsReloadResult reload_setting_overrides(const Filename& override_path);
+
     /**
      * Loads an override file for the daytime settings, which contains
      * values to override the settings with.
      */
     void load_daytime_overrides(const Filename& override_path);
 
-    /** Saves all overrides to the given file. */
+    /**
+     * Saves all overrides to the given file. Only the settings which differ
+     * from the plugin defaults are stored. The file is written on a worker
+     * thread, see wait_for_saves().
+     */
     void save_overrides(const Filename& override_path);
 
-    /** Saves all time of day overrides to the given file. */
+    /**
+     * Saves all time of day overrides to the given file. Only the settings
+     * which differ from the plugin defaults are stored. The file is written
+     * on a worker thread, see wait_for_saves().
+     */
     void save_daytime_overrides(const Filename& override_path);
 
+    /** Waits until the pending writes of saved overrides are finished. */
+    void wait_for_saves();
+
     /**
      * Sets whether a plugin is enabled or not, thus should be loaded when
      * the pipeline starts or not.
@@ -41,6 +41,9 @@ public:
 
     virtual std::string get_value_as_string() const = 0;
 
+    /** Returns whether the value equals the default value of the plugin. */
+    virtual bool is_default() const = 0;
+
     virtual void reset_to_default() = 0;
 
     virtual void set_value(const YAML::Node& value) = 0;
@@ -86,6 +89,8 @@ public:
     ValueType get_value() const;
     ValueType get_default() const;
 
+    bool is_default() const final;
+
     void reset_to_default() final;
 
 protected:
@@ -110,6 +115,12 @@ auto BaseTypeContainer<T>::get_default() const -> ValueType
     return default_;
 }
 
+template <class T>
+bool BaseTypeContainer<T>::is_default() const
+{
+    return value_ == default_;
+}
+
 template <class T>
 void BaseTypeContainer<T>::reset_to_default()
 {
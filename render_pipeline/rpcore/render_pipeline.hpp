@@ -22,6 +22,8 @@
 
 #pragma once
 
+#include <vector>
+
 #include <render_pipeline/rpcore/effect.hpp>
 #include <render_pipeline/rpcore/rpobject.hpp>
 
@@ -67,6 +69,42 @@ public:
 
     static constexpr const char* reload_shaders_event_name = "RP_reload_shaders";
 
+    /** Statistics of RenderState and TransformState cache in the last frame. */
+    struct StateCacheStats
+    {
+        int render_states = 0;
+        int transform_states = 0;
+
+        /** The number of states freed by the pipeline in the last frame. */
+        int purged_states = 0;
+
+        /** Time to purge the states in the last frame in milliseconds. */
+        double purge_time = 0;
+
+        /** The total number of full cache clears. */
+        size_t clear_count = 0;
+    };
+
+    /** Timings of the frames run by run_frames(). Times are in milliseconds. */
+    struct FrameTimings
+    {
+        struct TaskTiming
+        {
+            std::string name;
+            double average_time = 0;
+            double max_time = 0;
+        };
+
+        int frame_count = 0;
+        double total_time = 0;
+        double average_frame_time = 0;
+        double min_frame_time = 0;
+        double max_frame_time = 0;
+
+        /** Times of the tasks in the task manager, sorted by the average time. */
+        std::vector<TaskTiming> task_timings;
+    };
+
 public:
     static boost::string_view get_version();
     static bool get_version(int& major, int& minor, int& patch);
@@ -87,6 +125,16 @@ public:
     /** Call ShowBase::Run() */
     void run();
 
+    /**
+     * Runs the task manager for @p num_frames frames and returns the timings.
+     * This is mainly used to test or benchmark the CPU side in headless mode,
+     * and the stage timings are available in StageManager::get_stage_timings().
+     */
+    FrameTimings run_frames(int num_frames);
+
+    /** Returns whether the pipeline runs in headless mode (pipeline.headless setting). */
+    bool is_headless() const;
+
     /**
      * Loads the pipeline configuration from a given filename. Usually
      * this is the 'config/pipeline.ini' file. If you call this more than once,
@@ -105,6 +153,13 @@ public:
      */
     void reload_shaders();
 
+    /**
+     * Regenerates the shaders of all applied effects including the default
+     * effect, so that they use the current shader configuration. Unlike
+     * reload_shaders(), the shaders of the stages are kept.
+     */
+    void reload_effects();
+
     /**
      * Setups all required pipeline settings and configuration which have
      * to be set before the showbase is setup. This is called by create(),
@@ -199,6 +254,8 @@ public:
     bool is_stereo_mode() const;
     StereoMode get_stereo_mode() const;
 
+    const StateCacheStats& get_state_cache_stats() const;
+
     /** Get setting value iun pipeline setting. */
     ///@{
     /** Get YAML node from given flatten path in pipeline setting. */
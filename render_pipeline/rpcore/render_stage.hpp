@@ -96,6 +96,15 @@ public:
      */
     virtual void set_shader_input(const ShaderInput& inp);
 
+    /**
+     * Collects the inputs of RenderStage::set_shader_input until commit_shader_inputs()
+     * instead of setting each input on the targets.
+     */
+    void defer_shader_inputs();
+
+    /** Sets the collected inputs on all targets at once. */
+    void commit_shader_inputs();
+
     bool get_active() const;
     void set_active(bool state);
 
@@ -103,8 +112,12 @@ public:
 
     /**
      * Create target and store it to RenderStage::targets.
+     *
+     * @param   transient   If true, the textures of the target are only read by
+     *                      targets of this stage, so they may be shared with
+     *                      transient targets of other stages. @see RenderTarget::set_transient
      */
-    RenderTarget* create_target(boost::string_view name);
+    RenderTarget* create_target(boost::string_view name, bool transient=false);
 
     /**
      * Removes a previously registered target. This unregisters the
@@ -112,6 +125,14 @@ public:
      */
     void remove_target(RenderTarget* target);
 
+    /**
+     * Removes all targets, so that the stage can be created again.
+     *
+     * The inputs set by RenderStage::set_shader_input are kept, and they are set
+     * on the new targets in commit_shader_inputs(). The stage becomes active.
+     */
+    void remove_all_targets();
+
     PT(Shader) load_shader(const std::vector<Filename>& args, bool stereo_post=false, bool use_post_gs=false) const;
 
     /**
@@ -121,6 +142,9 @@ public:
      */
     PT(Shader) load_plugin_shader(const std::vector<Filename>& args, bool stereo_post=false, bool use_post_gs=false) const;
 
+    /** Returns the shader files which were loaded with load_shader or load_plugin_shader. */
+    const std::vector<Filename>& get_shader_files() const;
+
     /**
      * Prepares the two textures required for processing invalid pixels
      * after executing the upscale pass.
@@ -130,11 +154,11 @@ public:
     void handle_window_resize();
     virtual void set_dimensions() {}
 
-protected:
     const std::unordered_map<std::string, std::unique_ptr<RenderTarget>>& get_targets() const;
 
     virtual std::string get_plugin_id() const = 0;
 
+protected:
     PT(Shader) get_shader_handle(const Filename& path, const std::vector<Filename>& args, bool stereo_post = false, bool use_post_gs = false) const;
 
     RenderPipeline& pipeline_;
@@ -144,6 +168,13 @@ private:
     std::unordered_map<std::string, std::unique_ptr<RenderTarget>> targets_;
     const std::string stage_id_;
     bool active_ = true;
+
+    bool defer_inputs_ = false;
+    std::vector<ShaderInput> deferred_inputs_;
+
+    /** Inputs set on the stage, which are set again after remove_all_targets(). */
+    std::unordered_map<const InternalName*, ShaderInput> shader_inputs_;
+    mutable std::vector<Filename> shader_files_;
 };
 
 // ************************************************************************************************
@@ -153,11 +184,21 @@ inline const std::string& RenderStage::get_stage_id() const
     return stage_id_;
 }
 
+inline const std::vector<Filename>& RenderStage::get_shader_files() const
+{
+    return shader_files_;
+}
+
 inline bool RenderStage::get_active() const
 {
     return active_;
 }
 
+inline void RenderStage::defer_shader_inputs()
+{
+    defer_inputs_ = true;
+}
+
 inline bool RenderStage::get_disabled() const
 {
     return disabled_;
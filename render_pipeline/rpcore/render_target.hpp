@@ -31,6 +31,7 @@
 #include <boost/optional.hpp>
 
 #include <render_pipeline/rpcore/rpobject.hpp>
+#include <render_pipeline/rpcore/resource_registry.hpp>
 
 class ShaderInput;
 class GraphicsBuffer;
@@ -43,8 +44,28 @@ class PostProcessRegion;
 class RENDER_PIPELINE_DECL RenderTarget : public RPObject
 {
 public:
+    /** Memory statistics of textures of transient targets. */
+    struct PoolStats
+    {
+        size_t num_targets = 0;
+        size_t num_allocations = 0;
+
+        /** Bytes which would be used without sharing. */
+        size_t requested_bytes = 0;
+
+        /** Bytes of textures allocated by the pool. */
+        size_t allocated_bytes = 0;
+
+        /** Maximum bytes of transient targets alive at the same sort, from their sort to their last reader. */
+        size_t peak_bytes = 0;
+    };
+
     static bool USE_R11G11B10;
-    static std::vector<RenderTarget*> REGISTERED_TARGETS;
+
+    /** All registered render targets. Deprecated, use ResourceRegistry instead. */
+    [[deprecated("Use ResourceRegistry::get_entries() instead.")]]
+    static const ResourceRegistry::RenderTargetView REGISTERED_TARGETS;
+
     static int CURRENT_SORT;
 
     RenderTarget(boost::string_view name);
@@ -105,6 +126,62 @@ public:
     /** @overload set_size(const LVecBase2i&) */
     void set_size(int width, int height) noexcept;
 
+    /**
+     * Mark this target as transient in the given group (usually, a stage).
+     *
+     * The textures of transient target must be read only by targets in the same
+     * group during a frame. Then, they are shared with transient targets of other
+     * groups, which have same attachments and size, because the groups are
+     * rendered one after another.
+     * In the same group, textures are shared by alias_transient_targets().
+     * This should be called before the buffer is created.
+     */
+    void set_transient(const std::string& group);
+
+    bool is_transient() const;
+
+    /**
+     * Estimate bytes of the textures from the attachments and the size.
+     * This does not need a graphics context, so it also works in headless mode.
+     */
+    size_t get_estimated_bytes() const;
+
+    /** Estimate bytes of each attachment. The keys are same as get_targets(). */
+    std::unordered_map<std::string, size_t> get_estimated_attachment_bytes() const;
+
+    /**
+     * Get the index of the pool slot whose textures are used by this transient target.
+     * Targets with the same slot share the textures. Returns -1 if the target is not pooled.
+     */
+    int get_pool_slot() const;
+
+    /** Get memory statistics of transient targets. */
+    static PoolStats get_pool_stats();
+
+    /**
+     * Share textures between transient targets in @p targets (usually, a stage)
+     * which are not read at the same time.
+     *
+     * A target is alive from its sort to the sort of the last target reading its
+     * textures by shader inputs, so this should be called after the inputs are set.
+     * Texture properties set on a target which gets other textures are not kept.
+     */
+    static void alias_transient_targets(const std::vector<RenderTarget*>& targets);
+
+    /**
+     * Set the group (usually, a stage) for sharing buffer.
+     *
+     * Targets without attachments, which are created one after another in the
+     * same group, render as display regions of one buffer instead of their own
+     * buffers. This should be called before the buffer is created.
+     */
+    void set_buffer_group(const std::string& group);
+
+    bool is_buffer_shared() const;
+
+    /** Get the number of active buffers of targets, which is the number of buffer switches per frame. */
+    static size_t get_num_active_buffers();
+
     /** Get current active. */
     bool get_active() const;
 
@@ -126,6 +203,9 @@ public:
     /** Sets a shader input available to the target. */
     void set_shader_input(const ShaderInput& inp, bool override_input=false);
 
+    /** Sets shader inputs available to the target at once. */
+    void set_shader_inputs(const std::vector<ShaderInput>& inputs, bool override_input=false);
+
     void set_shader(const Shader* sha);
 
     GraphicsBuffer* get_internal_buffer() const;
@@ -157,6 +237,8 @@ public:
     void consider_resize();
 
     const boost::optional<int>& get_sort() const noexcept;
+
+    /** Sets the sort of the buffer. This also applies to a buffer which is already created. */
     void set_sort(int sort) noexcept;
 
     bool get_support_transparency() const;
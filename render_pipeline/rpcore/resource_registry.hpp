@@ -0,0 +1,241 @@
+/**
+ * Render Pipeline C++
+ *
+ * Copyright (c) 2018 Center of Human-centered Interaction for Coexistence.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+ * and associated documentation files (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial
+ * portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT
+ * LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <filename.h>
+
+#include <iterator>
+#include <list>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <render_pipeline/rpcore/config.hpp>
+
+class Texture;
+
+namespace rpcore {
+
+class Image;
+class RenderTarget;
+
+/**
+ * Registry of Image and RenderTarget objects of the pipeline.
+ *
+ * The resources are registered in O(1) with the owner (stage or plugin) which
+ * is active when they are created. The registry also computes the texture
+ * memory of the resources, and it works without any GUI.
+ */
+class RENDER_PIPELINE_DECL ResourceRegistry
+{
+public:
+    enum class ResourceType: int
+    {
+        image = 0,
+        render_target,
+    };
+
+    struct Entry
+    {
+        ResourceType type;
+        void* resource;
+        std::string owner;
+
+        Image* get_image() const;
+        RenderTarget* get_render_target() const;
+
+        /** Get the name of the resource. */
+        std::string get_name() const;
+
+        /** Get the textures of the resource. */
+        std::vector<Texture*> get_textures() const;
+    };
+
+    using EntriesType = std::list<Entry>;
+    using Handle = EntriesType::iterator;
+
+    /**
+     * Owner of the resources which are registered while this object is alive.
+     * The scopes can be nested.
+     */
+    class RENDER_PIPELINE_DECL OwnerScope
+    {
+    public:
+        OwnerScope(const std::string& owner);
+        OwnerScope(const OwnerScope&) = delete;
+        ~OwnerScope();
+
+        OwnerScope& operator=(const OwnerScope&) = delete;
+
+    private:
+        std::string previous_owner_;
+    };
+
+    /** Range of the registered resources of one type, for example, to iterate only images. */
+    template <class T, ResourceType Type>
+    class View
+    {
+    public:
+        class const_iterator
+        {
+        public:
+            using iterator_category = std::forward_iterator_tag;
+            using value_type = T*;
+            using difference_type = std::ptrdiff_t;
+            using pointer = T* const*;
+            using reference = T*;
+
+            const_iterator(EntriesType::const_iterator it, EntriesType::const_iterator end);
+
+            T* operator*() const { return static_cast<T*>(it_->resource); }
+            const_iterator& operator++();
+            const_iterator operator++(int);
+            bool operator==(const const_iterator& other) const { return it_ == other.it_; }
+            bool operator!=(const const_iterator& other) const { return it_ != other.it_; }
+
+        private:
+            void skip();
+
+            EntriesType::const_iterator it_;
+            EntriesType::const_iterator end_;
+        };
+
+        const_iterator begin() const;
+        const_iterator end() const;
+
+        size_t size() const;
+        bool empty() const { return size() == 0; }
+    };
+
+    using ImageView = View<Image, ResourceType::image>;
+    using RenderTargetView = View<RenderTarget, ResourceType::render_target>;
+
+    static constexpr const char* default_owner = "render_pipeline";
+
+    static ResourceRegistry& get_global_instance();
+
+    /**
+     * Compute the bytes of texture memory from the format, the dimensions
+     * of all pages and views, and mipmap levels if the texture uses mipmaps.
+     */
+    static size_t compute_texture_bytes(const Texture* texture);
+
+    Handle register_image(Image* image);
+    Handle register_render_target(RenderTarget* target);
+    void unregister(Handle handle);
+
+    /** Get the entries in the registered order. */
+    const EntriesType& get_entries() const;
+
+    size_t get_num_images() const;
+    size_t get_num_render_targets() const;
+
+    /**
+     * Get the texture memory grouped by owners.
+     * A texture shared by several resources is counted once for the first owner.
+     */
+    std::map<std::string, size_t> get_owner_bytes() const;
+
+    size_t get_total_bytes() const;
+
+    /** Dump the resources and their memory as JSON. */
+    std::string dump_json() const;
+
+    bool write_json(const Filename& path) const;
+
+private:
+    ResourceRegistry() = default;
+
+    EntriesType entries_;
+    size_t num_images_ = 0;
+    size_t num_render_targets_ = 0;
+    std::string current_owner_ = default_owner;
+};
+
+// ************************************************************************************************
+
+inline const ResourceRegistry::EntriesType& ResourceRegistry::get_entries() const
+{
+    return entries_;
+}
+
+inline size_t ResourceRegistry::get_num_images() const
+{
+    return num_images_;
+}
+
+inline size_t ResourceRegistry::get_num_render_targets() const
+{
+    return num_render_targets_;
+}
+
+template <class T, ResourceRegistry::ResourceType Type>
+ResourceRegistry::View<T, Type>::const_iterator::const_iterator(EntriesType::const_iterator it, EntriesType::const_iterator end): it_(it), end_(end)
+{
+    skip();
+}
+
+template <class T, ResourceRegistry::ResourceType Type>
+auto ResourceRegistry::View<T, Type>::const_iterator::operator++() -> const_iterator&
+{
+    ++it_;
+    skip();
+    return *this;
+}
+
+template <class T, ResourceRegistry::ResourceType Type>
+auto ResourceRegistry::View<T, Type>::const_iterator::operator++(int) -> const_iterator
+{
+    const_iterator prev = *this;
+    ++(*this);
+    return prev;
+}
+
+template <class T, ResourceRegistry::ResourceType Type>
+void ResourceRegistry::View<T, Type>::const_iterator::skip()
+{
+    while (it_ != end_ && it_->type != Type)
+        ++it_;
+}
+
+template <class T, ResourceRegistry::ResourceType Type>
+auto ResourceRegistry::View<T, Type>::begin() const -> const_iterator
+{
+    const auto& entries = ResourceRegistry::get_global_instance().get_entries();
+    return const_iterator(entries.begin(), entries.end());
+}
+
+template <class T, ResourceRegistry::ResourceType Type>
+auto ResourceRegistry::View<T, Type>::end() const -> const_iterator
+{
+    const auto& entries = ResourceRegistry::get_global_instance().get_entries();
+    return const_iterator(entries.end(), entries.end());
+}
+
+template <class T, ResourceRegistry::ResourceType Type>
+size_t ResourceRegistry::View<T, Type>::size() const
+{
+    const auto& registry = ResourceRegistry::get_global_instance();
+    return Type == ResourceType::image ? registry.get_num_images() : registry.get_num_render_targets();
+}
+
+}
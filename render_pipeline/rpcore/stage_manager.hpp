@@ -24,11 +24,13 @@
 
 #include <vector>
 #include <unordered_map>
+#include <unordered_set>
 #include <memory>
 
 #include <render_pipeline/rpcore/rpobject.hpp>
 
 class ShaderInput;
+class Filename;
 
 namespace rpcore {
 
@@ -46,6 +48,19 @@ class RENDER_PIPELINE_DECL StageManager : public RPObject
 public:
     using DefinesType = std::unordered_map<std::string, std::string>;
 
+    /** CPU time of RenderStage::update measured in StageManager::update. */
+    struct StageTiming
+    {
+        std::string stage_id;
+        bool active = false;
+
+        /** Time of the last frame in milliseconds. */
+        double update_time = 0;
+
+        /** Exponential moving average of the time in milliseconds. */
+        double average_time = 0;
+    };
+
     /** Constructs the stage manager. */
     StageManager(RenderPipeline& pipeline);
 
@@ -70,19 +85,82 @@ public:
     void add_input_blocks(const std::shared_ptr<SimpleInputBlock>& input_block);
     void add_input_blocks(const std::shared_ptr<GroupedInputBlock>& input_block);
 
-    /** Setups the stages. */
+    /**
+     * Setups the stages.
+     *
+     * This creates the stages in the order of stages.yaml and builds the dependency
+     * graph of them. If 'cull_unused_stages' is enabled in stages.yaml, the stages
+     * whose outputs are used by nobody are disabled.
+     */
     void setup();
 
+    /**
+     * Creates the given stages again after setup(), for example when settings
+     * which are applied in RenderStage::create changed.
+     *
+     * The targets of the stages are removed and the stages are created again at
+     * their old position in the render order. Then the dependency graph is built
+     * again, and the pipes and inputs are bound again only to the rebuilt stages
+     * and the stages using their results. Targets of the other stages are kept.
+     * Finally, the shader configuration is written and the shaders of the
+     * rebuilt stages are loaded.
+     *
+     * @return  Rebuilt stages in the stage order.
+     */
+    std::vector<RenderStage*> rebuild_stages(const std::vector<RenderStage*>& stages);
+
+    /**
+     * Returns the dependency graph of the stages in Graphviz DOT format.
+     * Disabled stages by culling are drawn with dashed lines.
+     */
+    std::string dump_stage_graph() const;
+
+    /**
+     * Returns the resolved frame graph in JSON format.
+     *
+     * This contains the stages in execution order with their pipes, inputs,
+     * defines and render targets (formats, sizes and bytes), the previous
+     * frame pipes, the final defines and the frame cycles of the task scheduler.
+     * Bytes of targets are estimated from the attachments, so the graph is
+     * also valid in headless mode. Attachments of transient targets sharing a
+     * pool slot are counted once in the total bytes.
+     */
+    std::string dump_frame_graph() const;
+
+    /** Writes dump_frame_graph() to the file. Returns false on failure. */
+    bool write_frame_graph(const Filename& path) const;
+
     /**
      * This pass sets the shaders to all passes and also generates the shader configuration.
      */
     void reload_shaders();
 
+    /**
+     * Generates the shader configuration, and reloads only the shaders of the
+     * stages which use any of @p changed_defines in their shader files or
+     * includes. Stages without known shader files are always reloaded.
+     * Stages in @p skip_stages are not reloaded, e.g. stages which are just rebuilt.
+     *
+     * @return  Stages whose shaders were reloaded.
+     */
+    std::vector<RenderStage*> reload_shaders(const std::unordered_set<std::string>& changed_defines,
+        const std::unordered_set<RenderStage*>& skip_stages = {});
+
     /**
      * Calls the update method for each registered stage. Inactive stages are skipped.
+     *
+     * Each update is measured in the timings and in the PStats collector
+     * 'App:Show code:RP_UpdateStages:<stage id>'. The GPU time of each target
+     * is shown in 'Draw:<plugin id>:<stage id>:<target name>' of PStats
+     * when 'pstats-gpu-timing' is enabled.
+     *
+     * After the stages, all GroupedInputBlocks are flushed.
      */
     void update();
 
+    /** Get the timings of the stages in the order of get_stages(). */
+    const std::vector<StageTiming>& get_stage_timings() const;
+
     /**
      * Method to get called when the window got resized.
      * Propagates the resize event to all registered stages.
@@ -0,0 +1,119 @@
+/**
+ * Render Pipeline C++
+ *
+ * Copyright (c) 2014-2016 tobspr <tobias.springer1@gmail.com>
+ * Copyright (c) 2016-2017 Center of Human-centered Interaction for Coexistence.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+ * and associated documentation files (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial
+ * portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT
+ * LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <luse.h>
+
+#include <vector>
+
+#include <render_pipeline/rpcore/config.hpp>
+
+namespace rpcore {
+
+/**
+ * Derives the camera matrices of the main scene data from the view and
+ * projection matrix of each eye. Derived matrices are only recomputed when
+ * their inputs changed, and inverses use the structure of the matrices:
+ * the view matrix is affine, and the inverse of a view projection matrix
+ * is composed from the inverses of its factors.
+ */
+class RENDER_PIPELINE_DECL CameraMatrices
+{
+public:
+    /** Flags of the matrices which changed in update(). */
+    enum ChangedFlags: int
+    {
+        CF_none = 0,
+        CF_view = 1 << 0,
+        CF_projection = 1 << 1,
+        CF_last_view_projection = 1 << 2,
+    };
+
+    /** Matrices of one eye, or of the camera in mono mode. */
+    struct Eye
+    {
+        LMatrix4f view_mat = LMatrix4f::ident_mat();
+        LMatrix4f view_mat_inv = LMatrix4f::ident_mat();
+        LMatrix4f view_mat_z_up = LMatrix4f::ident_mat();
+        LMatrix4f view_mat_billboard = LMatrix4f::ident_mat();
+        LVecBase3f camera_pos = LVecBase3f(0);
+
+        LMatrix4f proj_mat = LMatrix4f::ident_mat();
+        LMatrix4f proj_mat_inv = LMatrix4f::ident_mat();
+        LMatrix4f proj_mat_z_up = LMatrix4f::ident_mat();
+        LMatrix4f inv_proj_mat_z_up = LMatrix4f::ident_mat();
+
+        LMatrix4f view_proj_mat = LMatrix4f::ident_mat();
+        LMatrix4f view_proj_mat_inv = LMatrix4f::ident_mat();
+
+        /** Projection without the film offset, which is used for jittering. */
+        LMatrix4f proj_mat_no_jitter = LMatrix4f::ident_mat();
+        LMatrix4f proj_mat_no_jitter_inv = LMatrix4f::ident_mat();
+        LMatrix4f view_proj_mat_no_jitter = LMatrix4f::ident_mat();
+        LMatrix4f inv_view_proj_mat_no_jitter = LMatrix4f::ident_mat();
+        LMatrix4f last_view_proj_mat_no_jitter = LMatrix4f::ident_mat();
+        LMatrix4f last_inv_view_proj_mat_no_jitter = LMatrix4f::ident_mat();
+
+        /** Frustum corner directions in the order BL, BR, TL, TR. */
+        LMatrix4f vs_frustum_directions = LMatrix4f::zeros_mat();
+        LMatrix4f ws_frustum_directions = LMatrix4f::zeros_mat();
+
+        bool valid = false;
+    };
+
+public:
+    CameraMatrices(size_t num_eyes = 1);
+
+    /**
+     * Updates the matrices of the given eye from the view matrix (render to camera)
+     * and the projection matrix. The last view projection matrices become the
+     * ones of the previous update.
+     *
+     * @return  Combination of ChangedFlags.
+     */
+    int update(size_t eye, const LMatrix4f& view_mat, const LMatrix4f& proj_mat, bool compute_frustum = false);
+
+    size_t get_num_eyes() const;
+    const Eye& get_eye(size_t eye) const;
+
+private:
+    std::vector<Eye> eyes_;
+};
+
+// ************************************************************************************************
+
+inline CameraMatrices::CameraMatrices(size_t num_eyes): eyes_(num_eyes)
+{
+}
+
+inline size_t CameraMatrices::get_num_eyes() const
+{
+    return eyes_.size();
+}
+
+inline const CameraMatrices::Eye& CameraMatrices::get_eye(size_t eye) const
+{
+    return eyes_[eye];
+}
+
+}
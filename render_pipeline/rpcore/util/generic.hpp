@@ -31,6 +31,9 @@ namespace rpcore {
 /** Creates a rgb color from a given string. */
 LVecBase3 rgb_from_string(const std::string& text, PN_stdfloat min_brightness=0.6f);
 
+/** Escapes a string to be used in a JSON string. */
+std::string escape_json(const std::string& value);
+
 /**
  * 'Snaps' a shadow map to make sure it always is on full texel centers.
  * This ensures no flickering occurs while moving the shadow map.
@@ -26,6 +26,7 @@
 
 #include <unordered_map>
 #include <functional>
+#include <vector>
 
 #include <render_pipeline/rpcore/rpobject.hpp>
 
@@ -47,6 +48,12 @@ public:
 
     void set_shader_input(const ShaderInput& inp, bool override_input=false);
 
+    /**
+     * Sets the inputs with a single ShaderAttrib, so only one RenderState is created.
+     * ShaderAttribs are unique, so regions with the same inputs share the attrib.
+     */
+    void set_shader_inputs(const std::vector<ShaderInput>& inputs, bool override_input=false);
+
     /** DisplayRegion functions with PostProcessRegion::region. */
     ///@{
     std::function<void(int)>    set_sort;
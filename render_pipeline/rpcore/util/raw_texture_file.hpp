@@ -0,0 +1,89 @@
+/**
+ * Render Pipeline C++
+ *
+ * Copyright (c) 2018 Center of Human-centered Interaction for Coexistence.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+ * and associated documentation files (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial
+ * portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT
+ * LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <texture.h>
+
+#include <render_pipeline/rpcore/config.hpp>
+
+namespace rpcore {
+
+/**
+ * Versioned binary container for raw texture data.
+ *
+ * The file stores the uncompressed RAM images of all mipmap levels together
+ * with the texture type, format and dimensions, so that precomputed data like
+ * color LUTs can be loaded without decoding an image format. The file starts
+ * with RawTextureFile::Header, followed by one RawTextureFile::MipmapEntry for
+ * each mipmap level and the payload. The fields are stored in little-endian
+ * order without padding, regardless of the host. The texture type, component
+ * type and format are stored as values of this format, not of Panda3D.
+ */
+class RENDER_PIPELINE_DECL RawTextureFile
+{
+public:
+    static constexpr uint32_t MAGIC = 0x58545052;       // "RPTX"
+    static constexpr uint32_t VERSION = 3;
+
+    struct Header
+    {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t texture_type;
+        uint32_t component_type;
+        uint32_t format;
+        uint32_t x_size;
+        uint32_t y_size;
+        uint32_t z_size;
+        uint32_t num_mipmap_levels;
+        uint32_t reserved;
+
+        /** FNV-1a hash of the other header fields, the mipmap table and the payload. */
+        uint64_t checksum;
+    };
+
+    struct MipmapEntry
+    {
+        uint64_t offset;        ///< Offset of the RAM image from the start of the file.
+        uint64_t size;
+    };
+
+    /**
+     * Read the texture from the file.
+     *
+     * If the file is on a physical file system, it is mapped into memory and
+     * copied into the RAM images. Otherwise, it is read via VirtualFileSystem.
+     *
+     * @return  The texture, or nullptr if the file is not a valid container.
+     */
+    static PT(Texture) read(const Filename& filename);
+
+    /**
+     * Write the RAM images of the texture to the file.
+     * The texture should have uncompressed RAM images.
+     */
+    static bool write(const Filename& filename, Texture* texture);
+
+    static uint64_t compute_checksum(const unsigned char* data, size_t size, uint64_t hash=0xcbf29ce484222325ull);
+};
+
+}
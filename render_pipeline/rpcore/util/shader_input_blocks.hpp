@@ -25,6 +25,7 @@
 #include <shaderInput.h>
 
 #include <unordered_map>
+#include <vector>
 
 #include <boost/variant.hpp>
 
@@ -107,9 +108,15 @@ inline const std::string& SimpleInputBlock::get_name() const
 
 
 /**
- * Grouped uniform buffer which either uses PointerToArray's to efficiently
- * store and update the shader inputs, or in case of uniform buffer object (UBO)
- * support, uses these to pass the inputs to the shaders.
+ * Grouped uniform buffer which uses PointerToArray's to efficiently store and
+ * update the shader inputs. The inputs are laid out with the std140 rules.
+ * In case of uniform buffer object (UBO) support, the PTAs are passed to the
+ * UBO as one shader input per PTA. Otherwise, flush() packs them into one
+ * contiguous vec4 array (and an ivec4 array for integers) which is passed to
+ * the shaders as a single input.
+ *
+ * In both cases, Panda3D uploads the inputs whenever a shader uses them,
+ * regardless of whether the values were changed.
  */
 class RENDER_PIPELINE_DECL GroupedInputBlock : public RPObject
 {
@@ -137,6 +144,16 @@ public:
         PTA_LMatrix4f
     };
 
+    /** std140 layout of an input. Offsets are in bytes from the start of the block. */
+    struct LayoutMember
+    {
+        std::string name;
+        PTA_ID type;
+        size_t array_size;
+        size_t offset;
+        size_t array_stride;
+    };
+
 public:
     // Keeps track of the global allocated input blocks to be able to assign
     // a unique binding to all of them
@@ -175,17 +192,52 @@ public:
     /** Returns the value of an existing input. */
     const PTA_Types& get_input(const std::string& name) const;
 
+    /**
+     * Copies the values of the inputs into the packed buffers, which the shaders
+     * read when UBOs are not supported. StageManager calls this for the
+     * registered blocks in every frame after the stages are updated.
+     *
+     * @return  true if any value was changed since the last flush. This is only
+     *          informative, it does not control the upload.
+     */
+    bool flush();
+
+    /** Returns the std140 layout of the inputs, in the order of the block. */
+    const std::vector<LayoutMember>& get_layout() const;
+
+    /** Returns the size of the block in bytes. */
+    size_t get_layout_size() const;
+
+    /** Returns the packed std140 data of the float inputs, which is updated by flush(). */
+    const PTA_LVecBase4f& get_packed_data() const;
+
+    /**
+     * Returns the packed std140 data of the integer inputs, which is updated by flush().
+     * This is empty if the block has no integer inputs.
+     */
+    const PTA_LVecBase4i& get_packed_int_data() const;
+
     /** Generates the GLSL shader code to use the UBO. */
     std::string generate_shader_code() const;
 
     const std::string& get_name() const;
 
 private:
+    /** Computes the std140 layout of the registered inputs. */
+    void update_layout();
+
     const std::string name_;
 
     std::unordered_map<std::string, PTA_Types> ptas_;
+    std::vector<std::string> input_names_;
     bool use_ubo_;
     int bind_id_;
+
+    std::vector<LayoutMember> layout_;
+    size_t layout_size_ = 0;
+    PTA_LVecBase4f packed_data_;
+    PTA_LVecBase4i packed_int_data_;
+    bool has_int_members_ = false;
 };
 
 // ************************************************************************************************
@@ -239,4 +291,24 @@ inline const GroupedInputBlock::PTA_Types& GroupedInputBlock::get_input(const st
     return ptas_.at(name);
 }
 
+inline const std::vector<GroupedInputBlock::LayoutMember>& GroupedInputBlock::get_layout() const
+{
+    return layout_;
+}
+
+inline size_t GroupedInputBlock::get_layout_size() const
+{
+    return layout_size_;
+}
+
+inline const PTA_LVecBase4f& GroupedInputBlock::get_packed_data() const
+{
+    return packed_data_;
+}
+
+inline const PTA_LVecBase4i& GroupedInputBlock::get_packed_int_data() const
+{
+    return packed_int_data_;
+}
+
 }
@@ -22,6 +22,8 @@
 
 #pragma once
 
+#include <cstdint>
+#include <unordered_map>
 #include <vector>
 
 #include <render_pipeline/rpcore/rpobject.hpp>
@@ -36,37 +38,199 @@ namespace rpcore {
  */
 class RENDER_PIPELINE_DECL TaskScheduler : public RPObject
 {
+public:
+    /** Handle of a task, see get_task_id(). */
+    using TaskId = int;
+
+    static constexpr TaskId INVALID_TASK_ID = -1;
+
+    /** Statistics of the adaptive mode. */
+    struct AdaptiveStats
+    {
+        /** Amount of frames which exceeded the frame budget. */
+        size_t over_budget_frames = 0;
+
+        /** Amount of times that a task was deferred to a later frame. */
+        size_t deferred_tasks = 0;
+
+        /** Amount of times that a task was run over budget because it reached the maximum deferral. */
+        size_t forced_tasks = 0;
+
+        /** The largest amount of frames that a task was deferred. */
+        int max_staleness = 0;
+    };
+
 public:
     TaskScheduler();
 
+    /**
+     * Returns the handle of a task, which can be used with is_scheduled(TaskId)
+     * instead of the name to avoid string lookup every frame. If the task is not
+     * in the configuration, it is registered without being scheduled at all.
+     */
+    TaskId get_task_id(const std::string& task_name);
+
     /** Returns whether a given task is supposed to run this frame. */
     bool is_scheduled(const std::string& task_name) const;
 
+    /** Returns whether a given task is supposed to run this frame. */
+    bool is_scheduled(TaskId task_id) const;
+
+    /** Advances to the next frame of the cycle. */
     void step();
 
+    /**
+     * Advances to the next frame of the cycle. In adaptive mode, deferrable tasks
+     * of the new frame are deferred when @p last_frame_time (in milliseconds)
+     * exceeded the frame budget, until a frame within the budget or until they
+     * reached the maximum deferral.
+     */
+    void step(double last_frame_time);
+
     /** Returns the total amount of tasks. */
     size_t get_num_tasks() const;
 
     /** Returns the amount of scheduled tasks this frame. */
     size_t get_num_scheduled_tasks() const;
 
+    /** Returns the amount of frames in the cycle. */
+    size_t get_num_frames() const;
+
+    /** Returns the names of the tasks in the given frame of the cycle. */
+    std::vector<std::string> get_frame_task_names(size_t frame_index) const;
+
+    /** Returns the amount of tasks which are deferred at the moment. */
+    size_t get_num_deferred_tasks() const;
+
+    bool is_adaptive() const;
+    void set_adaptive(bool enabled);
+
+    /** Frame budget of the adaptive mode, in milliseconds. */
+    double get_frame_budget() const;
+    void set_frame_budget(double frame_budget);
+
+    /** Maximum amount of frames that a task can be deferred in adaptive mode. */
+    int get_max_deferral() const;
+    void set_max_deferral(int max_deferral);
+
+    /** Sets whether the task can be deferred in adaptive mode. */
+    void set_deferrable(TaskId task_id, bool deferrable);
+
+    /**
+     * Adds a chain of tasks which depend on the results of the previous tasks
+     * in the chain. In adaptive mode, a task of the chain is deferred together
+     * while any previous task of the chain is deferred.
+     */
+    void add_chain(const std::vector<TaskId>& chain);
+
+    const AdaptiveStats& get_adaptive_stats() const;
+    void reset_adaptive_stats();
+
 private:
     /** Loads the tasks distribution configuration. */
     void load_config();
 
-    /**
-     * Checks whether the given task is scheduled at some point. This can
-     * be used to check whether any task is missing in the task scheduler config.
-     */
-    void check_missing_schedule(const std::string& task_name) const;
+    /** Returns the ID of a task, or INVALID_TASK_ID if it is unknown. */
+    TaskId find_task_id(const std::string& task_name) const;
+
+    /** Computes the scheduled tasks of the current frame. */
+    void update_active_tasks(bool over_budget);
 
     int frame_index_;
-    std::vector<std::vector<std::string>> tasks_;
+
+    std::unordered_map<std::string, TaskId> task_ids_;
+
+    // Bitset of the scheduled tasks, words_per_frame_ words for each frame.
+    std::vector<uint64_t> frame_masks_;
+    size_t words_per_frame_;
+
+    size_t num_frames_;
+    size_t num_tasks_;
+
+    // Bitsets of the current frame, words_per_frame_ words.
+    std::vector<uint64_t> active_mask_;
+    std::vector<uint64_t> deferred_mask_;
+    std::vector<uint64_t> deferrable_mask_;
+    size_t num_active_tasks_ = 0;
+    size_t num_deferred_tasks_ = 0;
+
+    // Amount of frames that each task is deferred.
+    std::vector<int> deferred_frames_;
+
+    // Tasks in the order of their dependencies.
+    std::vector<std::vector<TaskId>> chains_;
+
+    bool adaptive_ = false;
+    double frame_budget_ = 1000.0 / 60.0;
+    int max_deferral_ = 4;
+    AdaptiveStats adaptive_stats_;
 };
 
+inline bool TaskScheduler::is_scheduled(TaskId task_id) const
+{
+    if (task_id < 0)
+        return false;
+
+    const size_t word = static_cast<size_t>(task_id) / 64;
+    if (word >= words_per_frame_)
+        return false;
+
+    return (active_mask_[word] >> (task_id % 64)) & 1u;
+}
+
+inline void TaskScheduler::step()
+{
+    step(0.0);
+}
+
 inline size_t TaskScheduler::get_num_scheduled_tasks() const
 {
-    return tasks_[frame_index_].size();
+    return num_active_tasks_;
+}
+
+inline size_t TaskScheduler::get_num_frames() const
+{
+    return num_frames_;
+}
+
+inline size_t TaskScheduler::get_num_deferred_tasks() const
+{
+    return num_deferred_tasks_;
+}
+
+inline bool TaskScheduler::is_adaptive() const
+{
+    return adaptive_;
+}
+
+inline double TaskScheduler::get_frame_budget() const
+{
+    return frame_budget_;
+}
+
+inline void TaskScheduler::set_frame_budget(double frame_budget)
+{
+    frame_budget_ = frame_budget;
+}
+
+inline int TaskScheduler::get_max_deferral() const
+{
+    return max_deferral_;
+}
+
+inline void TaskScheduler::set_max_deferral(int max_deferral)
+{
+    max_deferral_ = max_deferral;
+}
+
+inline const TaskScheduler::AdaptiveStats& TaskScheduler::get_adaptive_stats() const
+{
+    return adaptive_stats_;
+}
+
+inline void TaskScheduler::reset_adaptive_stats()
+{
+    adaptive_stats_ = AdaptiveStats{};
 }
 
 }
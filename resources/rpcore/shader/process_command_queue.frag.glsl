@@ -28,30 +28,44 @@
 
 #pragma include "render_pipeline_base.inc.glsl"
 
-uniform samplerBuffer CommandQueue;
+uniform usamplerBuffer CommandQueue;
 uniform writeonly imageBuffer RESTRICT LightData;
 uniform writeonly imageBuffer RESTRICT SourceData;
 uniform int commandCount;
 
+// Reads a single word from the data stack
+uint read_word(inout int stack_ptr) {
+    return texelFetch(CommandQueue, stack_ptr++).x;
+}
+
 // Reads a single float from the data stack
 float read_float(inout int stack_ptr) {
-    return texelFetch(CommandQueue, stack_ptr++).x;
+    return uintBitsToFloat(read_word(stack_ptr));
 }
 
 // Reads a single int from the data stack
 int read_int(inout int stack_ptr) {
-    return gpu_cq_unpack_int_from_float(read_float(stack_ptr));
+    return int(read_word(stack_ptr));
 }
 
 // Reads a 4-component vector from the data stack
 vec4 read_vec4(inout int stack_ptr) {
     stack_ptr += 4;
-    return vec4(
+    return uintBitsToFloat(uvec4(
             texelFetch(CommandQueue, stack_ptr - 4).x,
             texelFetch(CommandQueue, stack_ptr - 3).x,
             texelFetch(CommandQueue, stack_ptr - 2).x,
             texelFetch(CommandQueue, stack_ptr - 1).x
-        );
+        ));
+}
+
+// Reads a 4-component vector stored as 16-bit floats from the data stack.
+// Words past the end of the command are treated as zero.
+vec4 read_half_vec4(inout int stack_ptr, int command_end) {
+    uint xy = stack_ptr < command_end ? texelFetch(CommandQueue, stack_ptr).x : 0u;
+    uint zw = stack_ptr + 1 < command_end ? texelFetch(CommandQueue, stack_ptr + 1).x : 0u;
+    stack_ptr += 2;
+    return vec4(unpackHalf2x16(xy), unpackHalf2x16(zw));
 }
 
 void main() {
@@ -59,11 +73,17 @@ void main() {
     // Store a pointer to the current stack index, its passed as a handle to all
     // read functions
     int stack_ptr = 0;
+    int command_end = 0;
 
     // Process each command
     for (int command_index = 0; command_index < commandCount; ++command_index) {
-        stack_ptr = command_index * 32;
-        int command_type = read_int(stack_ptr);
+
+        // The header stores the type in the lower and the size of the command
+        // in words in the upper 16 bits
+        stack_ptr = command_end;
+        uint header = read_word(stack_ptr);
+        int command_type = int(header & 0xFFFFu);
+        command_end += int(header >> 16);
 
         switch(command_type) {
 
@@ -78,13 +98,12 @@ void main() {
                 int slot = read_int(stack_ptr);
                 int offs = slot * 4;
 
-                // Copy the data over
+                // Copy the data over, its stored with half precision
                 for (int i = 0; i < 4; ++i) {
-                    imageStore(LightData, offs + i, read_vec4(stack_ptr));
+                    imageStore(LightData, offs + i, read_half_vec4(stack_ptr, command_end));
                 }
                 break;
             }
-
             // Remove Light
             case CMD_remove_light: {
 
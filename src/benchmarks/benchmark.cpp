@@ -0,0 +1,92 @@
+/**
+ * Render Pipeline C++
+ *
+ * Copyright (c) 2018 Center of Human-centered Interaction for Coexistence.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+ * and associated documentation files (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial
+ * portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT
+ * LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "benchmark.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <numeric>
+
+#include <fmt/format.h>
+
+namespace rpbenchmark {
+
+Result run_benchmark(const Benchmark& benchmark, size_t samples)
+{
+    Result result;
+    result.name = benchmark.name;
+    result.operations = (std::max)(size_t(1), benchmark.operations);
+    result.samples = (std::max)(size_t(1), samples);
+
+    // warm up caches and lazily initialized states
+    benchmark.function(result.operations);
+
+    std::vector<double> times;
+    times.reserve(result.samples);
+    for (size_t k = 0; k < result.samples; ++k)
+    {
+        const auto start_time = std::chrono::steady_clock::now();
+        benchmark.function(result.operations);
+        const std::chrono::duration<double, std::nano> duration = std::chrono::steady_clock::now() - start_time;
+        times.push_back(duration.count() / result.operations);
+    }
+
+    std::sort(times.begin(), times.end());
+    const size_t mid = times.size() / 2;
+    result.median = times.size() % 2 == 0 ? (times[mid - 1] + times[mid]) / 2 : times[mid];
+    result.min = times.front();
+    result.max = times.back();
+    result.mean = std::accumulate(times.begin(), times.end(), 0.0) / times.size();
+
+    double variance = 0;
+    for (const double time: times)
+        variance += (time - result.mean) * (time - result.mean);
+    result.stddev = std::sqrt(variance / times.size());
+
+    return result;
+}
+
+void write_json(std::ostream& os, const std::vector<Result>& results)
+{
+    os << "{\n    \"unit\": \"ns/op\",\n    \"benchmarks\": [";
+    for (size_t k = 0, k_end = results.size(); k < k_end; ++k)
+    {
+        const auto& r = results[k];
+        os << (k == 0 ? "\n" : ",\n") << fmt::format(
+            "        {{\"name\": \"{}\", \"operations\": {}, \"samples\": {}, "
+            "\"mean\": {:.3f}, \"median\": {:.3f}, \"min\": {:.3f}, \"max\": {:.3f}, \"stddev\": {:.3f}}}",
+            r.name, r.operations, r.samples, r.mean, r.median, r.min, r.max, r.stddev);
+    }
+    os << "\n    ]\n}\n";
+}
+
+void write_csv(std::ostream& os, const std::vector<Result>& results)
+{
+    os << "name,operations,samples,mean_ns,median_ns,min_ns,max_ns,stddev_ns\n";
+    for (const auto& r: results)
+    {
+        os << fmt::format("{},{},{},{:.3f},{:.3f},{:.3f},{:.3f},{:.3f}\n",
+            r.name, r.operations, r.samples, r.mean, r.median, r.min, r.max, r.stddev);
+    }
+}
+
+}
@@ -0,0 +1,109 @@
+/**
+ * Render Pipeline C++
+ *
+ * Copyright (c) 2018 Center of Human-centered Interaction for Coexistence.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+ * and associated documentation files (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial
+ * portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT
+ * LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace rpcore {
+class RenderPipeline;
+}
+
+namespace rpbenchmark {
+
+/** Benchmark which runs @p operations operations of its workload for each sample. */
+struct Benchmark
+{
+    std::string name;
+    size_t operations;
+    std::function<void(size_t operations)> function;
+};
+
+/** Result of a benchmark. Times are in nanoseconds per operation. */
+struct Result
+{
+    std::string name;
+    size_t operations = 0;
+    size_t samples = 0;
+    double mean = 0;
+    double median = 0;
+    double min = 0;
+    double max = 0;
+    double stddev = 0;
+};
+
+/**
+ * Deterministic random generator for workloads.
+ *
+ * std::uniform_*_distribution differ between standard libraries, so the values
+ * are mapped from the raw output to get the same workloads on every platform.
+ */
+class Random
+{
+public:
+    explicit Random(uint64_t seed = 0x5eed) : state_(seed) {}
+
+    /** SplitMix64 */
+    uint64_t next()
+    {
+        uint64_t z = (state_ += 0x9e3779b97f4a7c15ull);
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+        return z ^ (z >> 31);
+    }
+
+    /** Returns integer in [0, n). */
+    size_t next_index(size_t n) { return static_cast<size_t>(next() % n); }
+
+    /** Returns float in [lower, upper). */
+    float next_float(float lower = 0.0f, float upper = 1.0f)
+    {
+        return lower + (upper - lower) * static_cast<float>(next() >> 40) * (1.0f / 16777216.0f);
+    }
+
+private:
+    uint64_t state_;
+};
+
+/** Prevents the compiler from removing the computation of @p value. */
+template <class T>
+inline void do_not_optimize(const T& value)
+{
+    static volatile const void* sink;
+    sink = &value;
+}
+
+Result run_benchmark(const Benchmark& benchmark, size_t samples);
+
+void write_json(std::ostream& os, const std::vector<Result>& results);
+void write_csv(std::ostream& os, const std::vector<Result>& results);
+
+/** Benchmarks of native classes, which do not require the pipeline. */
+std::vector<Benchmark> make_native_benchmarks();
+
+/** Benchmarks which require created pipeline. */
+std::vector<Benchmark> make_pipeline_benchmarks(rpcore::RenderPipeline& pipeline);
+
+}
@@ -0,0 +1,157 @@
+/**
+ * Render Pipeline C++
+ *
+ * Copyright (c) 2018 Center of Human-centered Interaction for Coexistence.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+ * and associated documentation files (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial
+ * portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT
+ * LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * Runs micro-benchmarks of CPU hot paths and writes the results as JSON or CSV.
+ *
+ * Usage: rpbenchmark [--format json|csv] [--output <file>] [--filter <substring>] [--samples <count>]
+ *                    [--pipeline [--config-dir <dir>]]
+ *
+ * The workloads use fixed seeds, so the results can be compared between versions.
+ * With --pipeline, the benchmarks which require the pipeline are also run.
+ * Use a config directory with 'pipeline.headless: true' to run them without GPU.
+ */
+
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+
+#include <fmt/format.h>
+
+#include <render_pipeline/rpcore/mount_manager.hpp>
+#include <render_pipeline/rpcore/render_pipeline.hpp>
+
+#include "benchmark.hpp"
+
+static void print_usage()
+{
+    std::cerr << "Usage: rpbenchmark [--format json|csv] [--output <file>] [--filter <substring>] [--samples <count>] "
+        "[--pipeline [--config-dir <dir>]]" << std::endl;
+}
+
+int main(int argc, char* argv[])
+{
+    std::string format = "json";
+    std::string output_path;
+    std::string filter;
+    size_t samples = 20;
+    bool use_pipeline = false;
+    std::string config_dir;
+
+    for (int k = 1; k < argc; ++k)
+    {
+        const std::string arg = argv[k];
+        if (arg == "--format" && k + 1 < argc)
+            format = argv[++k];
+        else if (arg == "--output" && k + 1 < argc)
+            output_path = argv[++k];
+        else if (arg == "--filter" && k + 1 < argc)
+            filter = argv[++k];
+        else if (arg == "--samples" && k + 1 < argc)
+        {
+            try
+            {
+                samples = std::stoul(argv[++k]);
+            }
+            catch (const std::logic_error&)
+            {
+                std::cerr << fmt::format("Invalid sample count '{}'.", argv[k]) << std::endl;
+                print_usage();
+                return 1;
+            }
+        }
+        else if (arg == "--pipeline")
+            use_pipeline = true;
+        else if (arg == "--config-dir" && k + 1 < argc)
+            config_dir = argv[++k];
+        else
+        {
+            print_usage();
+            return 1;
+        }
+    }
+
+    if ((format != "json" && format != "csv") || samples == 0)
+    {
+        print_usage();
+        return 1;
+    }
+
+    // TaskScheduler and the effects read files in the virtual file system.
+    std::unique_ptr<rpcore::RenderPipeline> pipeline;
+    std::unique_ptr<rpcore::MountManager> mount_mgr;
+    if (use_pipeline)
+    {
+        pipeline = std::make_unique<rpcore::RenderPipeline>();
+        if (!config_dir.empty())
+            pipeline->get_mount_mgr()->set_config_dir(Filename::from_os_specific(config_dir));
+        if (!pipeline->create())
+        {
+            std::cerr << "Failed to create the pipeline." << std::endl;
+            return 1;
+        }
+    }
+    else
+    {
+        mount_mgr = std::make_unique<rpcore::MountManager>();
+        if (!config_dir.empty())
+            mount_mgr->set_config_dir(Filename::from_os_specific(config_dir));
+        mount_mgr->mount();
+    }
+
+    std::vector<rpbenchmark::Benchmark> benchmarks = rpbenchmark::make_native_benchmarks();
+    if (pipeline)
+    {
+        for (auto&& benchmark: rpbenchmark::make_pipeline_benchmarks(*pipeline))
+            benchmarks.push_back(std::move(benchmark));
+    }
+
+    std::vector<rpbenchmark::Result> results;
+    for (const auto& benchmark: benchmarks)
+    {
+        if (!filter.empty() && benchmark.name.find(filter) == std::string::npos)
+            continue;
+
+        results.push_back(rpbenchmark::run_benchmark(benchmark, samples));
+        std::cerr << fmt::format("{}: {:.3f} ns/op (median)", benchmark.name, results.back().median) << std::endl;
+    }
+
+    std::ofstream output_file;
+    if (!output_path.empty())
+    {
+        output_file.open(output_path);
+        if (!output_file)
+        {
+            std::cerr << fmt::format("Failed to open '{}'.", output_path) << std::endl;
+            return 1;
+        }
+    }
+
+    std::ostream& os = output_path.empty() ? std::cout : output_file;
+    if (format == "csv")
+        rpbenchmark::write_csv(os, results);
+    else
+        rpbenchmark::write_json(os, results);
+
+    return 0;
+}
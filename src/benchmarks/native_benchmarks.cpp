@@ -0,0 +1,378 @@
+/**
+ * Render Pipeline C++
+ *
+ * Copyright (c) 2018 Center of Human-centered Interaction for Coexistence.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+ * and associated documentation files (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial
+ * portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT
+ * LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "benchmark.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <deque>
+#include <iostream>
+#include <memory>
+
+#include <camera.h>
+#include <perspectiveLens.h>
+
+#include <render_pipeline/rpcore/native/gpu_command_list.h>
+#include <render_pipeline/rpcore/native/pointer_slot_storage.h>
+#include <render_pipeline/rpcore/native/pssm_camera_rig.h>
+#include <render_pipeline/rpcore/native/shadow_atlas.h>
+#include <render_pipeline/rpcore/util/camera_matrices.hpp>
+#include <render_pipeline/rpcore/util/task_scheduler.hpp>
+
+namespace rpbenchmark {
+
+// Same size as the light storage of InternalLightManager.
+using LightSlotStorage = rpcore::PointerSlotStorage<int*, 65535>;
+
+static Benchmark make_pointer_slot_storage_benchmark()
+{
+    struct State
+    {
+        LightSlotStorage storage;
+        std::vector<int> used_slots;
+        int dummy = 0;
+        Random random;
+    };
+
+    // allocate on heap because the storage is too large for stack.
+    auto state = std::make_shared<State>();
+
+    // Fill a half of slots in random order, so free slots are fragmented.
+    for (int k = 0; k < 65535 / 2; ++k)
+    {
+        int slot;
+        state->storage.find_slot(slot);
+        state->storage.reserve_slot(slot, &state->dummy);
+        state->used_slots.push_back(slot);
+    }
+    for (int k = 0; k < 65535 / 4; ++k)
+    {
+        const size_t index = state->random.next_index(state->used_slots.size());
+        state->storage.free_slot(state->used_slots[index]);
+        state->used_slots[index] = state->used_slots.back();
+        state->used_slots.pop_back();
+    }
+
+    // Each operation adds a light and removes a random light.
+    return Benchmark{ "pointer_slot_storage/find_reserve_free", 1000, [state](size_t operations) {
+        for (size_t k = 0; k < operations; ++k)
+        {
+            int slot;
+            if (state->storage.find_slot(slot))
+            {
+                state->storage.reserve_slot(slot, &state->dummy);
+                state->used_slots.push_back(slot);
+            }
+
+            const size_t index = state->random.next_index(state->used_slots.size());
+            state->storage.free_slot(state->used_slots[index]);
+            state->used_slots[index] = state->used_slots.back();
+            state->used_slots.pop_back();
+        }
+        do_not_optimize(state->storage.get_num_entries());
+    } };
+}
+
+static Benchmark make_shadow_atlas_benchmark()
+{
+    struct State
+    {
+        // 4096 px atlas with 32 px tiles like the default configuration of shadows.
+        rpcore::ShadowAtlas atlas{ 4096, 32 };
+        std::deque<LVecBase4i> regions;
+        Random random;
+    };
+
+    auto state = std::make_shared<State>();
+
+    // Each operation reserves a region of 128 ~ 1024 px (4 ~ 32 tiles) and frees the oldest regions
+    // when the atlas becomes crowded, like shadow sources of moving lights.
+    return Benchmark{ "shadow_atlas/find_and_reserve_region", 1000, [state](size_t operations) {
+        for (size_t k = 0; k < operations; ++k)
+        {
+            const size_t tiles = size_t(4) << state->random.next_index(4);
+            const LVecBase4i region = state->atlas.find_and_reserve_region(tiles, tiles);
+            if (region.get_x() >= 0)
+                state->regions.push_back(region);
+
+            while (!state->regions.empty() && state->atlas.get_coverage() > 0.75f)
+            {
+                state->atlas.free_region(state->regions.front());
+                state->regions.pop_front();
+            }
+        }
+        do_not_optimize(state->atlas.get_num_used_tiles());
+    } };
+}
+
+static Benchmark make_gpu_command_list_benchmark()
+{
+    struct State
+    {
+        rpcore::GPUCommandList command_list;
+        PTA_uchar dest;
+        Random random;
+    };
+
+    auto state = std::make_shared<State>();
+    state->dest = PTA_uchar::empty_array(32 * GPU_COMMAND_ENTRIES * sizeof(float));
+
+    // Each operation queues and writes one command like storing a light.
+    return Benchmark{ "gpu_command_list/write_commands_to", 1024, [state](size_t operations) {
+        for (size_t k = 0; k < operations; k += 32)
+        {
+            for (size_t i = 0; i < 32; ++i)
+            {
+                rpcore::GPUCommand cmd(rpcore::GPUCommand::CMD_store_light);
+                cmd.push_int(static_cast<int>(k + i));
+                cmd.push_vec3(LVecBase3f(state->random.next_float(), state->random.next_float(), state->random.next_float()));
+                cmd.push_vec4(LVecBase4f(state->random.next_float(), 1, 1, 1));
+                cmd.push_mat3(LMatrix3f::ident_mat());
+                state->command_list.add_command(cmd);
+            }
+            do_not_optimize(state->command_list.write_commands_to(state->dest, 32));
+        }
+    } };
+}
+
+static Benchmark make_pssm_camera_rig_benchmark()
+{
+    struct State
+    {
+        rpcore::PSSMCameraRig rig{ 5 };
+        NodePath root{ "root" };
+        NodePath cam_np;
+        float time = 0;
+    };
+
+    auto state = std::make_shared<State>();
+
+    // Same settings as the default configuration of pssm plugin.
+    state->rig.set_pssm_distance(100.0f);
+    state->rig.set_sun_distance(100.0f);
+    state->rig.set_logarithmic_factor(2.4f);
+    state->rig.set_border_bias(0.058f);
+    state->rig.set_use_stable_csm(true);
+    state->rig.set_use_fixed_film_size(true);
+    state->rig.set_resolution(1024);
+    state->rig.reparent_to(state->root);
+
+    PT(PerspectiveLens) lens = new PerspectiveLens;
+    lens->set_fov(40.0f);
+    lens->set_near_far(0.1f, 70000.0f);
+    state->cam_np = state->root.attach_new_node(new Camera("camera", lens));
+
+    // Each operation moves the camera along a fixed path and updates the splits.
+    return Benchmark{ "pssm_camera_rig/update", 1000, [state](size_t operations) {
+        for (size_t k = 0; k < operations; ++k)
+        {
+            state->time += 0.01f;
+            state->cam_np.set_pos(std::cos(state->time) * 100.0f, std::sin(state->time) * 100.0f, 10.0f);
+            state->cam_np.set_hpr(state->time * 57.0f, -10.0f, 0);
+            state->rig.update(state->cam_np, LVecBase3(0.3f, 0.4f, 0.87f));
+        }
+        do_not_optimize(state->rig.get_mvp_array()[0]);
+    } };
+}
+
+/** Returns the tasks in the default task-scheduler.yaml. */
+static std::vector<std::string> get_default_task_names()
+{
+    return {
+        "envprobes_select_and_cull", "pssm_scene_shadows", "envprobes_capture_envmap_face0",
+        "pssm_distant_shadows", "envprobes_capture_envmap_face1", "pssm_convert_distant_to_esm",
+        "envprobes_capture_envmap_face2", "pssm_blur_distant_vert", "pssm_blur_distant_horiz",
+        "envprobes_capture_envmap_face3", "envprobes_capture_envmap_face4",
+        "envprobes_capture_envmap_face5", "scattering_update_envmap", "envprobes_filter_and_store_envmap",
+    };
+}
+
+/**
+ * Copy of TaskScheduler before the frame bitsets, which is the baseline of
+ * "task_scheduler/is_scheduled". Each query scans all frames for a missing
+ * schedule, and then the tasks of the current frame, by string comparison.
+ */
+class LegacyTaskScheduler
+{
+public:
+    LegacyTaskScheduler(const rpcore::TaskScheduler& scheduler)
+    {
+        for (size_t frame_index = 0, frame_end = scheduler.get_num_frames(); frame_index < frame_end; ++frame_index)
+            tasks_.push_back(scheduler.get_frame_task_names(frame_index));
+    }
+
+    bool is_scheduled(const std::string& task_name) const
+    {
+        check_missing_schedule(task_name);
+        return std::find(tasks_[frame_index_].cbegin(), tasks_[frame_index_].cend(), task_name) != tasks_[frame_index_].cend();
+    }
+
+    void step()
+    {
+        frame_index_ = (frame_index_ + 1) % tasks_.size();
+    }
+
+private:
+    void check_missing_schedule(const std::string& task_name) const
+    {
+        bool found = false;
+        for (const auto& tasks: tasks_)
+        {
+            if (std::find(tasks.cbegin(), tasks.cend(), task_name) != tasks.cend())
+            {
+                found = true;
+                break;
+            }
+        }
+
+        if (!found)
+            std::cerr << "Task '" << task_name << "' is never scheduled and thus will never run!" << std::endl;
+    }
+
+    size_t frame_index_ = 0;
+    std::vector<std::vector<std::string>> tasks_;
+};
+
+static Benchmark make_task_scheduler_legacy_benchmark()
+{
+    struct State
+    {
+        std::unique_ptr<LegacyTaskScheduler> scheduler;
+        std::vector<std::string> task_names;
+    };
+
+    auto state = std::make_shared<State>();
+    state->scheduler = std::make_unique<LegacyTaskScheduler>(rpcore::TaskScheduler());
+    state->task_names = get_default_task_names();
+
+    // Same as "task_scheduler/is_scheduled", but with the old implementation.
+    return Benchmark{ "task_scheduler/is_scheduled_legacy", 1000, [state](size_t operations) {
+        size_t scheduled = 0;
+        for (size_t k = 0; k < operations; ++k)
+        {
+            for (const auto& name: state->task_names)
+                scheduled += state->scheduler->is_scheduled(name) ? 1 : 0;
+            state->scheduler->step();
+        }
+        do_not_optimize(scheduled);
+    } };
+}
+
+static Benchmark make_task_scheduler_benchmark()
+{
+    struct State
+    {
+        rpcore::TaskScheduler scheduler;
+        std::vector<std::string> task_names;
+    };
+
+    auto state = std::make_shared<State>();
+    state->task_names = get_default_task_names();
+
+    // Each operation queries all tasks in one frame like plugins do.
+    return Benchmark{ "task_scheduler/is_scheduled", 1000, [state](size_t operations) {
+        size_t scheduled = 0;
+        for (size_t k = 0; k < operations; ++k)
+        {
+            for (const auto& name: state->task_names)
+                scheduled += state->scheduler.is_scheduled(name) ? 1 : 0;
+            state->scheduler.step();
+        }
+        do_not_optimize(scheduled);
+    } };
+}
+
+static Benchmark make_task_scheduler_id_benchmark()
+{
+    struct State
+    {
+        rpcore::TaskScheduler scheduler;
+        std::vector<rpcore::TaskScheduler::TaskId> task_ids;
+    };
+
+    auto state = std::make_shared<State>();
+    for (const auto& name: get_default_task_names())
+        state->task_ids.push_back(state->scheduler.get_task_id(name));
+
+    // Same as "task_scheduler/is_scheduled", but with the handles which plugins store.
+    return Benchmark{ "task_scheduler/is_scheduled_id", 1000, [state](size_t operations) {
+        size_t scheduled = 0;
+        for (size_t k = 0; k < operations; ++k)
+        {
+            for (const auto task_id: state->task_ids)
+                scheduled += state->scheduler.is_scheduled(task_id) ? 1 : 0;
+            state->scheduler.step();
+        }
+        do_not_optimize(scheduled);
+    } };
+}
+
+static Benchmark make_camera_matrices_benchmark(bool stereo)
+{
+    struct State
+    {
+        std::unique_ptr<rpcore::CameraMatrices> matrices;
+        PT(PerspectiveLens) lens;
+        NodePath root{ "root" };
+        NodePath cam_np;
+        float time = 0;
+    };
+
+    auto state = std::make_shared<State>();
+    state->matrices = std::make_unique<rpcore::CameraMatrices>(stereo ? 2 : 1);
+    state->lens = new PerspectiveLens;
+    state->lens->set_fov(40.0f);
+    state->lens->set_near_far(0.1f, 70000.0f);
+    state->cam_np = state->root.attach_new_node(new Camera("camera", state->lens));
+
+    // Each operation moves the camera and jitters the projection like SMAA,
+    // so that all matrices of each eye are updated.
+    return Benchmark{ stereo ? "camera_matrices/update_stereo" : "camera_matrices/update_mono", 1000, [state](size_t operations) {
+        for (size_t k = 0; k < operations; ++k)
+        {
+            state->time += 0.01f;
+            state->cam_np.set_pos(std::cos(state->time) * 100.0f, std::sin(state->time) * 100.0f, 10.0f);
+            state->cam_np.set_hpr(state->time * 57.0f, -10.0f, 0);
+            state->lens->set_film_offset((k % 2) ? 0.25f : -0.25f, (k % 2) ? -0.25f : 0.25f);
+
+            const LMatrix4f& view_mat = state->root.get_transform(state->cam_np)->get_mat();
+            for (size_t eye = 0, eye_end = state->matrices->get_num_eyes(); eye < eye_end; ++eye)
+                do_not_optimize(state->matrices->update(eye, view_mat, state->lens->get_projection_mat(), !stereo));
+        }
+    } };
+}
+
+std::vector<Benchmark> make_native_benchmarks()
+{
+    return {
+        make_pointer_slot_storage_benchmark(),
+        make_shadow_atlas_benchmark(),
+        make_gpu_command_list_benchmark(),
+        make_pssm_camera_rig_benchmark(),
+        make_task_scheduler_legacy_benchmark(),
+        make_task_scheduler_benchmark(),
+        make_task_scheduler_id_benchmark(),
+        make_camera_matrices_benchmark(false),
+        make_camera_matrices_benchmark(true),
+    };
+}
+
+}
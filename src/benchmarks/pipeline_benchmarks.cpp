@@ -0,0 +1,223 @@
+/**
+ * Render Pipeline C++
+ *
+ * Copyright (c) 2018 Center of Human-centered Interaction for Coexistence.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+ * and associated documentation files (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial
+ * portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT
+ * LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "benchmark.hpp"
+
+#include <algorithm>
+#include <iostream>
+#include <memory>
+
+#include <texturePool.h>
+#include <virtualFileSystem.h>
+
+#include <render_pipeline/rpcore/effect.hpp>
+#include <render_pipeline/rpcore/globals.hpp>
+#include <render_pipeline/rpcore/loader.hpp>
+#include <render_pipeline/rpcore/render_pipeline.hpp>
+#include <render_pipeline/rpcore/stage_manager.hpp>
+#include <render_pipeline/rpcore/pluginbase/day_manager.hpp>
+#include <render_pipeline/rpcore/pluginbase/day_setting_types.hpp>
+#include <render_pipeline/rpcore/pluginbase/manager.hpp>
+#include <render_pipeline/rpcore/util/instancing_node.hpp>
+
+namespace rpbenchmark {
+
+static Benchmark make_effect_benchmark(rpcore::RenderPipeline& pipeline)
+{
+    // Each operation processes the shader templates of all passes of the default effect.
+    // Effect::load is not used because it returns the cached effect.
+    return Benchmark{ "effect/process_shader_template", 4, [&pipeline](size_t operations) {
+        for (size_t k = 0; k < operations; ++k)
+        {
+            rpcore::Effect effect;
+            effect.set_options(rpcore::Effect::get_default_options());
+            do_not_optimize(effect.do_load(pipeline, "/$$rp/effects/default.yaml"));
+        }
+    } };
+}
+
+static Benchmark make_stage_manager_setup_benchmark(rpcore::RenderPipeline& pipeline)
+{
+    rpcore::StageManager* stage_mgr = pipeline.get_stage_mgr();
+
+    // Each operation creates all stages again and binds their pipes and inputs like
+    // StageManager::setup, which includes writing the shader configuration and loading the shaders.
+    return Benchmark{ "stage_manager/setup", 1, [stage_mgr](size_t operations) {
+        const std::vector<rpcore::RenderStage*> stages = stage_mgr->get_stages();
+        for (size_t k = 0; k < operations; ++k)
+            do_not_optimize(stage_mgr->rebuild_stages(stages));
+    } };
+}
+
+static Benchmark make_daytime_manager_benchmark(rpcore::RenderPipeline& pipeline)
+{
+    struct State
+    {
+        rpcore::DayTimeManager* daytime_mgr;
+        float time = 0;
+    };
+
+    auto state = std::make_shared<State>();
+    state->daytime_mgr = pipeline.get_daytime_mgr();
+
+    // Each operation advances the time and evaluates all day time settings.
+    return Benchmark{ "daytime_manager/update", 100, [state](size_t operations) {
+        for (size_t k = 0; k < operations; ++k)
+        {
+            state->time += 0.001f;
+            if (state->time >= 1.0f)
+                state->time = 0;
+            state->daytime_mgr->set_time(state->time);
+            state->daytime_mgr->update();
+        }
+    } };
+}
+
+static Benchmark make_daytime_curves_benchmark(rpcore::RenderPipeline& pipeline)
+{
+    struct State
+    {
+        std::vector<std::shared_ptr<rpcore::DayBaseType>> settings;
+        float time = 0;
+    };
+
+    auto state = std::make_shared<State>();
+    auto plugin_mgr = pipeline.get_plugin_mgr();
+    for (const auto& plugin_id: plugin_mgr->get_enabled_plugins())
+    {
+        for (const auto& setting_handle: plugin_mgr->get_day_settings(plugin_id)->get<0>())
+            state->settings.push_back(setting_handle.value);
+    }
+
+    // Each operation evaluates the curves of all day time settings, as done
+    // before the settings were baked into lookup tables.
+    return Benchmark{ "daytime_settings/evaluate_curves", 100, [state](size_t operations) {
+        for (size_t k = 0; k < operations; ++k)
+        {
+            state->time += 0.001f;
+            if (state->time >= 1.0f)
+                state->time = 0;
+            for (const auto& setting: state->settings)
+                do_not_optimize(setting->get_shader_input_value(state->time));
+        }
+    } };
+}
+
+static Benchmark make_instancing_node_benchmark(rpcore::RenderPipeline& pipeline)
+{
+    struct State
+    {
+        std::unique_ptr<rpcore::InstancingNode> instancing_node;
+        Random random;
+    };
+
+    auto state = std::make_shared<State>();
+
+    NodePath np = rpcore::Globals::render.attach_new_node("benchmark_instancing");
+    state->instancing_node = std::make_unique<rpcore::InstancingNode>(pipeline, np);
+    state->instancing_node->set_instance_count(4096);
+    for (auto& transform: state->instancing_node->modify_transforms())
+        transform = LMatrix4f::translate_mat(state->random.next_float(-100, 100), state->random.next_float(-100, 100), 0);
+
+    // Each operation moves 64 instances and uploads 4096 transforms.
+    return Benchmark{ "instancing_node/upload_transforms", 100, [state](size_t operations) {
+        for (size_t k = 0; k < operations; ++k)
+        {
+            auto& transforms = state->instancing_node->modify_transforms();
+            for (int i = 0; i < 64; ++i)
+                transforms[state->random.next_index(transforms.size())].set_row(3, LVecBase3f(state->random.next_float(-100, 100), 0, 0));
+            state->instancing_node->upload_transforms();
+        }
+    } };
+}
+
+/** Directory of the film LUTs of the color correction plugin. */
+static const char* FILM_LUTS_PATH = "/$$rp/rpplugins/color_correction/resources/film_luts";
+
+static Benchmark make_load_sliced_3d_texture_benchmark()
+{
+    struct State
+    {
+        std::vector<Filename> lut_paths;
+        size_t index = 0;
+    };
+
+    auto state = std::make_shared<State>();
+    if (PT(VirtualFileList) files = VirtualFileSystem::get_global_ptr()->scan_directory(FILM_LUTS_PATH))
+    {
+        for (size_t k = 0, k_end = files->get_num_files(); k < k_end; ++k)
+        {
+            const Filename& path = files->get_file(k)->get_filename();
+            if (path.get_extension() == "png")
+                state->lut_paths.push_back(path);
+        }
+    }
+    std::sort(state->lut_paths.begin(), state->lut_paths.end());
+    if (state->lut_paths.empty())
+        std::cerr << "No film LUTs in " << FILM_LUTS_PATH << std::endl;
+
+    // Each operation loads the next film LUT like Plugin::load_lut when the LUT is
+    // switched, which includes reading and decoding the PNG.
+    return Benchmark{ "loader/load_sliced_3d_texture", 4, [state](size_t operations) {
+        if (state->lut_paths.empty())
+            return;
+
+        for (size_t k = 0; k < operations; ++k)
+        {
+            Texture* lut = rpcore::RPLoader::load_sliced_3d_texture(state->lut_paths[state->index], 64);
+            state->index = (state->index + 1) % state->lut_paths.size();
+            do_not_optimize(lut);
+
+            // do not keep the LUTs in the pool across the operations.
+            if (lut)
+                TexturePool::release_texture(lut);
+        }
+    } };
+}
+
+static Benchmark make_create_sliced_3d_texture_benchmark()
+{
+    PT(Texture) source = rpcore::RPLoader::load_texture(Filename(FILM_LUTS_PATH) / "default_lut.png");
+
+    // Each operation builds the 3D texture from the RAM image of a decoded LUT.
+    return Benchmark{ "loader/create_sliced_3d_texture", 16, [source](size_t operations) {
+        if (!source)
+            return;
+
+        for (size_t k = 0; k < operations; ++k)
+            do_not_optimize(rpcore::RPLoader::create_sliced_3d_texture(source, 64, 64, 64));
+    } };
+}
+
+std::vector<Benchmark> make_pipeline_benchmarks(rpcore::RenderPipeline& pipeline)
+{
+    return {
+        make_effect_benchmark(pipeline),
+        make_stage_manager_setup_benchmark(pipeline),
+        make_daytime_manager_benchmark(pipeline),
+        make_daytime_curves_benchmark(pipeline),
+        make_instancing_node_benchmark(pipeline),
+        make_load_sliced_3d_texture_benchmark(),
+        make_create_sliced_3d_texture_benchmark(),
+    };
+}
+
+}
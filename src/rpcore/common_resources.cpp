@@ -22,13 +22,14 @@
 
 #include "rpcore/common_resources.hpp"
 
+#include <type_traits>
 #include <unordered_map>
 
 #include <lens.h>
 #include <clockObject.h>
 #include <dynamicTextFont.h>
 
-#include "render_pipeline/rppanda/stdpy/file.hpp"
+#include "render_pipeline/rpcore/mount_manager.hpp"
 #include "render_pipeline/rpcore/globals.hpp"
 #include "render_pipeline/rpcore/loader.hpp"
 #include "render_pipeline/rpcore/render_pipeline.hpp"
@@ -39,7 +40,8 @@
 
 namespace rpcore {
 
-CommonResources::CommonResources(RenderPipeline& pipeline): RPObject("CommonResources"), pipeline_(pipeline)
+CommonResources::CommonResources(RenderPipeline& pipeline): RPObject("CommonResources"), pipeline_(pipeline),
+    camera_matrices_(pipeline.is_stereo_mode() ? 2 : 1)
 {
     showbase_ = Globals::base;
 
@@ -51,15 +53,8 @@ CommonResources::CommonResources(RenderPipeline& pipeline): RPObject("CommonReso
 void CommonResources::write_config()
 {
     const std::string& content = input_ubo_->generate_shader_code();
-    try
-    {
-        // Try to write the temporary file
-        (*rppanda::open_write_file("/$$rptemp/$$main_scene_data.inc.glsl", false, true)) << content;
-    }
-    catch (const std::exception& err)
-    {
-        error(std::string("Failed to write common resources shader configuration! ") + err.what());
-    }
+    if (!MountManager::write_temp_file("/$$rptemp/$$main_scene_data.inc.glsl", content))
+        error("Failed to write common resources shader configuration!");
 }
 
 void CommonResources::load_skydome()
@@ -79,7 +74,6 @@ void CommonResources::update()
 {
     const bool stereo_mode = pipeline_.is_stereo_mode();
     const Lens* cam_lens = showbase_->get_cam_lens();
-    static const LVecBase2i points[4] ={ LVecBase2i(-1, -1), LVecBase2i(1, -1), LVecBase2i(-1, 1), LVecBase2i(1, 1) };
 
     if (stereo_mode)
     {
@@ -109,173 +103,82 @@ void CommonResources::update()
             stereo_proj_mat[1] = cam_lens->get_lens_mat_inv() * LMatrix4::translate_mat(-iod) * cam_lens->get_lens_mat() * stereo_proj_mat[1];        // for right camera
         }
 
-        // Get the current transform matrix of the camera
-        const LMatrix4 view_mat[2] = {
-            Globals::render.get_transform(eye_path[0])->get_mat(),
-            Globals::render.get_transform(eye_path[1])->get_mat(),
-        };
-
-        // Compute the view matrix, but with a z-up coordinate system
-        const LMatrix4& zup_conversion = LMatrix4::z_to_y_up_mat();
-        input_ubo_->update_input("stereo_view_mat_z_up", view_mat[0] * zup_conversion, 0);
-        input_ubo_->update_input("stereo_view_mat_z_up", view_mat[1] * zup_conversion, 1);
-
-        // Compute the view matrix without the camera rotation
-        LMatrix4 view_mat_billboard[2] = { view_mat[0], view_mat[1] };
-
-        view_mat_billboard[0].set_row(0, LVecBase3(1, 0, 0));
-        view_mat_billboard[0].set_row(1, LVecBase3(0, 1, 0));
-        view_mat_billboard[0].set_row(2, LVecBase3(0, 0, 1));
-
-        view_mat_billboard[1].set_row(0, LVecBase3(1, 0, 0));
-        view_mat_billboard[1].set_row(1, LVecBase3(0, 1, 0));
-        view_mat_billboard[1].set_row(2, LVecBase3(0, 0, 1));
-
-        input_ubo_->update_input("stereo_view_mat_billboard", view_mat_billboard[0], 0);
-        input_ubo_->update_input("stereo_view_mat_billboard", view_mat_billboard[1], 1);
-
-        input_ubo_->update_input("stereo_camera_pos", eye_path[0].get_pos(Globals::render), 0);
-        input_ubo_->update_input("stereo_camera_pos", eye_path[1].get_pos(Globals::render), 1);
-
-        // Compute last view projection mat
+        for (size_t eye = 0; eye < 2; ++eye)
         {
-            const LMatrix4f& curr_vp_value = boost::get<const PTA_LMatrix4f&>(input_ubo_->get_input("stereo_view_proj_mat_no_jitter"))[0];
-            input_ubo_->update_input("stereo_last_view_proj_mat_no_jitter", curr_vp_value, 0);
-            LMatrix4f curr_vp = curr_vp_value;
-            curr_vp.invert_in_place();
-            const LMatrix4f curr_inv_vp = curr_vp;
-            input_ubo_->update_input("stereo_last_inv_view_proj_mat_no_jitter", curr_inv_vp, 0);
-        }
-        {
-            const LMatrix4f& curr_vp_value = boost::get<const PTA_LMatrix4f&>(input_ubo_->get_input("stereo_view_proj_mat_no_jitter"))[1];
-            input_ubo_->update_input("stereo_last_view_proj_mat_no_jitter", curr_vp_value, 1);
-            LMatrix4f curr_vp = curr_vp_value;
-            curr_vp.invert_in_place();
-            const LMatrix4f curr_inv_vp = curr_vp;
-            input_ubo_->update_input("stereo_last_inv_view_proj_mat_no_jitter", curr_inv_vp, 1);
-        }
-
-        const LMatrix4 stereo_proj_mat_z_up[2] ={
-            LMatrix4::y_to_z_up_mat() * stereo_proj_mat[0],
-            LMatrix4::y_to_z_up_mat() * stereo_proj_mat[1],
-        };
+            // Get the current transform matrix of the camera
+            const LMatrix4& view_mat = Globals::render.get_transform(eye_path[eye])->get_mat();
 
-        const LMatrix4 stereo_view_proj_mat[2] = {
-            view_mat[0] * stereo_proj_mat[0],
-            view_mat[1] * stereo_proj_mat[1]
-        };
-
-        input_ubo_->update_input("stereo_ViewMatrix", view_mat[0], 0);
-        input_ubo_->update_input("stereo_ViewMatrix", view_mat[1], 1);
-        input_ubo_->update_input("stereo_ProjectionMatrix", stereo_proj_mat[0], 0);
-        input_ubo_->update_input("stereo_ProjectionMatrix", stereo_proj_mat[1], 1);
-        input_ubo_->update_input("stereo_ViewProjectionMatrix", stereo_view_proj_mat[0], 0);
-        input_ubo_->update_input("stereo_ViewProjectionMatrix", stereo_view_proj_mat[1], 1);
-
-        input_ubo_->update_input("stereo_ViewProjectionMatrixInverse", invert(stereo_view_proj_mat[0]), 0);
-        input_ubo_->update_input("stereo_ViewProjectionMatrixInverse", invert(stereo_view_proj_mat[1]), 1);
-
-        // Set the projection matrix as an input, but convert it to the correct
-        // coordinate system before.
-        input_ubo_->update_input("stereo_proj_mat", stereo_proj_mat_z_up[0], 0);
-        input_ubo_->update_input("stereo_proj_mat", stereo_proj_mat_z_up[1], 1);
-
-        // Set the inverse projection matrix
-        input_ubo_->update_input("stereo_inv_proj_mat", invert(stereo_proj_mat_z_up[0]), 0);
-        input_ubo_->update_input("stereo_inv_proj_mat", invert(stereo_proj_mat_z_up[1]), 1);
-
-        LMatrix4 stereo_view_mat_inv[2] = { view_mat[0], view_mat[1] };
-        stereo_view_mat_inv[0].invert_in_place();
-        stereo_view_mat_inv[1].invert_in_place();
-
-        // Remove jitter and set the new view projection mat
-        stereo_proj_mat[0].set_cell(1, 0, 0.0);
-        stereo_proj_mat[0].set_cell(1, 1, 0.0);
-        input_ubo_->update_input("stereo_view_proj_mat_no_jitter", view_mat[0] * stereo_proj_mat[0], 0);
-
-        stereo_proj_mat[1].set_cell(1, 0, 0.0);
-        stereo_proj_mat[1].set_cell(1, 1, 0.0);
-        input_ubo_->update_input("stereo_view_proj_mat_no_jitter", view_mat[1] * stereo_proj_mat[1], 1);
-
-        // Compute frustum corners in the order BL, BR, TL, TR
-        // XXX: DO NOT compute frustum calculation in stereo.
-        // Stereoscopic projection matrix is NOT symmetric.
+            // XXX: DO NOT compute frustum calculation in stereo.
+            // Stereoscopic projection matrix is NOT symmetric.
+            update_camera_inputs(eye, camera_matrices_.update(eye, view_mat, stereo_proj_mat[eye]));
+        }
     }
     else
     {
         // Get the current transform matrix of the camera
         const LMatrix4& view_mat = Globals::render.get_transform(showbase_->get_cam())->get_mat();
 
-        // Compute the view matrix, but with a z-up coordinate system
-        const LMatrix4& zup_conversion = LMatrix4::z_to_y_up_mat();
-        input_ubo_->update_input("view_mat_z_up", view_mat * zup_conversion);
-
-        // Compute the view matrix without the camera rotation
-        LMatrix4 view_mat_billboard(view_mat);
-        view_mat_billboard.set_row(0, LVecBase3(1, 0, 0));
-        view_mat_billboard.set_row(1, LVecBase3(0, 1, 0));
-        view_mat_billboard.set_row(2, LVecBase3(0, 0, 1));
-        input_ubo_->update_input("view_mat_billboard", view_mat_billboard);
-
-        input_ubo_->update_input("camera_pos", showbase_->get_cam().get_pos(Globals::render));
-
-        // Compute last view projection mat
-        const LMatrix4& curr_vp_value = boost::get<const PTA_LMatrix4f&>(input_ubo_->get_input("view_proj_mat_no_jitter"))[0];
-        input_ubo_->update_input("last_view_proj_mat_no_jitter", curr_vp_value);
-        LMatrix4 curr_vp = curr_vp_value;
-        curr_vp.invert_in_place();
-        const LMatrix4 curr_inv_vp = curr_vp;
-        input_ubo_->update_input("last_inv_view_proj_mat_no_jitter", curr_inv_vp);
-
-        LMatrix4 proj_mat = showbase_->get_cam_lens()->get_projection_mat();
-
-        // Set the projection matrix as an input, but convert it to the correct
-        // coordinate system before.
-        const LMatrix4& proj_mat_zup = LMatrix4::y_to_z_up_mat() * proj_mat;
-        input_ubo_->update_input("proj_mat", proj_mat_zup);
-
-        // Set the inverse projection matrix
-        input_ubo_->update_input("inv_proj_mat", invert(proj_mat_zup));
-
-        // Remove jitter and set the new view projection mat
-        proj_mat.set_cell(1, 0, 0.0);
-        proj_mat.set_cell(1, 1, 0.0);
-        input_ubo_->update_input("view_proj_mat_no_jitter", view_mat * proj_mat);
-
-        // Compute frustum corners in the order BL, BR, TL, TR
-        LMatrix4 ws_frustum_directions;
-        LMatrix4 vs_frustum_directions;
-        const LMatrix4& inv_proj_mat = Globals::base->get_cam_lens()->get_projection_mat_inv();
-        LMatrix4 view_mat_inv(view_mat);
-        view_mat_inv.invert_in_place();
-
-        for (size_t i = 0; i < std::extent<decltype(points)>::value; ++i)
-        {
-            const LVecBase4& result = inv_proj_mat.xform(LVecBase4(points[i][0], points[i][1], 1.0, 1.0));
-            const LVecBase3& vs_dir = (zup_conversion.xform(result)).get_xyz().normalized();
-            vs_frustum_directions.set_row(i, LVecBase4(vs_dir, 1));
-            const LVecBase4& ws_dir = view_mat_inv.xform(LVecBase4(result.get_xyz(), 0));
-            ws_frustum_directions.set_row(i, ws_dir);
-        }
-
-        input_ubo_->update_input("vs_frustum_directions", vs_frustum_directions);
-        input_ubo_->update_input("ws_frustum_directions", ws_frustum_directions);
+        update_camera_inputs(0, camera_matrices_.update(0, view_mat, cam_lens->get_projection_mat(), true));
     }
 
     // Store the frame delta
-    input_ubo_->update_input("frame_delta", static_cast<float>(Globals::clock->get_dt()));
-    input_ubo_->update_input("smooth_frame_delta", static_cast<float>(1.0 / (std::max)(1e-5, Globals::clock->get_average_frame_rate())));
-    input_ubo_->update_input("frame_time", static_cast<float>(Globals::clock->get_frame_time()));
+    frame_inputs_.frame_delta[0] = static_cast<float>(Globals::clock->get_dt());
+    frame_inputs_.smooth_frame_delta[0] = static_cast<float>(1.0 / (std::max)(1e-5, Globals::clock->get_average_frame_rate()));
+    frame_inputs_.frame_time[0] = static_cast<float>(Globals::clock->get_frame_time());
 
     // Store the current film offset, we use this to compute the pixel-perfect
     // velocity, which is otherwise not possible.Usually this is always 0
     // except when SMAA and reprojection is enabled
-    input_ubo_->update_input("current_film_offset", showbase_->get_cam_lens()->get_film_offset());
-    input_ubo_->update_input("frame_index", Globals::clock->get_frame_count());
+    frame_inputs_.current_film_offset[0] = cam_lens->get_film_offset();
+    frame_inputs_.frame_index[0] = Globals::clock->get_frame_count();
+
+    frame_inputs_.screen_size[0] = Globals::resolution;
+    frame_inputs_.native_screen_size[0] = Globals::native_resolution;
+    frame_inputs_.lc_tile_count[0] = pipeline_.get_light_mgr()->get_num_tiles();
+}
+
+void CommonResources::update_camera_inputs(size_t eye, int changed)
+{
+    const CameraMatrices::Eye& matrices = camera_matrices_.get_eye(eye);
+    FrameInputs& inputs = frame_inputs_;
+
+    if (changed & CameraMatrices::CF_view)
+    {
+        inputs.camera_pos[eye] = matrices.camera_pos;
+        inputs.view_mat_z_up[eye] = matrices.view_mat_z_up;
+        inputs.view_mat_billboard[eye] = matrices.view_mat_billboard;
+        if (!inputs.view_matrix.empty())
+            inputs.view_matrix[eye] = matrices.view_mat;
+    }
+
+    if (changed & CameraMatrices::CF_projection)
+    {
+        inputs.proj_mat[eye] = matrices.proj_mat_z_up;
+        inputs.inv_proj_mat[eye] = matrices.inv_proj_mat_z_up;
+        if (!inputs.projection_matrix.empty())
+            inputs.projection_matrix[eye] = matrices.proj_mat;
+    }
+
+    if (changed & (CameraMatrices::CF_view | CameraMatrices::CF_projection))
+    {
+        inputs.view_proj_mat_no_jitter[eye] = matrices.view_proj_mat_no_jitter;
+        if (!inputs.view_projection_matrix.empty())
+        {
+            inputs.view_projection_matrix[eye] = matrices.view_proj_mat;
+            inputs.view_projection_matrix_inverse[eye] = matrices.view_proj_mat_inv;
+        }
+        if (!inputs.vs_frustum_directions.empty())
+        {
+            inputs.vs_frustum_directions[eye] = matrices.vs_frustum_directions;
+            inputs.ws_frustum_directions[eye] = matrices.ws_frustum_directions;
+        }
+    }
 
-    input_ubo_->update_input("screen_size", Globals::resolution);
-    input_ubo_->update_input("native_screen_size", Globals::native_resolution);
-    input_ubo_->update_input("lc_tile_count", pipeline_.get_light_mgr()->get_num_tiles());
+    if (changed & CameraMatrices::CF_last_view_projection)
+    {
+        inputs.last_view_proj_mat_no_jitter[eye] = matrices.last_view_proj_mat_no_jitter;
+        inputs.last_inv_view_proj_mat_no_jitter[eye] = matrices.last_inv_view_proj_mat_no_jitter;
+    }
 }
 
 void CommonResources::load_fonts()
@@ -396,6 +299,43 @@ void CommonResources::setup_inputs()
 
     pipeline_.get_stage_mgr()->add_input_blocks(input_ubo_);
 
+    // Keep the handles of the inputs which are updated every frame.
+    const auto get_pta = [this](const std::string& name, auto& pta) {
+        pta = boost::get<const std::decay_t<decltype(pta)>&>(input_ubo_->get_input(name));
+    };
+
+    const std::string prefix(stereo_mode ? "stereo_" : "");
+    get_pta(prefix + "camera_pos", frame_inputs_.camera_pos);
+    get_pta(prefix + "view_mat_z_up", frame_inputs_.view_mat_z_up);
+    get_pta(prefix + "view_mat_billboard", frame_inputs_.view_mat_billboard);
+    get_pta(prefix + "view_proj_mat_no_jitter", frame_inputs_.view_proj_mat_no_jitter);
+    get_pta(prefix + "last_view_proj_mat_no_jitter", frame_inputs_.last_view_proj_mat_no_jitter);
+    get_pta(prefix + "last_inv_view_proj_mat_no_jitter", frame_inputs_.last_inv_view_proj_mat_no_jitter);
+    get_pta(prefix + "proj_mat", frame_inputs_.proj_mat);
+    get_pta(prefix + "inv_proj_mat", frame_inputs_.inv_proj_mat);
+
+    if (stereo_mode)
+    {
+        get_pta("stereo_ViewMatrix", frame_inputs_.view_matrix);
+        get_pta("stereo_ProjectionMatrix", frame_inputs_.projection_matrix);
+        get_pta("stereo_ViewProjectionMatrix", frame_inputs_.view_projection_matrix);
+        get_pta("stereo_ViewProjectionMatrixInverse", frame_inputs_.view_projection_matrix_inverse);
+    }
+    else
+    {
+        get_pta("vs_frustum_directions", frame_inputs_.vs_frustum_directions);
+        get_pta("ws_frustum_directions", frame_inputs_.ws_frustum_directions);
+    }
+
+    get_pta("frame_delta", frame_inputs_.frame_delta);
+    get_pta("smooth_frame_delta", frame_inputs_.smooth_frame_delta);
+    get_pta("frame_time", frame_inputs_.frame_time);
+    get_pta("current_film_offset", frame_inputs_.current_film_offset);
+    get_pta("frame_index", frame_inputs_.frame_index);
+    get_pta("screen_size", frame_inputs_.screen_size);
+    get_pta("native_screen_size", frame_inputs_.native_screen_size);
+    get_pta("lc_tile_count", frame_inputs_.lc_tile_count);
+
     if (!stereo_mode)
     {
         // Main camera and main render have to be regular inputs, since they are
@@ -26,6 +26,7 @@
 
 #include <render_pipeline/rpcore/rpobject.hpp>
 #include <render_pipeline/rpcore/util/shader_input_blocks.hpp>
+#include <render_pipeline/rpcore/util/camera_matrices.hpp>
 
 namespace rppanda {
 class ShowBase;
@@ -72,9 +73,47 @@ private:
     /** Loads the skydome. */
     void load_skydome();
 
+    /** Writes the changed camera matrices of an eye to the inputs. */
+    void update_camera_inputs(size_t eye, int changed);
+
     RenderPipeline& pipeline_;
     rppanda::ShowBase* showbase_;
     std::shared_ptr<GroupedInputBlock> input_ubo_;
+
+    CameraMatrices camera_matrices_;
+
+    // Handles of the inputs which are updated every frame, to avoid lookup by name.
+    // Inputs which are not used in the current mode are empty.
+    struct FrameInputs
+    {
+        PTA_LVecBase3f camera_pos;
+        PTA_LMatrix4f view_mat_z_up;
+        PTA_LMatrix4f view_mat_billboard;
+        PTA_LMatrix4f view_proj_mat_no_jitter;
+        PTA_LMatrix4f last_view_proj_mat_no_jitter;
+        PTA_LMatrix4f last_inv_view_proj_mat_no_jitter;
+        PTA_LMatrix4f proj_mat;
+        PTA_LMatrix4f inv_proj_mat;
+
+        PTA_LMatrix4f view_matrix;
+        PTA_LMatrix4f projection_matrix;
+        PTA_LMatrix4f view_projection_matrix;
+        PTA_LMatrix4f view_projection_matrix_inverse;
+
+        PTA_LMatrix4f vs_frustum_directions;
+        PTA_LMatrix4f ws_frustum_directions;
+
+        PTA_float frame_delta;
+        PTA_float smooth_frame_delta;
+        PTA_float frame_time;
+        PTA_LVecBase2f current_film_offset;
+        PTA_int frame_index;
+        PTA_LVecBase2i screen_size;
+        PTA_LVecBase2i native_screen_size;
+        PTA_LVecBase2i lc_tile_count;
+    };
+
+    FrameInputs frame_inputs_;
 };
 
 }
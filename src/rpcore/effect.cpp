@@ -33,6 +33,7 @@
 #include <boost/algorithm/string.hpp>
 
 #include "render_pipeline/rppanda/stdpy/file.hpp"
+#include "render_pipeline/rpcore/mount_manager.hpp"
 #include "render_pipeline/rppanda/showbase/showbase.hpp"
 #include "render_pipeline/rpcore/render_pipeline.hpp"
 #include "render_pipeline/rpcore/globals.hpp"
@@ -395,20 +396,16 @@ std::string Effect::Impl::process_shader_template(Effect& self, const Filename&
         self.warn(std::string("Hook '") + key_val.first + "' not found in template '" + template_src.to_os_generic() + "'!");
 
     // Write the constructed shader and load it back
-    const std::string& temp_path = std::string("/$$rptemp/$$effect-") + cache_key + ".glsl";
+    // The name is content-addressed, so unchanged shaders are reused across runs and instances.
+    std::string shader_content;
+    for (const auto& line: parsed_lines)
+        shader_content += line + "\n";
 
-    try
-    {
-        auto file = rppanda::open_write_file(temp_path, false, true);
-        for (const auto& shader_content: parsed_lines)
-            *file << shader_content << std::endl;
-    }
-    catch (const std::exception& err)
-    {
-        self.error(std::string("Error writing processed shader: ") + err.what());
-    }
+    const Filename& temp_path = MountManager::store_cache_file("effect-" + cache_key, shader_content, ".glsl");
+    if (temp_path.empty())
+        self.error("Error writing processed shader");
 
-    return temp_path;
+    return temp_path.get_fullpath();
 }
 
 // ************************************************************************************************
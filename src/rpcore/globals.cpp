@@ -34,6 +34,7 @@ ClockObject* Globals::clock = nullptr;
 LVecBase2i Globals::resolution;
 LVecBase2i Globals::native_resolution;
 TextFont* Globals::font = nullptr;
+bool Globals::headless = false;
 
 void Globals::load(rppanda::ShowBase* showbase)
 {
@@ -49,6 +50,7 @@ void Globals::unload()
     Globals::render.clear();
     Globals::clock = nullptr;
     Globals::font = nullptr;
+    Globals::headless = false;
 }
 
 }
@@ -78,14 +78,15 @@ void GPUCommandQueue::register_defines()
     defines["CMD_remove_light"] = std::to_string(GPUCommand::CommandType::CMD_remove_light);
     defines["CMD_store_source"] = std::to_string(GPUCommand::CommandType::CMD_store_source);
     defines["CMD_remove_sources"] = std::to_string(GPUCommand::CommandType::CMD_remove_sources);
-    defines["GPU_CMD_INT_AS_FLOAT"] = std::string(GPUCommand::get_uses_integer_packing() ? "1": "0");
+    // Integers in the light data are stored as float values, not as their binary representation
+    defines["GPU_CMD_INT_AS_FLOAT"] = "0";
 }
 
 void GPUCommandQueue::create_data_storage()
 {
-    int command_buffer_size = commands_per_frame_ * 32;
+    int command_buffer_size = commands_per_frame_ * GPU_COMMAND_ENTRIES;
     debug(std::string("Allocating command buffer of size ") + std::to_string(command_buffer_size));
-    data_texture_ = Image::create_buffer("CommandQueue", command_buffer_size, "R32");
+    data_texture_ = Image::create_buffer("CommandQueue", command_buffer_size, "R32UI");
 }
 
 void GPUCommandQueue::create_command_target()
@@ -37,6 +37,7 @@
 #include "render_pipeline/rpcore/gui/labeled_checkbox.hpp"
 #include "render_pipeline/rpcore/render_target.hpp"
 #include "render_pipeline/rpcore/image.hpp"
+#include "render_pipeline/rpcore/resource_registry.hpp"
 
 #include "rpcore/gui/texture_preview.hpp"
 #include "rpcore/util/display_shader_builder.hpp"
@@ -71,43 +72,26 @@ std::vector<BufferViewer::EntryType> BufferViewer::get_entries() const
 {
     std::vector<BufferViewer::EntryType> entries;
 
-    for (const auto& target: RenderTarget::REGISTERED_TARGETS)
-        entries.push_back({target, EntryID::RENDER_TARGET});
-
-    for (const auto& image: Image::REGISTERED_IMAGES)
-        entries.push_back({image, EntryID::TEXTURE});
+    for (const auto& entry: ResourceRegistry::get_global_instance().get_entries())
+    {
+        if (entry.type == ResourceRegistry::ResourceType::render_target)
+            entries.push_back({entry.resource, EntryID::RENDER_TARGET});
+        else
+            entries.push_back({entry.resource, EntryID::TEXTURE});
+    }
 
     return entries;
 }
 
 std::pair<size_t, int> BufferViewer::get_stage_information() const
 {
-    int count = 0;
-    size_t memory = 0;
+    const auto& registry = ResourceRegistry::get_global_instance();
 
-    const auto& entries = get_entries();
-    for (const auto& entry: entries)
-    {
-        if (entry.second == EntryID::TEXTURE)
-        {
-            memory += reinterpret_cast<Image*>(entry.first)->get_texture()->estimate_texture_memory();
-            ++count;
-        }
-        else if (entry.second == EntryID::RENDER_TARGET)
-        {
-            for (const auto& id_target: reinterpret_cast<RenderTarget*>(entry.first)->get_targets())
-            {
-                memory += id_target.second->estimate_texture_memory();
-                ++count;
-            }
-        }
-        else
-        {
-            warn(fmt::format("Unknown type: {}", static_cast<int>(entry.second)));
-        }
-    }
+    int count = 0;
+    for (const auto& entry: registry.get_entries())
+        count += int(entry.get_textures().size());
 
-    return {memory, count};
+    return {registry.get_total_bytes(), count};
 }
 
 void BufferViewer::create_components()
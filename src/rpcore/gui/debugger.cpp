@@ -41,6 +41,7 @@
 #include "render_pipeline/rpcore/gui/sprite.hpp"
 #include "render_pipeline/rpcore/gui/error_message_display.hpp"
 #include "render_pipeline/rpcore/render_target.hpp"
+#include "render_pipeline/rpcore/resource_registry.hpp"
 #include "render_pipeline/rpcore/util/task_scheduler.hpp"
 #include "render_pipeline/rpcore/pluginbase/manager.hpp"
 #include "render_pipeline/rpcore/pluginbase/day_manager.hpp"
@@ -336,12 +337,15 @@ AsyncTask::DoneStatus Debugger::update_stats(rppanda::FunctionalTask* task)
         return task ? AsyncTask::DS_again : AsyncTask::DS_done;
 
     const auto& light_mgr = pipeline->get_light_mgr();
+    const auto& state_cache_stats = pipeline->get_state_cache_stats();
 
     debug_lines_[1]->set_text(fmt::format(
-        "{:4d} states |  {:4d} transforms |  {:4d} cmds |  {:4d} lights |  {:4d} shadow |  {:5.1f}% atlas usage",
+        "{:4d} states |  {:4d} transforms |  {:4d} purged ({:3.2f} ms) |  {:4d} cmds |  {:4d} lights |  {:4d} shadow |  {:5.1f}% atlas usage",
 
-        RenderState::get_num_states(),
-        TransformState::get_num_states(),
+        state_cache_stats.render_states,
+        state_cache_stats.transform_states,
+        state_cache_stats.purged_states,
+        state_cache_stats.purge_time,
         light_mgr->get_cmd_queue()->get_num_processed_commands(),
         light_mgr->get_num_lights(),
         light_mgr->get_num_shadow_sources(),
@@ -349,11 +353,14 @@ AsyncTask::DoneStatus Debugger::update_stats(rppanda::FunctionalTask* task)
 
     const auto& tex_memory_count = buffer_viewer_->get_stage_information();
 
+    const auto& registry = ResourceRegistry::get_global_instance();
+
     int views = 0;
     int active_views = 0;
-    for (const auto& target: RenderTarget::REGISTERED_TARGETS)
+    for (const auto& entry: registry.get_entries())
     {
-        if (!target->get_create_default_region())
+        auto target = entry.get_render_target();
+        if (target && !target->get_create_default_region())
         {
             int num_regions = target->get_internal_buffer()->get_num_display_regions();
             for (int i = 0; i < num_regions; ++i)
@@ -371,12 +378,13 @@ AsyncTask::DoneStatus Debugger::update_stats(rppanda::FunctionalTask* task)
 
     debug_lines_[2]->set_text(fmt::format(
         "Internal:  {:3.0f} MB VRAM  |  {:5d} img |  {:5d} tex |  "
-        "{:5d} fbos |  {:3d} plugins |  {:2d}  views  ({:2d} active)",
+        "{:5d} fbos ({:3d} switches) |  {:3d} plugins |  {:2d}  views  ({:2d} active)",
 
         (tex_memory_count.first / (1024.0f*1024.0f)),
-        Image::REGISTERED_IMAGES.size(),
+        registry.get_num_images(),
         tex_memory_count.second,
-        RenderTarget::REGISTERED_TARGETS.size(),
+        registry.get_num_render_targets(),
+        RenderTarget::get_num_active_buffers(),
         pipeline->get_plugin_mgr()->get_enabled_plugins().size(),
         views,
         active_views
@@ -409,7 +417,7 @@ AsyncTask::DoneStatus Debugger::update_stats(rppanda::FunctionalTask* task)
     const LPoint3& camera_global_pos = camera.get_pos(render);
 
     debug_lines_[4]->set_text(fmt::format(
-        "Time: {} ({:1.3f}) |  Sun  {:0.2f} {:0.2f} {:0.2f} |  X {:4.2f}  Y {:4.2f}  Z {:4.2f} |  {:2d} tasks |  scheduled: {:2d}",
+        "Time: {} ({:1.3f}) |  Sun  {:0.2f} {:0.2f} {:0.2f} |  X {:4.2f}  Y {:4.2f}  Z {:4.2f} |  {:2d} tasks |  scheduled: {:2d} |  deferred: {:2d}",
 
         pipeline->get_daytime_mgr()->get_formatted_time(),
         pipeline->get_daytime_mgr()->get_time(),
@@ -418,7 +426,8 @@ AsyncTask::DoneStatus Debugger::update_stats(rppanda::FunctionalTask* task)
         camera_global_pos[1],
         camera_global_pos[2],
         pipeline->get_task_scheduler()->get_num_tasks(),
-        pipeline->get_task_scheduler()->get_num_scheduled_tasks()
+        pipeline->get_task_scheduler()->get_num_scheduled_tasks(),
+        pipeline->get_task_scheduler()->get_num_deferred_tasks()
     ));
 
     static std::string debug_lines_5_text;
@@ -37,9 +37,10 @@ const std::unordered_map<std::string, Image::ComponentFormatType> Image::FORMAT_
     { "R16UI",      { Texture::T_unsigned_short, Texture::F_r16i } },
     { "R32",        { Texture::T_float, Texture::F_r32 } },
     { "R32I",       { Texture::T_int, Texture::F_r32i } },
+    { "R32UI",      { Texture::T_unsigned_int, Texture::F_r32i } },
 };
 
-std::vector<Image*> Image::REGISTERED_IMAGES;
+const ResourceRegistry::ImageView Image::REGISTERED_IMAGES{};
 
 std::unique_ptr<Image> Image::create_buffer(const std::string& name, int size, const std::string& component_format)
 {
@@ -146,7 +147,7 @@ Image::Image(const std::string& name): texture_(Texture::make_texture())
 {
     texture_->set_name(name);
 
-    Image::REGISTERED_IMAGES.push_back(this);
+    registry_handle_ = ResourceRegistry::get_global_instance().register_image(this);
     texture_->set_clear_color(0);
     texture_->clear_image();
     sort_ = RenderTarget::CURRENT_SORT;
@@ -154,7 +155,7 @@ Image::Image(const std::string& name): texture_(Texture::make_texture())
 
 Image::~Image()
 {
-    Image::REGISTERED_IMAGES.erase(std::find(Image::REGISTERED_IMAGES.begin(), Image::REGISTERED_IMAGES.end(), this));
+    ResourceRegistry::get_global_instance().unregister(registry_handle_);
 }
 
 }
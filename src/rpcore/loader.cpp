@@ -22,10 +22,12 @@
 
 #include "render_pipeline/rpcore/loader.hpp"
 
+#include <algorithm>
+#include <atomic>
 #include <chrono>
+#include <cstring>
 
-#include <pnmImage.h>
-#include <virtualFileMountRamdisk.h>
+#include <texturePool.h>
 
 #include <boost/algorithm/string/join.hpp>
 
@@ -34,7 +36,9 @@
 #include "render_pipeline/rpcore/globals.hpp"
 #include "render_pipeline/rppanda/showbase/showbase.hpp"
 #include "render_pipeline/rppanda/showbase/loader.hpp"
+#include "render_pipeline/rppanda/task/task_manager.hpp"
 #include "render_pipeline/rppanda/stdpy/file.hpp"
+#include "render_pipeline/rpcore/util/raw_texture_file.hpp"
 
 namespace rpcore {
 
@@ -61,16 +65,16 @@ public:
 private:
     void enter()
     {
-        start_time_ = std::chrono::system_clock::now();
+        start_time_ = std::chrono::steady_clock::now();
     }
 
     void exit()
     {
-        float duration = (std::chrono::duration<float>(std::chrono::system_clock::now() - start_time_)).count();
-        if (duration > 80.0f && WARNING_COUNT < 5)
+        const double duration = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start_time_).count();
+        if (duration > 80.0 && WARNING_COUNT < 5)
         {
             RPObject::global_warn("RPLoader",
-                fmt::format("Loading '{}' took {} ms", resource_.to_os_specific(), (std::round(duration * 100.0f) / 100.0f)));
+                fmt::format("Loading '{}' took {:.2f} ms", resource_.to_os_specific(), duration));
             ++WARNING_COUNT;
             if (WARNING_COUNT == 5)
             {
@@ -81,11 +85,250 @@ private:
     }
 
     Filename resource_;
-    std::chrono::system_clock::time_point start_time_;
+    std::chrono::steady_clock::time_point start_time_;
 };
 
 int TimedLoadingOperation::WARNING_COUNT = 0;
 
+// ************************************************************************************************
+
+class RPLoader::AsyncTexture::Impl
+{
+public:
+    enum class State
+    {
+        queued,
+        loaded,         ///< mipmap images are ready to be streamed in.
+        done,
+        cancelled,
+        failed,
+    };
+
+    Filename filename_;
+    PT(Texture) texture_;
+    PT(AsyncTask) task_;
+    float priority_ = 0.0f;
+    std::atomic<State> state_{ State::queued };
+
+    // written by the loader thread before the state becomes loaded.
+    std::vector<CPTA_uchar> images_;
+    std::vector<LVecBase2i> sizes_;
+    Texture::ComponentType component_type_;
+    Texture::Format format_;
+
+    int resident_level_ = -1;
+};
+
+/** Streams in the textures loaded by RPLoader::load_texture_async. */
+class TextureStreamer
+{
+public:
+    static constexpr const char* task_chain_name = "RP_TextureStreaming";
+    static constexpr const char* upload_task_name = "RP_TextureStreamingUpload";
+
+    /** Upload only levels up to this size first. */
+    static constexpr int mipmap_tail_size = 64;
+
+    using AsyncTexture = RPLoader::AsyncTexture;
+    using State = AsyncTexture::Impl::State;
+
+    static TextureStreamer& get_instance()
+    {
+        static TextureStreamer instance;
+        return instance;
+    }
+
+    void add(const std::shared_ptr<AsyncTexture>& request);
+
+    size_t upload_budget_ = 4 * 1024 * 1024;
+
+private:
+    static AsyncTask::DoneStatus load(AsyncTexture::Impl& impl);
+    AsyncTask::DoneStatus upload(rppanda::FunctionalTask* task);
+
+    /** Add @p level into the texture, or the whole mipmap tail from @p level if nothing is resident. */
+    static void apply_level(AsyncTexture::Impl& impl, int level);
+
+    std::vector<std::shared_ptr<AsyncTexture>> requests_;
+};
+
+void TextureStreamer::add(const std::shared_ptr<AsyncTexture>& request)
+{
+    auto task_mgr = Globals::base->get_task_mgr();
+    if (!task_mgr->has_task_chain(task_chain_name))
+        task_mgr->setup_task_chain(task_chain_name, 1);
+
+    auto impl = request->impl_.get();
+    std::weak_ptr<AsyncTexture> weak_request = request;
+    impl->task_ = task_mgr->add([weak_request](rppanda::FunctionalTask*) {
+        if (auto request = weak_request.lock())
+            return TextureStreamer::load(*request->impl_);
+        return AsyncTask::DS_done;
+    }, "RP_LoadTextureAsync", 0, {}, int(impl->priority_ * 1000), std::string(task_chain_name));
+
+    requests_.push_back(request);
+
+    if (!task_mgr->has_task_named(upload_task_name))
+        task_mgr->add(std::bind(&TextureStreamer::upload, this, std::placeholders::_1), upload_task_name, 9);
+}
+
+AsyncTask::DoneStatus TextureStreamer::load(AsyncTexture::Impl& impl)
+{
+    if (impl.state_ != State::queued)
+        return AsyncTask::DS_done;
+
+    PT(Texture) source = new Texture(impl.filename_.get_basename());
+    if (!source->read(impl.filename_))
+    {
+        RPObject::global_error("RPLoader", fmt::format("Failed to load texture '{}'", impl.filename_.to_os_specific()));
+        impl.state_ = State::failed;
+        return AsyncTask::DS_done;
+    }
+
+    source->uncompress_ram_image();
+    source->generate_ram_mipmap_images();
+
+    const int num_levels = source->get_num_ram_mipmap_images();
+    impl.images_.reserve(num_levels);
+    impl.sizes_.reserve(num_levels);
+    for (int level = 0; level < num_levels; ++level)
+    {
+        impl.images_.push_back(source->get_ram_mipmap_image(level));
+        impl.sizes_.emplace_back(source->get_expected_mipmap_x_size(level), source->get_expected_mipmap_y_size(level));
+    }
+    impl.component_type_ = source->get_component_type();
+    impl.format_ = source->get_format();
+
+    State expected = State::queued;
+    impl.state_.compare_exchange_strong(expected, State::loaded);
+
+    return AsyncTask::DS_done;
+}
+
+AsyncTask::DoneStatus TextureStreamer::upload(rppanda::FunctionalTask*)
+{
+    std::stable_sort(requests_.begin(), requests_.end(), [](const auto& lhs, const auto& rhs) {
+        return lhs->impl_->priority_ > rhs->impl_->priority_;
+    });
+
+    size_t uploaded_bytes = 0;
+    for (auto& request: requests_)
+    {
+        auto& impl = *request->impl_;
+        if (impl.state_ != State::loaded)
+            continue;
+
+        // start from the mipmap tail, and then the next finer level.
+        int level;
+        if (impl.resident_level_ < 0)
+        {
+            level = int(impl.sizes_.size()) - 1;
+            while (level > 0 && (std::max)(impl.sizes_[level - 1][0], impl.sizes_[level - 1][1]) <= mipmap_tail_size)
+                --level;
+        }
+        else
+        {
+            level = impl.resident_level_ - 1;
+        }
+
+        // only the new levels are added to the texture.
+        size_t level_bytes = 0;
+        const int level_end = impl.resident_level_ < 0 ? int(impl.images_.size()) : impl.resident_level_;
+        for (int k = level; k < level_end; ++k)
+            level_bytes += impl.images_[k].size();
+
+        // upload at least one level per frame.
+        if (uploaded_bytes > 0 && uploaded_bytes + level_bytes > upload_budget_)
+            break;
+
+        apply_level(impl, level);
+        uploaded_bytes += level_bytes;
+
+        if (level == 0)
+        {
+            impl.state_ = State::done;
+            impl.images_.clear();
+            impl.sizes_.clear();
+        }
+    }
+
+    requests_.erase(std::remove_if(requests_.begin(), requests_.end(), [](const auto& request) {
+        const auto state = request->impl_->state_.load();
+        return state != State::queued && state != State::loaded;
+    }), requests_.end());
+
+    return requests_.empty() ? AsyncTask::DS_done : AsyncTask::DS_cont;
+}
+
+void TextureStreamer::apply_level(AsyncTexture::Impl& impl, int level)
+{
+    Texture* texture = impl.texture_;
+    if (impl.resident_level_ < 0)
+    {
+        // set up the final size once, and the finer levels are added later.
+        texture->setup_2d_texture(impl.sizes_[0][0], impl.sizes_[0][1], impl.component_type_, impl.format_);
+        texture->clear_image();
+        if (impl.images_.size() > 1)
+            texture->set_minfilter(SamplerState::FT_linear_mipmap_linear);
+        for (size_t k = level + 1, k_end = impl.images_.size(); k < k_end; ++k)
+            texture->set_ram_mipmap_image(int(k), impl.images_[k]);
+    }
+
+    texture->set_ram_mipmap_image(level, impl.images_[level]);
+
+    // do not sample the levels which are not resident yet.
+    texture->set_min_lod(PN_stdfloat(level));
+    impl.resident_level_ = level;
+}
+
+RPLoader::AsyncTexture::AsyncTexture(std::unique_ptr<Impl> impl): impl_(std::move(impl))
+{
+}
+
+RPLoader::AsyncTexture::~AsyncTexture() = default;
+
+Texture* RPLoader::AsyncTexture::get_texture() const
+{
+    return impl_->texture_;
+}
+
+bool RPLoader::AsyncTexture::is_done() const
+{
+    const auto state = impl_->state_.load();
+    return state == Impl::State::done || state == Impl::State::failed;
+}
+
+int RPLoader::AsyncTexture::get_resident_level() const
+{
+    return impl_->resident_level_;
+}
+
+float RPLoader::AsyncTexture::get_priority() const
+{
+    return impl_->priority_;
+}
+
+void RPLoader::AsyncTexture::set_priority(float priority)
+{
+    impl_->priority_ = priority;
+    if (impl_->state_ == Impl::State::queued && impl_->task_)
+        impl_->task_->set_priority(int(priority * 1000));
+}
+
+void RPLoader::AsyncTexture::cancel()
+{
+    auto expected = Impl::State::queued;
+    if (!impl_->state_.compare_exchange_strong(expected, Impl::State::cancelled))
+    {
+        expected = Impl::State::loaded;
+        if (!impl_->state_.compare_exchange_strong(expected, Impl::State::cancelled))
+            return;
+    }
+
+    if (impl_->task_)
+        impl_->task_->remove();
+}
+
 // ************************************************************************************************
 Texture* RPLoader::load_texture(const Filename& filename)
 {
@@ -94,6 +337,33 @@ Texture* RPLoader::load_texture(const Filename& filename)
     return Globals::base->get_loader()->load_texture(filename);
 }
 
+std::shared_ptr<RPLoader::AsyncTexture> RPLoader::load_texture_async(const Filename& filename, float priority)
+{
+    auto impl = std::make_unique<AsyncTexture::Impl>();
+    impl->filename_ = filename;
+    impl->priority_ = priority;
+
+    // 1x1 placeholder until the mipmap tail is loaded.
+    impl->texture_ = new Texture(filename.get_basename());
+    impl->texture_->setup_2d_texture(1, 1, Texture::T_unsigned_byte, Texture::F_rgba8);
+    impl->texture_->set_clear_color(LColor(0.5f, 0.5f, 0.5f, 1.0f));
+
+    auto request = std::make_shared<AsyncTexture>(std::move(impl));
+    TextureStreamer::get_instance().add(request);
+
+    return request;
+}
+
+void RPLoader::set_texture_upload_budget(size_t bytes_per_frame)
+{
+    TextureStreamer::get_instance().upload_budget_ = bytes_per_frame;
+}
+
+size_t RPLoader::get_texture_upload_budget()
+{
+    return TextureStreamer::get_instance().upload_budget_;
+}
+
 Texture* RPLoader::load_cube_map(const Filename& filename, bool read_mipmaps)
 {
     TimedLoadingOperation tlo(filename);
@@ -108,6 +378,13 @@ Texture* RPLoader::load_3d_texture(const Filename& filename)
     return Globals::base->get_loader()->load_3d_texture(filename);
 }
 
+PT(Texture) RPLoader::load_raw_texture(const Filename& filename)
+{
+    TimedLoadingOperation tlo(filename);
+
+    return RawTextureFile::read(filename);
+}
+
 PT(Shader) RPLoader::load_shader(const std::vector<Filename>& path_args)
 {
     TimedLoadingOperation tlo(rppanda::join_to_string(path_args));
@@ -154,38 +431,76 @@ Texture* RPLoader::load_sliced_3d_texture(const Filename& filename, int tile_siz
 {
     TimedLoadingOperation tlo(filename);
 
-    double epoch_time = std::chrono::duration_cast<std::chrono::duration<double>>(std::chrono::system_clock::now().time_since_epoch()).count();
-    const std::string tempfile_name = std::string("/$$slice_loader_temp-") + std::to_string(epoch_time) + "/";
-
     // Load sliced image from disk
-    PT(Texture) tex_handle = RPLoader::load_texture(filename);
-    PNMImage source;
-    tex_handle->store(source);
-    int width = source.get_x_size();
+    const bool source_pooled = TexturePool::has_texture(filename);
+    PT(Texture) source = RPLoader::load_texture(filename);
+    if (!source)
+    {
+        RPObject::global_error("RPLoader", fmt::format("Failed to load sliced texture '{}'", filename.to_os_specific()));
+        return nullptr;
+    }
 
-    // Find slice properties
-    int num_cols = width / tile_size_x;
-    PNMImage temp_img(tile_size_x, tile_size_y, source.get_num_channels(), source.get_maxval());
+    // The source is only used to build the 3D texture, so do not keep it in the pool
+    // unless it was already loaded by someone else.
+    if (!source_pooled)
+        TexturePool::release_texture(source);
+
+    PT(Texture) texture = RPLoader::create_sliced_3d_texture(source, tile_size_x, tile_size_y, num_tiles);
+    if (!texture)
+        return nullptr;
 
-    // Construct a ramdisk to write the files to
-    VirtualFileSystem* vfs = VirtualFileSystem::get_global_ptr();
-    PT(VirtualFileMountRamdisk) ramdisk = new VirtualFileMountRamdisk;
-    vfs->mount(ramdisk, Filename(tempfile_name), 0);
+    // The pool owns the 3D texture like the textures from the other load functions.
+    // It must not share the key of the source texture.
+    texture->set_fullpath(Filename(fmt::format("{}#sliced-{}x{}x{}",
+        source->get_fullpath().get_fullpath(), tile_size_x, tile_size_y, num_tiles)));
+    TexturePool::add_texture(texture);
+
+    return texture;
+}
+
+PT(Texture) RPLoader::create_sliced_3d_texture(Texture* source, int tile_size_x, int tile_size_y, int num_tiles)
+{
+    const CPTA_uchar source_image = source->get_uncompressed_ram_image();
+    const int width = source->get_x_size();
+    const int height = source->get_y_size();
 
-    // Extract all slices and write them to the virtual disk
-    for (int z_slice=0; z_slice < num_tiles; ++z_slice)
+    // Find slice properties
+    const int num_cols = width / tile_size_x;
+    const int num_rows = height / tile_size_y;
+    if (source_image.is_null() || num_cols * num_rows < num_tiles)
     {
-        int slice_x = (z_slice % num_cols) * tile_size_x;
-        int slice_y = (z_slice / num_cols) * tile_size_y;
-        temp_img.copy_sub_image(source, 0, 0, slice_x, slice_y, tile_size_x, tile_size_y);
-        temp_img.write(Filename(tempfile_name + std::to_string(z_slice) + ".png"));
+        RPObject::global_error("RPLoader", fmt::format("Texture '{}' ({}x{}) does not contain {} tiles of {}x{}",
+            source->get_name(), width, height, num_tiles, tile_size_x, tile_size_y));
+        return nullptr;
     }
 
-    // Load the de-sliced texture from the ramdisk
-    Texture* texture_handle = RPLoader::load_3d_texture(Filename(tempfile_name + "/#.png"));
-    vfs->unmount(ramdisk);
+    PT(Texture) texture = new Texture(source->get_name());
+    texture->setup_3d_texture(tile_size_x, tile_size_y, num_tiles, source->get_component_type(), source->get_format());
+    texture->set_fullpath(source->get_fullpath());
+
+    // Copy the slices from the ram image of the source directly into the pages.
+    // Rows of ram images are stored from bottom to top, so the top-most row of
+    // the sliced image is the last row of the source ram image.
+    const size_t pixel_size = source->get_num_components() * source->get_component_width();
+    const size_t source_row_size = width * pixel_size;
+    const size_t tile_row_size = tile_size_x * pixel_size;
+
+    PTA_uchar image = PTA_uchar::empty_array(tile_row_size * tile_size_y * num_tiles);
+    const unsigned char* src = source_image.p();
+    unsigned char* dest = image.p();
+    for (int z_slice = 0; z_slice < num_tiles; ++z_slice)
+    {
+        const int slice_x = (z_slice % num_cols) * tile_size_x;
+        const int slice_y = height - (z_slice / num_cols + 1) * tile_size_y;
+        for (int row = 0; row < tile_size_y; ++row)
+        {
+            std::memcpy(dest, src + (slice_y + row) * source_row_size + slice_x * pixel_size, tile_row_size);
+            dest += tile_row_size;
+        }
+    }
 
-    return texture_handle;
-}
+    texture->set_ram_image(image);
 
+    return texture;
+}
 }
@@ -26,10 +26,26 @@
 #include <filename.h>
 #include <virtualFileMountRamdisk.h>
 #include <virtualFileMountSystem.h>
+#include <virtualFileSystem.h>
 #include <config_putil.h>
 
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <cstdio>
+#include <ctime>
+#include <unordered_set>
+#include <vector>
+
+#include <virtualFileSimple.h>
+
 #include <boost/filesystem.hpp>
 #include <boost/dll/runtime_symbol_info.hpp>
+#include <boost/interprocess/sync/file_lock.hpp>
 
 #include "render_pipeline/rppanda/stdpy/file.hpp"
 #include "render_pipeline/rppanda/util/filesystem.hpp"
@@ -37,18 +53,72 @@
 
 namespace rpcore {
 
+static long get_process_id()
+{
+#ifdef _WIN32
+    return static_cast<long>(GetCurrentProcessId());
+#else
+    return static_cast<long>(getpid());
+#endif
+}
+
+/** Get a path on the physical file system for @p filename, or an empty path. */
+static Filename get_physical_filename(const Filename& filename)
+{
+    VirtualFileSystem* vfs = VirtualFileSystem::get_global_ptr();
+    PT(VirtualFile) vfile = vfs->get_file(filename, true);
+    if (!vfile || !vfile->is_of_type(VirtualFileSimple::get_class_type()))
+        return Filename();
+
+    auto simple = DCAST(VirtualFileSimple, vfile);
+    if (!simple->get_mount()->is_of_type(VirtualFileMountSystem::get_class_type()))
+        return Filename();
+
+    return Filename(DCAST(VirtualFileMountSystem, simple->get_mount())->get_physical_filename(), simple->get_local_filename());
+}
+
+/** FNV-1a hash. This is stable across runs and platforms unlike std::hash. */
+static uint64_t hash_content(const std::string& content)
+{
+    uint64_t hash = 0xcbf29ce484222325ull;
+    for (const unsigned char c: content)
+    {
+        hash ^= c;
+        hash *= 0x100000001b3ull;
+    }
+    return hash;
+}
+
 class MountManager::Impl
 {
 public:
+    static constexpr int MAX_INSTANCES = 64;
+
     void set_write_path(const Filename& pth);
 
-    bool get_lock();
+    bool get_lock(MountManager& self);
+
+    /**
+     * Locks the lock file with an OS file lock, which is released when the
+     * process exits, so lock files of crashed processes do not need to be
+     * taken over.
+     *
+     * @param[in] lock_file    Panda3D path (unix-style).
+     */
+    bool try_lock(MountManager& self, const Filename& lock_file);
+
+    /**
+     * Returns the earliest start time of the running instances, including this
+     * process. Cache files used by them are touched after their start.
+     */
+    std::time_t get_oldest_session_time(MountManager& self) const;
 
     void mount(MountManager& self);
 
     Filename find_basepath() const;
 
-    void wrtie_lock();
+    /** Removes the expired files in cache directory and then, the oldest files over the size limit. */
+    void cleanup_cache(MountManager& self);
 
     /**
      * @param[in] fname    Panda3D path (unix-style).
@@ -62,44 +132,152 @@ public:
     /** This is Panda3D path (unix-style). */
     ///@{
     Filename base_path_;
-    Filename lock_file_ = "instance.pid";
+    Filename lock_file_;
     Filename write_path_;
+    Filename instance_path_;
+    Filename cache_path_;
     Filename config_dir_;
     ///@}
 
     bool mounted_ = false;
     bool do_cleanup_ = true;
+    bool locked_ = false;
+    std::unique_ptr<boost::interprocess::file_lock> file_lock_;
+
+    /**
+     * Lock files locked in this process. OS file locks are owned by a process,
+     * so they do not exclude the other managers in the same process.
+     */
+    static std::unordered_set<std::string> locked_files_;
+
+    size_t cache_max_size_ = 256 * 1024 * 1024;
+    std::chrono::hours cache_max_age_ = std::chrono::hours(24 * 30);
 };
 
+std::unordered_set<std::string> MountManager::Impl::locked_files_;
+
 void MountManager::Impl::set_write_path(const Filename& pth)
 {
     if (pth.empty())
     {
         write_path_ = "";
-        lock_file_ = "instance.pid";
+        cache_path_ = "";
     }
     else
     {
         write_path_ = pth;
         write_path_.make_absolute();
-        lock_file_ = rppanda::join(write_path_, "instance.pid");
+        cache_path_ = rppanda::join(write_path_, "cache");
     }
 }
 
-bool MountManager::Impl::get_lock()
+bool MountManager::Impl::get_lock(MountManager& self)
 {
-    // Check if there is a lockfile at all
-    if (rppanda::isfile(lock_file_))
-    {
-        // Read process id from lockfile
-        // TODO: implement this.
+    // Ramdisk is private to this process
+    if (write_path_.empty() || locked_)
         return true;
+
+    for (int k = 0; k < MAX_INSTANCES; ++k)
+    {
+        const Filename instance_path = rppanda::join(write_path_, fmt::format("instance-{}", k));
+
+        boost::system::error_code ec;
+        boost::filesystem::create_directories(rppanda::convert_path(instance_path), ec);
+        if (ec)
+        {
+            self.error(fmt::format("Failed to create instance path ({}): {}", instance_path.to_os_specific(), ec.message()));
+            return false;
+        }
+
+        const Filename lock_file = rppanda::join(instance_path, "instance.lock");
+        if (try_lock(self, lock_file))
+        {
+            self.debug(fmt::format("Acquired lock: {}", lock_file.to_os_specific()));
+            instance_path_ = instance_path;
+            lock_file_ = lock_file;
+            locked_ = true;
+            return true;
+        }
+    }
+
+    self.error(fmt::format("All {} instance paths in the write path are locked.", MAX_INSTANCES));
+    return false;
+}
+
+bool MountManager::Impl::try_lock(MountManager& self, const Filename& lock_file)
+{
+    const std::string lock_file_os = lock_file.to_os_specific();
+    if (locked_files_.find(lock_file_os) != locked_files_.end())
+        return false;
+
+    // The lock file is never removed. Otherwise, a process could lock the removed
+    // file while another process creates and locks a new file with the same path.
+    if (FILE* file = std::fopen(lock_file_os.c_str(), "a"))
+    {
+        std::fclose(file);
     }
     else
     {
-        wrtie_lock();
-        return true;
+        self.warn(fmt::format("Failed to open lock file: {}", lock_file_os));
+        return false;
+    }
+
+    try
+    {
+        auto file_lock = std::make_unique<boost::interprocess::file_lock>(lock_file_os.c_str());
+        if (!file_lock->try_lock())
+            return false;
+        file_lock_ = std::move(file_lock);
+    }
+    catch (const boost::interprocess::interprocess_exception& err)
+    {
+        self.warn(fmt::format("Failed to lock '{}': {}", lock_file_os, err.what()));
+        return false;
+    }
+
+    locked_files_.insert(lock_file_os);
+
+    // The time of the lock file is the start time of this session.
+    boost::system::error_code ec;
+    boost::filesystem::last_write_time(lock_file_os, std::time(nullptr), ec);
+
+    return true;
+}
+
+std::time_t MountManager::Impl::get_oldest_session_time(MountManager& self) const
+{
+    std::time_t oldest_time = std::time(nullptr);
+    for (int k = 0; k < MAX_INSTANCES; ++k)
+    {
+        const std::string lock_file_os = rppanda::join(write_path_, fmt::format("instance-{}/instance.lock", k)).to_os_specific();
+
+        boost::system::error_code ec;
+        const std::time_t session_time = boost::filesystem::last_write_time(lock_file_os, ec);
+        if (ec || session_time >= oldest_time)
+            continue;
+
+        // Closing a lock file releases the locks of this process on the file,
+        // so the files locked in this process are never probed.
+        bool running = locked_files_.find(lock_file_os) != locked_files_.end();
+        if (!running)
+        {
+            try
+            {
+                boost::interprocess::file_lock probe(lock_file_os.c_str());
+                running = !probe.try_lock();
+                if (!running)
+                    probe.unlock();
+            }
+            catch (const boost::interprocess::interprocess_exception&)
+            {
+                running = true;
+            }
+        }
+
+        if (running)
+            oldest_time = session_time;
     }
+    return oldest_time;
 }
 
 void MountManager::Impl::mount(MountManager& self)
@@ -132,10 +310,17 @@ void MountManager::Impl::mount(MountManager& self)
 
     // Mount the pipeline temp path:
     // If no write path is specified, use a virtual ramdisk
+    if (!write_path_.empty() && !get_lock(self))
+    {
+        self.warn("Failed to lock the write path. Fall back to ramdisk.");
+        set_write_path("");
+    }
+
     if (write_path_.empty())
     {
         self.debug("Mounting ramdisk as /$$rptemp");
         vfs->mount(new VirtualFileMountRamdisk, "/$$rptemp", 0);
+        vfs->make_directory("/$$rptemp/cache");
     }
     else
     {
@@ -154,8 +339,16 @@ void MountManager::Impl::mount(MountManager& self)
             }
         }
 
-        self.debug(fmt::format("Mounting {} as /$$rptemp", write_path_.to_os_specific()));
-        vfs->mount(convert_path(write_path_), "/$$rptemp", 0);
+        boost::system::error_code ec;
+        boost::filesystem::create_directories(rppanda::convert_path(cache_path_), ec);
+
+        self.debug(fmt::format("Mounting {} as /$$rptemp", instance_path_.to_os_specific()));
+        vfs->mount(instance_path_, "/$$rptemp", 0);
+
+        self.debug(fmt::format("Mounting {} as /$$rptemp/cache", cache_path_.to_os_specific()));
+        vfs->mount(cache_path_, "/$$rptemp/cache", 0);
+
+        cleanup_cache(self);
     }
 
     auto& model_path = get_model_path();
@@ -174,9 +367,64 @@ Filename MountManager::Impl::find_basepath() const
     return pth;
 }
 
-void MountManager::Impl::wrtie_lock()
+void MountManager::Impl::cleanup_cache(MountManager& self)
 {
-    // TODO: implmeent this.
+    struct CacheFile
+    {
+        boost::filesystem::path path;
+        uintmax_t size;
+        std::time_t write_time;
+    };
+
+    const auto& cache_path_os = rppanda::convert_path(cache_path_);
+    const std::time_t expire_time = std::time(nullptr) - std::chrono::duration_cast<std::chrono::seconds>(cache_max_age_).count();
+
+    // Running instances touch the cache files which they use, so files written
+    // after the start of the oldest running instance may be in use.
+    const std::time_t session_time = get_oldest_session_time(self);
+
+    boost::system::error_code ec;
+    std::vector<CacheFile> files;
+    uintmax_t total_size = 0;
+    size_t removed_count = 0;
+    for (const auto& entry: boost::filesystem::directory_iterator(cache_path_os, ec))
+    {
+        if (!boost::filesystem::is_regular_file(entry.status()))
+            continue;
+
+        CacheFile file{ entry.path(), boost::filesystem::file_size(entry.path(), ec), boost::filesystem::last_write_time(entry.path(), ec) };
+        if (ec || file.write_time >= session_time)
+            continue;
+
+        // expired files and temporary files which are left by crashed process
+        if (file.write_time < expire_time || (file.path.extension() == ".tmp" && file.write_time < std::time(nullptr) - 60))
+        {
+            if (boost::filesystem::remove(file.path, ec))
+                ++removed_count;
+            continue;
+        }
+
+        total_size += file.size;
+        files.push_back(std::move(file));
+    }
+
+    // Files in use are not counted, because they cannot be removed.
+    if (total_size > cache_max_size_)
+    {
+        std::sort(files.begin(), files.end(), [](const CacheFile& a, const CacheFile& b) { return a.write_time < b.write_time; });
+        for (const auto& file: files)
+        {
+            if (total_size <= cache_max_size_)
+                break;
+            if (boost::filesystem::remove(file.path, ec))
+            {
+                total_size -= file.size;
+                ++removed_count;
+            }
+        }
+    }
+
+    self.debug(fmt::format("Cache has {} KiB after removing {} stale files.", total_size / 1024, removed_count));
 }
 
 bool MountManager::Impl::try_remove(MountManager& self, const std::string& fname)
@@ -195,49 +443,43 @@ bool MountManager::Impl::try_remove(MountManager& self, const std::string& fname
 
 void MountManager::Impl::on_exit_cleanup(MountManager& self)
 {
+    if (!locked_)
+        return;
+
+    const auto& instance_path_os = rppanda::convert_path(instance_path_);
+
     if (do_cleanup_)
     {
         self.debug("Cleaning up ..");
 
-        if (!write_path_.empty())
+        // Check for further tempfiles in the instance path
+        // We explicitely use os.listdir here instead of panda's listdir,
+        // to work with actual paths.
+        // The cache is kept, so it can be reused in next runs.
+        for (const auto& fpath: boost::filesystem::directory_iterator(instance_path_os))
         {
-            // Try removing the lockfile
-            // TODO: uncomment
-            //try_remove(lock_file_);
-
-            // Check for further tempfiles in the write path
-            // We explicitely use os.listdir here instead of panda's listdir,
-            // to work with actual paths.
-            //VirtualFileSystem* vfs = VirtualFileSystem::get_global_ptr();
-            const auto& write_path_os = rppanda::convert_path(write_path_);
-            for (const auto& fpath: boost::filesystem::directory_iterator(write_path_os))
-            {
-                const std::string& fname = fpath.path().filename().generic_string();
-                const std::string& pth = fpath.path().generic_string();
+            const std::string& fname = fpath.path().filename().generic_string();
+            const std::string& pth = fpath.path().generic_string();
 
-                // Tempfiles from the pipeline start with "$$" to distinguish
-                // them from user created files.
-                if (rppanda::isfile(pth) && fname.substr(0, 2) == "$$")
-                    try_remove(self, pth);
-            }
-
-            // Delete the write path if no files are left.
-            if (std::count_if(
-                boost::filesystem::directory_iterator(write_path_os),
-                boost::filesystem::directory_iterator(),
-                [](const boost::filesystem::directory_entry&){return true; }) < 1)
-            {
-                try
-                {
-                    boost::filesystem::remove(write_path_os);
-                    self.debug(fmt::format("Remove '{}'", rppanda::convert_path(write_path_os).to_os_specific()));
-                }
-                catch (...)
-                {
-                }
-            }
+            // Tempfiles from the pipeline start with "$$" to distinguish
+            // them from user created files.
+            if (rppanda::isfile(pth) && fname.substr(0, 2) == "$$")
+                try_remove(self, pth);
         }
     }
+
+    // Release the lock. The lock file and the instance path are kept for next runs.
+    try
+    {
+        file_lock_->unlock();
+    }
+    catch (const boost::interprocess::interprocess_exception& err)
+    {
+        self.warn(fmt::format("Failed to unlock '{}': {}", lock_file_.to_os_specific(), err.what()));
+    }
+    file_lock_.reset();
+    locked_files_.erase(lock_file_.to_os_specific());
+    locked_ = false;
 }
 
 // ************************************************************************************************
@@ -260,7 +502,73 @@ MountManager::~MountManager()
 
 void MountManager::mount() { impl_->mount(*this); }
 void MountManager::set_write_path(const Filename& pth) { impl_->set_write_path(pth); }
-bool MountManager::get_lock() { return impl_->get_lock(); }
+bool MountManager::get_lock() { return impl_->get_lock(*this); }
+
+const Filename& MountManager::get_instance_path() const
+{
+    return impl_->instance_path_;
+}
+
+void MountManager::set_cache_limits(size_t max_size, std::chrono::hours max_age)
+{
+    impl_->cache_max_size_ = max_size;
+    impl_->cache_max_age_ = max_age;
+}
+
+bool MountManager::write_temp_file(const Filename& path, const std::string& content)
+{
+    VirtualFileSystem* vfs = VirtualFileSystem::get_global_ptr();
+
+    // Keep the file and its timestamp if the content is not changed.
+    std::string old_content;
+    if (vfs->exists(path) && vfs->read_file(path, old_content, true) && old_content == content)
+        return true;
+
+    const Filename temp_path = path.get_fullpath() + fmt::format(".{}.tmp", get_process_id());
+    try
+    {
+        auto file = rppanda::open_write_file(temp_path, false, true);
+        *file << content;
+    }
+    catch (const std::exception& err)
+    {
+        global_error("MountManager", fmt::format("Failed to write '{}': {}", temp_path.get_fullpath(), err.what()));
+        return false;
+    }
+
+    // Ramdisk does not overwrite existing file.
+    if (!vfs->rename_file(temp_path, path) && !(vfs->delete_file(path) && vfs->rename_file(temp_path, path)))
+    {
+        vfs->delete_file(temp_path);
+        global_error("MountManager", fmt::format("Failed to rename '{}' to '{}'", temp_path.get_fullpath(), path.get_fullpath()));
+        return false;
+    }
+
+    return true;
+}
+
+Filename MountManager::store_cache_file(const std::string& prefix, const std::string& content, const std::string& extension)
+{
+    const Filename path = fmt::format("/$$rptemp/cache/$${}-{:016x}{}", prefix, hash_content(content), extension);
+
+    // The same name has the same content, so reuse it.
+    if (VirtualFileSystem::get_global_ptr()->exists(path))
+    {
+        // Touch the file, so the cache cleanup of other instances keeps it while it is used.
+        const Filename physical_path = get_physical_filename(path);
+        if (!physical_path.empty())
+        {
+            boost::system::error_code ec;
+            boost::filesystem::last_write_time(physical_path.to_os_specific(), std::time(nullptr), ec);
+        }
+        return path;
+    }
+
+    if (!write_temp_file(path, content))
+        return Filename();
+
+    return path;
+}
 
 const Filename& MountManager::get_write_path() const
 {
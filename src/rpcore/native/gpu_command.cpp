@@ -29,6 +29,7 @@
 #include <iostream>
 #include <iomanip>
 #include <stdlib.h>
+#include <string.h>
 
 NotifyCategoryDef(gpucommand, "");
 
@@ -44,27 +45,30 @@ namespace rpcore {
  */
 GPUCommand::GPUCommand(CommandType command_type) {
     _command_type = command_type;
-    _current_index = 0;
-    memset(_data, 0x0, sizeof(float) * GPU_COMMAND_ENTRIES);
+    _half_precision = false;
+    _half_pending = false;
+    memset(_data, 0x0, sizeof(uint32_t) * GPU_COMMAND_ENTRIES);
 
-    // Store the command type as the first entry
-    push_int(command_type);
+    // The first word is reserved for the header, which is assembled in write_to
+    _current_index = 1;
 }
 
 /**
  * @brief Prints out the GPUCommand to the console
  * @details This method prints the type, size, and data of the GPUCommand to the
- *   console. This helps for debugging the contents of the GPUCommand. Keep
- *   in mind that integers might be shown in their binary float representation,
- *   depending on the setting in the GPUCommand::convert_int_to_float method.
+ *   console. This helps for debugging the contents of the GPUCommand. The data
+ *   is shown as hexadecimal words, since it can contain integers, floats and
+ *   packed 16-bit floats.
  */
 void GPUCommand::write(std::ostream &out) const {
+    const std::ios_base::fmtflags flags = out.flags();
     out << "GPUCommand(type=" << _command_type << ", size=" << _current_index << ", data = {" << std::endl;
-    for (size_t k = 0; k < GPU_COMMAND_ENTRIES; ++k) {
-        out << std::setw(12) << std::fixed << std::setprecision(5) << _data[k] << " ";
-        if (k % 6 == 5 || k == GPU_COMMAND_ENTRIES - 1) out << std::endl;
+    for (size_t k = 1; k < _current_index; ++k) {
+        out << "0x" << std::setw(8) << std::setfill('0') << std::hex << _data[k] << " ";
+        if (k % 6 == 0 || k == _current_index - 1) out << std::endl;
     }
-    out << "})" << std::endl;
+    out.flags(flags);
+    out << std::setfill(' ') << "})" << std::endl;
 }
 
 /**
@@ -72,19 +76,21 @@ void GPUCommand::write(std::ostream &out) const {
  * @details This method writes all the data of the GPU command to a given target.
  *   The target should be a pointer to memory being big enough to hold the
  *   data. Presumably #dest will be a handle to texture memory.
- *   The command_index controls the offset where the data will be written
- *   to.
+ *   The offset controls the word where the data will be written to. Only
+ *   the words in use are written, so the commands are tightly packed.
  *
  * @param dest Handle to the memory to write the command to
- * @param command_index Offset to write the command to. The command will write
- *   its data to command_index * GPU_COMMAND_ENTRIES. When writing
- *   the GPUCommand in a GPUCommandList, the command_index will
- *   most likely be the index of the command in the list.
+ * @param offset Offset in 32-bit words to write the command to. When writing
+ *   the GPUCommand in a GPUCommandList, the offset will be the sum of the
+ *   sizes of all previously written commands.
+ * @return Amount of words written, see GPUCommand::get_size
  */
-void GPUCommand::write_to(const PTA_uchar &dest, size_t command_index) {
-    size_t command_size = GPU_COMMAND_ENTRIES * sizeof(float);
-    size_t offset = command_index * command_size;
-    memcpy(dest.p() + offset, &_data, command_size);
+size_t GPUCommand::write_to(const PTA_uchar &dest, size_t offset) const {
+    const uint32_t header = static_cast<uint32_t>(_command_type) | (static_cast<uint32_t>(_current_index) << 16);
+    unsigned char* target = dest.p() + offset * sizeof(uint32_t);
+    memcpy(target, &header, sizeof(uint32_t));
+    memcpy(target + sizeof(uint32_t), _data + 1, (_current_index - 1) * sizeof(uint32_t));
+    return _current_index;
 }
 
 }
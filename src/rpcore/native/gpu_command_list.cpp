@@ -60,9 +60,11 @@ size_t GPUCommandList::get_num_commands() {
  * @brief Writes the first n-commands to a destination.
  * @details This takes the first #limit commands, and writes them to the
  *   destination using GPUCommand::write_to. See GPUCommand::write_to for
- *   further information about #dest. The limit controls after how much
- *   commands the processing will be stopped. All commands which got processed
- *   will get removed from the list.
+ *   further information about #dest. The commands are written back to back,
+ *   each one only occupying the words it uses. The limit controls after how
+ *   much commands the processing will be stopped, processing also stops when
+ *   the next command would not fit into #dest anymore. All commands which got
+ *   processed will get removed from the list.
  *
  * @param dest Destination to write to, see GPUCommand::write_to
  * @param limit Maximum amount of commands to process
@@ -71,10 +73,15 @@ size_t GPUCommandList::get_num_commands() {
  */
 size_t GPUCommandList::write_commands_to(const PTA_uchar &dest, size_t limit) {
     size_t num_commands_written = 0;
+    size_t num_words_written = 0;
+    const size_t capacity = dest.size() / sizeof(uint32_t);
 
     while (num_commands_written < limit && !_commands.empty()) {
+        if (num_words_written + _commands.front().get_size() > capacity)
+            break;
+
         // Write the first command to the stream, and delete it afterwards
-        _commands.front().write_to(dest, num_commands_written);
+        num_words_written += _commands.front().write_to(dest, num_words_written);
         _commands.pop();
         num_commands_written ++;
     }
@@ -275,6 +275,10 @@ void InternalLightManager::gpu_update_light(RPLight* light) {
     nassertv(light->has_slot());  // Light has no slot!
     GPUCommand cmd_update(GPUCommand::CMD_store_light);
     cmd_update.push_int(light->get_slot());
+
+    // The light data buffer stores 16-bit floats, so there is no need to
+    // transfer the data with full precision.
+    cmd_update.set_half_precision(true);
     light->write_to_command(cmd_update);
     light->set_needs_update(false);
     _cmd_list->add_command(cmd_update);
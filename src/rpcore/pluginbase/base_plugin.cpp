@@ -90,6 +90,14 @@ void BasePlugin::add_stage(std::unique_ptr<RenderStage> stage)
     impl_->assigned_stages_.push_back(std::move(stage));
 }
 
+std::vector<RenderStage*> BasePlugin::get_stages() const
+{
+    std::vector<RenderStage*> stages;
+    for (const auto& stage: impl_->assigned_stages_)
+        stages.push_back(stage.get());
+    return stages;
+}
+
 BaseType* BasePlugin::get_setting_handle(const std::string& setting_id, const std::string& plugin_id)
 {
     return pipeline_.get_plugin_mgr()->get_setting_handle(plugin_id.empty() ? plugin_id_ : plugin_id, setting_id);
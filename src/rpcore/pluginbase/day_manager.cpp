@@ -25,6 +25,8 @@
 #include "render_pipeline/rpcore/pluginbase/day_manager.hpp"
 
 #include <regex>
+#include <algorithm>
+#include <limits>
 
 #include <fmt/format.h>
 
@@ -34,7 +36,7 @@
 #include "render_pipeline/rpcore/pluginbase/day_setting_types.hpp"
 #include "render_pipeline/rpcore/util/shader_input_blocks.hpp"
 #include "render_pipeline/rplibs/py_to_cpp.hpp"
-#include "render_pipeline/rppanda/stdpy/file.hpp"
+#include "render_pipeline/rpcore/mount_manager.hpp"
 
 namespace rpcore {
 
@@ -43,12 +45,43 @@ class DayTimeManager::Impl
 public:
     Impl(RenderPipeline& pipeline);
 
+    /** Resolution of the time, in which the settings are re-evaluated (once per second). */
+    static constexpr float TIME_QUANTISATION = 24.0f * 60.0f * 60.0f;
+
+    struct SettingEntry
+    {
+        std::shared_ptr<DayBaseType> handle;
+        size_t offset;
+        int num_components;
+        PTA_float pta_float;
+        PTA_LVecBase3f pta_vec3;
+    };
+
+public:
+    static constexpr uint32_t INVALID_TIME = (std::numeric_limits<uint32_t>::max)();
+
+    /** Copies the lookup tables of all settings into a single interleaved table. */
+    void build_lut();
+
+    /** Interpolates all settings at the given time and updates the inputs. */
+    void evaluate(float time);
+
 public:
     RenderPipeline& pipeline_;
 
     std::shared_ptr<GroupedInputBlock> input_ubo_;
-    std::unordered_map<std::string, std::shared_ptr<DayBaseType>> setting_handles_;
+    std::vector<SettingEntry> settings_;
     float time_ = 0.5f;
+    bool paused_ = false;
+    bool dirty_ = true;
+    size_t skipped_updates_ = 0;
+
+    // (LUT_RESOLUTION + 1) rows, each row storing the values of all settings
+    std::vector<float> lut_;
+    std::vector<float> values_;
+    size_t lut_stride_ = 0;
+    size_t lut_generation_ = 0;
+    uint32_t quantised_time_ = INVALID_TIME;
 };
 
 DayTimeManager::Impl::Impl(RenderPipeline& pipeline): pipeline_(pipeline)
@@ -56,6 +89,58 @@ DayTimeManager::Impl::Impl(RenderPipeline& pipeline): pipeline_(pipeline)
     input_ubo_ = std::make_shared<GroupedInputBlock>("TimeOfDay");
 }
 
+void DayTimeManager::Impl::build_lut()
+{
+    lut_generation_ = DayBaseType::get_lut_generation();
+
+    lut_stride_ = 0;
+    for (auto& entry: settings_)
+    {
+        entry.offset = lut_stride_;
+        lut_stride_ += entry.num_components;
+    }
+
+    lut_.resize((DayBaseType::LUT_RESOLUTION + 1) * lut_stride_);
+    values_.resize(lut_stride_);
+
+    for (const auto& entry: settings_)
+    {
+        const float* src = entry.handle->get_lut().data();
+        float* dest = lut_.data() + entry.offset;
+        for (int k = 0; k <= DayBaseType::LUT_RESOLUTION; ++k, src += entry.num_components, dest += lut_stride_)
+            std::copy(src, src + entry.num_components, dest);
+    }
+
+    // Force an update with the new values
+    dirty_ = true;
+}
+
+void DayTimeManager::Impl::evaluate(float time)
+{
+    if (lut_stride_ == 0)
+        return;
+
+    const float position = time * DayBaseType::LUT_RESOLUTION;
+    const int index = (std::min)(static_cast<int>(position), DayBaseType::LUT_RESOLUTION - 1);
+    const float weight = position - index;
+
+    // Interpolate all settings at once, this loop can be vectorized by the compiler
+    const float* lower = lut_.data() + index * lut_stride_;
+    const float* upper = lower + lut_stride_;
+    float* values = values_.data();
+    for (size_t k = 0; k < lut_stride_; ++k)
+        values[k] = lower[k] + (upper[k] - lower[k]) * weight;
+
+    for (auto& entry: settings_)
+    {
+        const float* value = values + entry.offset;
+        if (entry.num_components == 1)
+            entry.pta_float[0] = value[0];
+        else
+            entry.pta_vec3[0] = LVecBase3f(value[0], value[1], value[2]);
+    }
+}
+
 // ************************************************************************************************
 
 DayTimeManager::DayTimeManager(RenderPipeline& pipeline): RPObject("DayTimeManager"), impl_(std::make_unique<Impl>(pipeline))
@@ -87,6 +172,21 @@ void DayTimeManager::set_time(const std::string& time)
     }
 }
 
+void DayTimeManager::set_paused(bool paused)
+{
+    impl_->paused_ = paused;
+}
+
+bool DayTimeManager::is_paused() const
+{
+    return impl_->paused_;
+}
+
+size_t DayTimeManager::get_skipped_updates() const
+{
+    return impl_->skipped_updates_;
+}
+
 std::string DayTimeManager::get_formatted_time() const
 {
     float total_minutes = impl_->time_ * 24 * 60;
@@ -102,36 +202,47 @@ void DayTimeManager::load_settings()
         {
             const std::string setting_id = plugin_id + "." + setting_handle.key;
             impl_->input_ubo_->register_pta(setting_id, setting_handle.value->get_glsl_type());
-            impl_->setting_handles_[setting_id] = setting_handle.value;
+
+            Impl::SettingEntry entry;
+            entry.handle = setting_handle.value;
+            entry.offset = 0;
+            entry.num_components = setting_handle.value->get_num_components();
+            if (entry.num_components == 1)
+                entry.pta_float = boost::get<PTA_float>(impl_->input_ubo_->get_input(setting_id));
+            else
+                entry.pta_vec3 = boost::get<PTA_LVecBase3f>(impl_->input_ubo_->get_input(setting_id));
+            impl_->settings_.push_back(std::move(entry));
         }
     }
+    impl_->build_lut();
     impl_->pipeline_.get_stage_mgr()->add_input_blocks(impl_->input_ubo_);
 
     // Generate UBO shader code
-    try
-    {
-        // Try to write the temporary file
-        (*rppanda::open_write_file("/$$rptemp/$$daytime_config.inc.glsl", false, true)) <<
-            (impl_->input_ubo_->generate_shader_code());
-    }
-    catch (const std::exception& err)
-    {
-        error(std::string("Failed to write DayTimeManager UBO shader code! ") + err.what());
-    }
+    if (!MountManager::write_temp_file("/$$rptemp/$$daytime_config.inc.glsl", impl_->input_ubo_->generate_shader_code()))
+        error("Failed to write DayTimeManager UBO shader code!");
 }
 
 void DayTimeManager::update()
 {
-    for (const auto& id_handle: impl_->setting_handles_)
+    // Settings were edited, e.g. by loading daytime overrides
+    if (impl_->lut_generation_ != DayBaseType::get_lut_generation())
+        impl_->build_lut();
+
+    // Keep the last applied time while paused
+    uint32_t quantised_time = static_cast<uint32_t>(impl_->time_ * Impl::TIME_QUANTISATION);
+    if (impl_->paused_ && impl_->quantised_time_ != Impl::INVALID_TIME)
+        quantised_time = impl_->quantised_time_;
+
+    // The values only change when the quantised time or a setting changes
+    if (!impl_->dirty_ && quantised_time == impl_->quantised_time_)
     {
-        // XXX: Find a better interface for this. Without this fix, colors
-        // are in the range 0 .. 255 in the shader.
-        DayBaseType::ValueType value = id_handle.second->get_shader_input_value(impl_->time_);
-        if (value.second == 1)
-            impl_->input_ubo_->update_input(id_handle.first, value.first[0]);
-        else
-            impl_->input_ubo_->update_input(id_handle.first, value.first);
+        ++impl_->skipped_updates_;
+        return;
     }
+
+    impl_->dirty_ = false;
+    impl_->quantised_time_ = quantised_time;
+    impl_->evaluate(quantised_time / Impl::TIME_QUANTISATION);
 }
 
 }
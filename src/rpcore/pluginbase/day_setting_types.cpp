@@ -22,6 +22,8 @@
 
 #include "render_pipeline/rpcore/pluginbase/day_setting_types.hpp"
 
+#include <atomic>
+
 #include <boost/algorithm/string.hpp>
 
 #include "rplibs/yaml.hpp"
@@ -36,6 +38,8 @@ enum class DayBaseTypeIndex: int
     ScalarType,
 };
 
+static std::atomic<size_t> lut_generation(0);
+
 static const std::unordered_map<std::string, DayBaseTypeIndex> factory ={
     { "color", DayBaseTypeIndex::ColorType },
     { "scalar", DayBaseTypeIndex::ScalarType },
@@ -131,6 +135,39 @@ void DayBaseType::set_control_points(const std::vector<std::vector<LVecBase2>>&
 {
     for (size_t index=0, index_end=control_points.size(); index < index_end; ++index)
         _curves[index]->set_control_points(control_points[index]);
+    invalidate_lut();
+}
+
+size_t DayBaseType::get_lut_generation()
+{
+    return lut_generation.load(std::memory_order_acquire);
+}
+
+const std::vector<float>& DayBaseType::get_lut() const
+{
+    if (!_lut_dirty)
+        return _lut;
+
+    // Evaluate the curves over the whole day and store the shader input values
+    const int num_components = get_num_components();
+    _lut.resize((LUT_RESOLUTION + 1) * num_components);
+
+    float* sample = _lut.data();
+    for (int k = 0; k <= LUT_RESOLUTION; ++k, sample += num_components)
+    {
+        const ValueType& value = get_shader_input_value(k / static_cast<PN_stdfloat>(LUT_RESOLUTION));
+        for (int i = 0; i < num_components; ++i)
+            sample[i] = static_cast<float>(value.first[i]);
+    }
+
+    _lut_dirty = false;
+    return _lut;
+}
+
+void DayBaseType::invalidate_lut()
+{
+    _lut_dirty = true;
+    lut_generation.fetch_add(1, std::memory_order_release);
 }
 
 std::string DayBaseType::serialize() const
@@ -138,15 +175,49 @@ std::string DayBaseType::serialize() const
     std::string result = "[";
     for (const auto& curve: _curves)
     {
+        // scalar types have only one curve.
+        if (!curve)
+            continue;
         result += curve->serialize();
         result += ",";
     }
-    if (_curves.size() > 0)
+    if (result.back() == ',')
         result.pop_back();
     result += "]";
     return result;
 }
 
+bool DayBaseType::is_default() const
+{
+    // Allow a small error, because the values are written with limited precision.
+    static const PN_stdfloat epsilon = 1e-6f;
+
+    for (size_t index = 0, index_end = _default_control_points.size(); index < index_end; ++index)
+    {
+        const auto& points = _curves[index]->get_control_points();
+        const auto& default_points = _default_control_points[index];
+        if (points.size() != default_points.size())
+            return false;
+
+        for (size_t k = 0, k_end = points.size(); k < k_end; ++k)
+        {
+            if (!points[k].almost_equal(default_points[k], epsilon))
+                return false;
+        }
+    }
+    return true;
+}
+
+void DayBaseType::store_default_control_points()
+{
+    _default_control_points.clear();
+    for (const auto& curve: _curves)
+    {
+        if (curve)
+            _default_control_points.push_back(curve->get_control_points());
+    }
+}
+
 // ************************************************************************************************
 const std::string ScalarType::GLSL_TYPE = "float";
 
@@ -170,6 +241,9 @@ ScalarType::ScalarType(YAML::Node& data): DayBaseType(data, "ScalarType")
 
     _curves[0] = new SmoothConnectedCurve;
     _curves[0]->set_single_value(_default);
+
+    store_default_control_points();
+    invalidate_lut();
 }
 
 ScalarType::ValueType ScalarType::get_scaled_value(const ValueType& values) const
@@ -215,6 +289,9 @@ ColorType::ColorType(YAML::Node& data): DayBaseType(data, "ColorType")
         curve->set_color(colors[i]);
         _curves[i] = curve;
     }
+
+    store_default_control_points();
+    invalidate_lut();
 }
 
 ColorType::ValueType ColorType::get_scaled_value(const ValueType& values) const
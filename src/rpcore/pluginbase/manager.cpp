@@ -23,18 +23,25 @@
 #include "render_pipeline/rpcore/pluginbase/manager.hpp"
 
 #include <regex>
+#include <future>
+#include <atomic>
+#include <chrono>
+#include <thread>
 
 #ifdef _WIN32
 // TODO: remove fs::canonical bug is fixed.
 #include <Shlwapi.h>
 #endif
 
+#include <boost/algorithm/string/join.hpp>
 #include <boost/dll/import.hpp>
 
 #include <fmt/ostream.h>
 
 #include "render_pipeline/rpcore/mount_manager.hpp"
 #include "render_pipeline/rpcore/render_pipeline.hpp"
+#include "render_pipeline/rpcore/render_stage.hpp"
+#include "render_pipeline/rpcore/resource_registry.hpp"
 #include "render_pipeline/rpcore/stage_manager.hpp"
 #include "render_pipeline/rpcore/pluginbase/day_setting_types.hpp"
 #include "render_pipeline/rpcore/pluginbase/setting_types.hpp"
@@ -63,6 +70,35 @@ static boost::filesystem::path get_canonical_path(const boost::filesystem::path&
 #endif
 }
 
+/**
+ * Calls @p func with each index in [0, count) on a few worker threads,
+ * and waits until all calls are finished.
+ */
+template <class Func>
+static void parallel_for(size_t count, const Func& func)
+{
+    const size_t num_threads = (std::min)(count, static_cast<size_t>((std::max)(1u, std::thread::hardware_concurrency())));
+    std::atomic<size_t> next_index(0);
+
+    auto worker = [&]() {
+        for (size_t index = next_index++; index < count; index = next_index++)
+            func(index);
+    };
+
+    std::vector<std::future<void>> workers;
+    for (size_t k = 1; k < num_threads; ++k)
+        workers.push_back(std::async(std::launch::async, worker));
+    worker();
+
+    for (auto&& w: workers)
+        w.get();
+}
+
+static double get_elapsed_ms(const std::chrono::steady_clock::time_point& start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
 class PluginManager::Impl
 {
 public:
@@ -79,15 +115,39 @@ public:
 
     void unload();
 
-    /** Internal method to load a plugin. */
-    std::unique_ptr<BasePlugin> load_plugin(const PluginIDType& plugin_id);
+    /** Imports the shared libraries of all enabled plugins in parallel, and creates the instances. */
+    void load_plugins();
+
+    /** Internal method to import the shared library of a plugin, this can be called from worker threads. */
+    std::function<PluginCreatorType> import_plugin(const PluginIDType& plugin_id);
+
+    /** Internal method to create a plugin from the imported creator. */
+    std::unique_ptr<BasePlugin> create_plugin(const PluginIDType& plugin_id, const std::function<PluginCreatorType>& creator);
+
+    /** Sorts the enabled plugins, so that required plugins come first. */
+    void compute_load_order();
 
     void save_overrides(const Filename& override_path);
     void save_daytime_overrides(const Filename& override_path);
 
+    /** Writes the file atomically on a worker thread, after previous writes are done. */
+    void write_file_async(const Filename& path, std::string content);
+    void wait_for_pending_write();
+
+    void load_base_settings(const Filename& plugin_dir);
     void load_plugin_settings(const PluginIDType& plugin_id, const Filename& plugin_pth);
 
+    /**
+     * Parses the configuration of a plugin into @p plugin_data. This does not touch
+     * the loaded data, so this can be called from worker threads.
+     */
+    bool parse_plugin_settings(const PluginIDType& plugin_id, const Filename& plugin_pth, PluginDataType& plugin_data);
+
+    /** Adds the parsed data of a plugin, replacing existing settings with the same ID. */
+    void merge_plugin_settings(const PluginIDType& plugin_id, PluginDataType&& plugin_data);
+
     void load_setting_overrides(const Filename& override_path);
+    SettingsReloadResult reload_setting_overrides(const Filename& override_path);
 
     void on_load();
     void on_stage_setup();
@@ -115,7 +175,13 @@ public:
     std::vector<PluginIDType> plugin_ids_;
     std::unordered_set<PluginIDType> enabled_plugins_;
 
+    // Enabled plugins with instance, required plugins come first.
+    std::vector<PluginIDType> load_order_;
+
     std::unordered_map<PluginIDType, PluginDataType> plugin_data_map_;
+
+    std::future<bool> pending_write_;
+    Filename pending_write_path_;
 };
 
 std::unordered_map<PluginManager::PluginIDType, std::function<PluginManager::PluginCreatorType>> PluginManager::Impl::plugin_creators_;
@@ -131,6 +197,9 @@ void PluginManager::Impl::unload()
     self_.debug(fmt::format("Clear plugins data: {}", plugin_data_map_.size()));
 
     self_.on_unload();
+    load_order_.clear();
+
+    wait_for_pending_write();
 
     for (auto&& id_data: plugin_data_map_)
     {
@@ -144,24 +213,124 @@ void PluginManager::Impl::unload()
     // NOTE: DLLs are not unloaded, yet.
 }
 
-std::unique_ptr<BasePlugin> PluginManager::Impl::load_plugin(const PluginIDType& plugin_id)
+void PluginManager::Impl::load_plugins()
+{
+    const auto load_start = std::chrono::steady_clock::now();
+
+    std::vector<PluginIDType> plugin_ids;
+    std::vector<PluginIDType> missing_plugin_ids;
+    for (const auto& plugin_id: enabled_plugins_)
+    {
+        if (plugin_data_map_.find(plugin_id) == plugin_data_map_.end())
+            missing_plugin_ids.push_back(plugin_id);
+        else
+            plugin_ids.push_back(plugin_id);
+    }
+    std::sort(plugin_ids.begin(), plugin_ids.end());
+
+    for (const auto& plugin_id: missing_plugin_ids)
+    {
+        self_.error(fmt::format("Cannot find plugin ({}) in plugin directory.", plugin_id));
+        self_.disable_plugin(plugin_id);
+    }
+
+    // Importing shared libraries does not depend on other plugins, so do it in parallel.
+    std::vector<std::function<PluginCreatorType>> creators(plugin_ids.size());
+    std::vector<double> import_times(plugin_ids.size());
+    parallel_for(plugin_ids.size(), [&](size_t index) {
+        const auto start = std::chrono::steady_clock::now();
+        creators[index] = import_plugin(plugin_ids[index]);
+        import_times[index] = get_elapsed_ms(start);
+    });
+
+    // Plugins are created on the main thread, because their constructors can access the pipeline.
+    for (size_t index = 0, index_end = plugin_ids.size(); index < index_end; ++index)
+    {
+        const auto& plugin_id = plugin_ids[index];
+        if (!creators[index])
+        {
+            self_.disable_plugin(plugin_id);
+            continue;
+        }
+
+        const auto create_start = std::chrono::steady_clock::now();
+        auto handle = create_plugin(plugin_id, creators[index]);
+        const double create_time = get_elapsed_ms(create_start);
+
+        if (!handle)
+        {
+            self_.disable_plugin(plugin_id);
+            continue;
+        }
+
+        plugin_data_map_.at(plugin_id).instance.swap(handle);
+        self_.debug(fmt::format("Loaded plugin ({}): import {:.2f} ms, create {:.2f} ms", plugin_id, import_times[index], create_time));
+    }
+
+    // Check dependencies after all plugins are created, because disabled plugins can disable others.
+    for (const auto& plugin_id: plugin_ids)
+    {
+        if (enabled_plugins_.find(plugin_id) == enabled_plugins_.end())
+            continue;
+
+        for (const auto& required_plugin: plugin_data_map_.at(plugin_id).instance->get_required_plugins())
+        {
+            if (enabled_plugins_.find(required_plugin) == enabled_plugins_.end())
+            {
+                self_.warn(fmt::format("Cannot load {} since it requires {}", plugin_id, required_plugin));
+                self_.disable_plugin(plugin_id);
+                break;
+            }
+        }
+    }
+
+    compute_load_order();
+
+    self_.debug(fmt::format("Loaded {} plugins in {:.2f} ms", load_order_.size(), get_elapsed_ms(load_start)));
+}
+
+std::function<PluginManager::PluginCreatorType> PluginManager::Impl::import_plugin(const PluginIDType& plugin_id)
 {
-    boost::filesystem::path plugin_path = get_canonical_path(plugin_dir_ / plugin_id);
+    boost::filesystem::path plugin_path;
+
+    try
+    {
+        plugin_path = get_canonical_path(plugin_dir_ / plugin_id);
 
 #if defined(RENDER_PIPELINE_BUILD_CFG_POSTFIX)
-    plugin_path = plugin_path / ("rpplugins_" + plugin_id + RENDER_PIPELINE_BUILD_CFG_POSTFIX);
+        plugin_path = plugin_path / ("rpplugins_" + plugin_id + RENDER_PIPELINE_BUILD_CFG_POSTFIX);
 #else
-    plugin_path = plugin_path / ("rpplugins_" + plugin_id);
+        plugin_path = plugin_path / ("rpplugins_" + plugin_id);
 #endif
 
-    self_.trace(fmt::format("Importing shared library file ({}) from {}{}", plugin_id, plugin_path.string(), boost::dll::shared_library::suffix().string()));
+        self_.trace(fmt::format("Importing shared library file ({}) from {}{}", plugin_id, plugin_path.string(), boost::dll::shared_library::suffix().string()));
 
-    try
-    {
-        auto result = Impl::plugin_creators_.insert({plugin_id, boost::dll::import_alias<PluginCreatorType>(
+        return boost::dll::import_alias<PluginCreatorType>(
             plugin_path,
             "create_plugin",
-            boost::dll::load_mode::rtld_global | boost::dll::load_mode::append_decorations)});
+            boost::dll::load_mode::rtld_global | boost::dll::load_mode::append_decorations);
+    }
+    catch (const boost::system::system_error& err)
+    {
+        self_.error(fmt::format("Failed to import plugin ({}).", plugin_id));
+        self_.error(fmt::format("Loaded path: {}", plugin_path.string()));
+        self_.error(fmt::format("Boost::DLL Error message: {} ({})", err.what(), err.code().value()));
+        return {};
+    }
+    catch (const std::exception& err)
+    {
+        self_.error(fmt::format("Failed to import plugin ({}).", plugin_id));
+        self_.error(fmt::format("Loaded path: {}", plugin_path.string()));
+        self_.error(fmt::format("Plugin error message: {}", err.what()));
+        return {};
+    }
+}
+
+std::unique_ptr<BasePlugin> PluginManager::Impl::create_plugin(const PluginIDType& plugin_id, const std::function<PluginCreatorType>& creator)
+{
+    try
+    {
+        auto result = Impl::plugin_creators_.insert({plugin_id, creator});
 
         if (!result.second)
         {
@@ -204,36 +373,41 @@ std::unique_ptr<BasePlugin> PluginManager::Impl::load_plugin(const PluginIDType&
         self_.trace(fmt::format("Pipeline information in Plugin '{}': Version ({}), Commit ({})",
             plugin_id, plugin_pipeline_info.version, plugin_pipeline_info.commit));
 
-        for (const auto& required_plugin: instance->get_required_plugins())
-        {
-            if (enabled_plugins_.find(required_plugin) == enabled_plugins_.end())
-            {
-                if (enabled_plugins_.find(plugin_id) != enabled_plugins_.end())
-                {
-                    self_.warn(fmt::format("Cannot load {} since it requires {}", plugin_id, required_plugin));
-                    return nullptr;
-                }
-                break;
-            }
-        }
         return instance;
     }
-    catch (const boost::system::system_error& err)
-    {
-        self_.error(fmt::format("Failed to import plugin or to create plugin ({}).", plugin_id));
-        self_.error(fmt::format("Loaded path: {}", plugin_path.string()));
-        self_.error(fmt::format("Boost::DLL Error message: {} ({})", err.what(), err.code().value()));
-        return nullptr;
-    }
     catch (const std::exception& err)
     {
-        self_.error(fmt::format("Failed to import plugin or to create plugin ({}).", plugin_id));
-        self_.error(fmt::format("Loaded path: {}", plugin_path.string()));
+        self_.error(fmt::format("Failed to create plugin ({}).", plugin_id));
         self_.error(fmt::format("Plugin error message: {}", err.what()));
         return nullptr;
     }
 }
 
+void PluginManager::Impl::compute_load_order()
+{
+    load_order_.clear();
+
+    std::vector<PluginIDType> plugin_ids(enabled_plugins_.begin(), enabled_plugins_.end());
+    std::sort(plugin_ids.begin(), plugin_ids.end());
+
+    // Depth-first search, so that required plugins are added before the plugins requiring them.
+    std::unordered_set<PluginIDType> visited;
+    std::function<void(const PluginIDType&)> visit = [&](const PluginIDType& plugin_id) {
+        if (!visited.insert(plugin_id).second)
+            return;
+
+        for (const auto& required_plugin: plugin_data_map_.at(plugin_id).instance->get_required_plugins())
+        {
+            if (enabled_plugins_.find(required_plugin) != enabled_plugins_.end())
+                visit(required_plugin);
+        }
+        load_order_.push_back(plugin_id);
+    };
+
+    for (const auto& plugin_id: plugin_ids)
+        visit(plugin_id);
+}
+
 void PluginManager::Impl::save_overrides(const Filename& override_path)
 {
     std::string output =
@@ -263,37 +437,117 @@ void PluginManager::Impl::save_overrides(const Filename& override_path)
 
     output += "\n\noverrides:\n";
 
+    // Only store the settings which differ from the defaults of the plugins
     for (const auto& id : plugin_ids_)
     {
-        output += std::string(4, ' ') + id + ":\n";
-        for (const auto& setting_id_handle : plugin_data_map_.at(id).settings.get<1>())
-            output += std::string(8, ' ') + fmt::format("{}: {}\n", setting_id_handle.key, setting_id_handle.value->get_value_as_string());
-        output += "\n";
+        std::string plugin_output;
+        for (const auto& setting_id_handle : plugin_data_map_.at(id).settings.get<0>())
+        {
+            if (!setting_id_handle.value->is_default())
+                plugin_output += std::string(8, ' ') + fmt::format("{}: {}\n", setting_id_handle.key, setting_id_handle.value->get_value_as_string());
+        }
+
+        if (!plugin_output.empty())
+            output += std::string(4, ' ') + id + ":\n" + plugin_output + "\n";
     }
 
-    try
+    write_file_async(override_path, std::move(output));
+}
+
+void PluginManager::Impl::save_daytime_overrides(const Filename& override_path)
+{
+    std::string output =
+        "\n# Render Pipeline Time Of Day Configuration\n"
+         "# Instead of editing this file, prefer to use the Time Of Day Editor\n"
+         "# Any formatting and comments will be lost\n\n"
+         "control_points:\n";
+
+    // Only store the settings whose curves differ from the defaults of the plugins
+    for (const auto& id : plugin_ids_)
     {
-        (*rppanda::open_write_file(override_path, false, true)) << output;
+        std::string plugin_output;
+        for (const auto& setting_id_handle : plugin_data_map_.at(id).day_settings.get<0>())
+        {
+            if (!setting_id_handle.value->is_default())
+                plugin_output += std::string(8, ' ') + fmt::format("{}: {}\n", setting_id_handle.key, setting_id_handle.value->serialize());
+        }
+
+        if (!plugin_output.empty())
+            output += std::string(4, ' ') + id + ":\n" + plugin_output;
     }
-    catch (const std::exception& err)
+
+    write_file_async(override_path, std::move(output));
+}
+
+void PluginManager::Impl::write_file_async(const Filename& path, std::string content)
+{
+    // Keep the order of writes, so the latest content wins.
+    wait_for_pending_write();
+
+    pending_write_path_ = path;
+    pending_write_ = std::async(std::launch::async, [path, content=std::move(content)]() {
+        return MountManager::write_temp_file(path, content);
+    });
+}
+
+void PluginManager::Impl::wait_for_pending_write()
+{
+    if (!pending_write_.valid())
+        return;
+
+    if (!pending_write_.get())
+        self_.error(fmt::format("Error writing setting file: {}", pending_write_path_.to_os_specific()));
+}
+
+void PluginManager::Impl::load_base_settings(const Filename& plugin_dir)
+{
+    self_.trace(fmt::format("Loading base setting from '{}'", plugin_dir.c_str()));
+
+    plugin_dir_ = rppanda::convert_path(plugin_dir);
+    if (plugin_dir_.empty())
     {
-        self_.error(std::string("Error writing plugin setting file: ") + err.what());
+        self_.error(fmt::format("Cannot find plugin directory ({}).", plugin_dir.c_str()));
+        return;
+    }
+
+    std::vector<std::pair<PluginIDType, Filename>> plugin_paths;
+    for (const auto& entry: rppanda::listdir(plugin_dir))
+    {
+        const Filename& abspath = rppanda::join(plugin_dir, entry);
+        if (rppanda::isdir(abspath) && (entry != "__pycache__" || entry != "plugin_prefab"))
+            plugin_paths.push_back({ entry, abspath });
+    }
+
+    // Parsing the configurations is independent for each plugin, so do it in parallel.
+    std::vector<PluginDataType> plugin_data(plugin_paths.size());
+    std::unique_ptr<bool[]> parsed(new bool[plugin_paths.size()]);
+    parallel_for(plugin_paths.size(), [&](size_t index) {
+        const auto start = std::chrono::steady_clock::now();
+        parsed[index] = parse_plugin_settings(plugin_paths[index].first, plugin_paths[index].second, plugin_data[index]);
+        self_.trace(fmt::format("Parsed configuration of plugin ({}) in {:.2f} ms", plugin_paths[index].first, get_elapsed_ms(start)));
+    });
+
+    for (size_t index = 0, index_end = plugin_paths.size(); index < index_end; ++index)
+    {
+        if (parsed[index])
+            merge_plugin_settings(plugin_paths[index].first, std::move(plugin_data[index]));
     }
 }
 
-void PluginManager::Impl::save_daytime_overrides(const Filename& override_path)
+void PluginManager::Impl::load_plugin_settings(const PluginIDType& plugin_id, const Filename& plugin_pth)
 {
-    // TODO
-    self_.error("Not implemented.");
+    PluginDataType plugin_data;
+    if (parse_plugin_settings(plugin_id, plugin_pth, plugin_data))
+        merge_plugin_settings(plugin_id, std::move(plugin_data));
 }
 
-void PluginManager::Impl::load_plugin_settings(const PluginIDType& plugin_id, const Filename& plugin_pth)
+bool PluginManager::Impl::parse_plugin_settings(const PluginIDType& plugin_id, const Filename& plugin_pth, PluginDataType& plugin_data)
 {
     const Filename& config_file = rppanda::join(plugin_pth, "config.yaml");
 
     YAML::Node config;
     if (!rplibs::load_yaml_file(config_file, config))
-        return;
+        return false;
 
     // When you don't specify anything in the settings, instead of
     // returning an empty dictionary, pyyaml returns None
@@ -301,11 +555,9 @@ void PluginManager::Impl::load_plugin_settings(const PluginIDType& plugin_id, co
     if (!config["information"])
     {
         self_.error(fmt::format("Plugin ({}) configuration does NOT have information.", plugin_id));
-        return;
+        return false;
     }
 
-    auto& plugin_data = plugin_data_map_[plugin_id];
-
     const auto& info_node = config["information"];
     plugin_data.plugin_info = BasePlugin::PluginInfo{
         info_node["category"].as<std::string>("empty_category"),
@@ -365,6 +617,41 @@ void PluginManager::Impl::load_plugin_settings(const PluginIDType& plugin_id, co
             }
         }
     }
+
+    return true;
+}
+
+void PluginManager::Impl::merge_plugin_settings(const PluginIDType& plugin_id, PluginDataType&& plugin_data)
+{
+    auto found_plugin = plugin_data_map_.find(plugin_id);
+    if (found_plugin == plugin_data_map_.end())
+    {
+        plugin_data_map_.emplace(plugin_id, std::move(plugin_data));
+        return;
+    }
+
+    auto& data = found_plugin->second;
+    data.plugin_info = plugin_data.plugin_info;
+
+    auto& settings_map = data.settings.get<1>();
+    for (const auto& key_val: plugin_data.settings.get<0>())
+    {
+        auto found = settings_map.find(key_val.key);
+        if (found == settings_map.end())
+            settings_map.insert(key_val);
+        else
+            settings_map.replace(found, key_val);
+    }
+
+    auto& day_settings_map = data.day_settings.get<1>();
+    for (const auto& key_val: plugin_data.day_settings.get<0>())
+    {
+        auto found = day_settings_map.find(key_val.key);
+        if (found == day_settings_map.end())
+            day_settings_map.insert(key_val);
+        else
+            day_settings_map.replace(found, key_val);
+    }
 }
 
 void PluginManager::Impl::load_setting_overrides(const Filename& override_path)
@@ -407,9 +694,146 @@ void PluginManager::Impl::load_setting_overrides(const Filename& override_path)
     }
 }
 
+PluginManager::SettingsReloadResult PluginManager::Impl::reload_setting_overrides(const Filename& override_path)
+{
+    self_.debug(fmt::format("Reloading setting overrides from '{}'", override_path.to_os_specific()));
+
+    SettingsReloadResult result;
+
+    YAML::Node overrides;
+    if (!rplibs::load_yaml_file(override_path, overrides))
+    {
+        self_.warn("Failed to load overrides");
+        return result;
+    }
+
+    std::unordered_set<PluginIDType> enabled_plugins;
+    for (const auto& plugin_id: overrides["enabled"])
+        enabled_plugins.insert(plugin_id.as<std::string>());
+
+    for (const auto& plugin_id: enabled_plugins)
+    {
+        if (enabled_plugins_.find(plugin_id) == enabled_plugins_.end() && plugin_data_map_.find(plugin_id) != plugin_data_map_.end())
+        {
+            self_.warn(fmt::format("Plugin ({}) was enabled, this requires to restart the pipeline.", plugin_id));
+            result.requires_restart = true;
+        }
+    }
+    for (const auto& plugin_id: load_order_)
+    {
+        if (enabled_plugins.find(plugin_id) == enabled_plugins.end())
+        {
+            self_.warn(fmt::format("Plugin ({}) was disabled, this requires to restart the pipeline.", plugin_id));
+            result.requires_restart = true;
+        }
+    }
+
+    // Apply the values, and collect the settings whose value changed.
+    const YAML::Node overrides_node = overrides["overrides"];
+    for (const auto& plugin_id: plugin_ids_)
+    {
+        const YAML::Node plugin_overrides = overrides_node[plugin_id];
+        for (const auto& id_setting: plugin_data_map_.at(plugin_id).settings.get<0>())
+        {
+            const std::string old_value = id_setting.value->get_value_as_string();
+
+            const YAML::Node value = plugin_overrides ? plugin_overrides[id_setting.key] : YAML::Node();
+            if (value)
+                id_setting.value->set_value(value);
+            else
+                id_setting.value->reset_to_default();
+
+            if (id_setting.value->get_value_as_string() != old_value)
+                result.changed_settings[plugin_id].insert(id_setting.key);
+        }
+    }
+
+    if (result.changed_settings.empty())
+        return result;
+
+    // Notify the plugins, which are loaded.
+    std::unordered_set<PluginIDType> changed_plugins;
+    std::vector<RenderStage*> rebuild_stages;
+    for (const auto& plugin_id: load_order_)
+    {
+        auto found = result.changed_settings.find(plugin_id);
+        if (found == result.changed_settings.end())
+            continue;
+
+        changed_plugins.insert(plugin_id);
+        auto& plugin_data = plugin_data_map_.at(plugin_id);
+        std::unordered_set<std::string> stage_settings;
+        for (const auto& setting_id: found->second)
+        {
+            const auto& setting = plugin_data.settings.get<1>().find(setting_id)->value;
+            if (!setting->is_runtime() && !setting->is_shader_runtime())
+                stage_settings.insert(setting_id);
+
+            plugin_data.instance->on_setting_changed(setting_id);
+        }
+
+        // Settings which are not runtime settings are applied when the stages are created.
+        if (stage_settings.empty())
+            continue;
+
+        if (plugin_data.instance->on_stage_rebuild(stage_settings))
+        {
+            const auto& stages = plugin_data.instance->get_stages();
+            rebuild_stages.insert(rebuild_stages.end(), stages.begin(), stages.end());
+        }
+        else
+        {
+            self_.warn(fmt::format("Settings ({}:{}) are not runtime settings, this requires to restart the pipeline.",
+                plugin_id, boost::algorithm::join(stage_settings, ", ")));
+            result.requires_restart = true;
+        }
+    }
+
+    // Find the defines which changed, and reload only the shaders using them.
+    auto stage_mgr = pipeline_.get_stage_mgr();
+    const StageManager::DefinesType old_defines = stage_mgr->get_defines();
+    self_.init_defines();
+
+    // Stages are created again after the defines are updated, because their shaders are loaded at once.
+    std::unordered_set<RenderStage*> rebuilt_stages;
+    for (auto stage: stage_mgr->rebuild_stages(rebuild_stages))
+    {
+        rebuilt_stages.insert(stage);
+        result.rebuilt_stages.push_back(stage->get_stage_id());
+    }
+
+    std::unordered_set<std::string> changed_defines;
+    for (const auto& key_val: stage_mgr->get_defines())
+    {
+        auto found = old_defines.find(key_val.first);
+        if (found == old_defines.end() || found->second != key_val.second)
+            changed_defines.insert(key_val.first);
+    }
+
+    for (auto stage: stage_mgr->reload_shaders(changed_defines, rebuilt_stages))
+        result.reloaded_stages.push_back(stage->get_stage_id());
+
+    if (!changed_defines.empty())
+    {
+        // Effect shaders also use the defines.
+        pipeline_.reload_effects();
+
+        for (const auto& plugin_id: load_order_)
+        {
+            if (changed_plugins.find(plugin_id) != changed_plugins.end())
+                plugin_data_map_.at(plugin_id).instance->on_shader_reload();
+        }
+    }
+
+    self_.debug(fmt::format("Changed settings in {} plugins, {} defines, rebuilt {} stages, reloaded {} stages",
+        result.changed_settings.size(), changed_defines.size(), result.rebuilt_stages.size(), result.reloaded_stages.size()));
+
+    return result;
+}
+
 void PluginManager::Impl::on_load()
 {
-    for (const auto& plugin_id: enabled_plugins_)
+    for (const auto& plugin_id: load_order_)
     {
         self_.trace(fmt::format("Call on_load() in plugin ({}).", plugin_id));
         plugin_data_map_.at(plugin_id).instance->on_load();
@@ -418,34 +842,37 @@ void PluginManager::Impl::on_load()
 
 void PluginManager::Impl::on_stage_setup()
 {
-    for (const auto& plugin_id: enabled_plugins_)
+    for (const auto& plugin_id: load_order_)
     {
         self_.trace(fmt::format("Call on_stage_setup() in plugin ({}).", plugin_id));
+        ResourceRegistry::OwnerScope owner_scope(plugin_id);
         plugin_data_map_.at(plugin_id).instance->on_stage_setup();
     }
 }
 
 void PluginManager::Impl::on_post_stage_setup()
 {
-    for (const auto& plugin_id: enabled_plugins_)
+    for (const auto& plugin_id: load_order_)
     {
         self_.trace(fmt::format("Call on_post_stage_setup() in plugin ({}).", plugin_id));
+        ResourceRegistry::OwnerScope owner_scope(plugin_id);
         plugin_data_map_.at(plugin_id).instance->on_post_stage_setup();
     }
 }
 
 void PluginManager::Impl::on_pipeline_created()
 {
-    for (const auto& plugin_id: enabled_plugins_)
+    for (const auto& plugin_id: load_order_)
     {
         self_.trace(fmt::format("Call on_pipeline_created() in plugin ({}).", plugin_id));
+        ResourceRegistry::OwnerScope owner_scope(plugin_id);
         plugin_data_map_.at(plugin_id).instance->on_pipeline_created();
     }
 }
 
 void PluginManager::Impl::on_prepare_scene(NodePath scene)
 {
-    for (const auto& plugin_id: enabled_plugins_)
+    for (const auto& plugin_id: load_order_)
     {
         self_.trace(fmt::format("Call on_prepare_scene(NodePath) in plugin ({}).", plugin_id));
         plugin_data_map_.at(plugin_id).instance->on_prepare_scene(scene);
@@ -454,19 +881,19 @@ void PluginManager::Impl::on_prepare_scene(NodePath scene)
 
 void PluginManager::Impl::on_pre_render_update()
 {
-    for (const auto& plugin_id: enabled_plugins_)
+    for (const auto& plugin_id: load_order_)
         plugin_data_map_.at(plugin_id).instance->on_pre_render_update();
 }
 
 void PluginManager::Impl::on_post_render_update()
 {
-    for (const auto& plugin_id: enabled_plugins_)
+    for (const auto& plugin_id: load_order_)
         plugin_data_map_.at(plugin_id).instance->on_post_render_update();
 }
 
 void PluginManager::Impl::on_shader_reload()
 {
-    for (const auto& plugin_id: enabled_plugins_)
+    for (const auto& plugin_id: load_order_)
     {
         self_.trace(fmt::format("Call on_shader_reload() in plugin ({}).", plugin_id));
         plugin_data_map_.at(plugin_id).instance->on_shader_reload();
@@ -475,7 +902,7 @@ void PluginManager::Impl::on_shader_reload()
 
 void PluginManager::Impl::on_window_resized()
 {
-    for (const auto& plugin_id: enabled_plugins_)
+    for (const auto& plugin_id: load_order_)
     {
         self_.trace(fmt::format("Call on_window_resized() in plugin ({}).", plugin_id));
         plugin_data_map_.at(plugin_id).instance->on_window_resized();
@@ -484,8 +911,10 @@ void PluginManager::Impl::on_window_resized()
 
 void PluginManager::Impl::on_unload()
 {
-    for (const auto& plugin_id: enabled_plugins_)
+    // Unload in reverse order, so plugins are unloaded before their required plugins.
+    for (auto it = load_order_.rbegin(), it_end = load_order_.rend(); it != it_end; ++it)
     {
+        const auto& plugin_id = *it;
         self_.trace(fmt::format("Call on_unload() in plugin ({}).", plugin_id));
         plugin_data_map_.at(plugin_id).instance->on_unload();
     }
@@ -597,22 +1026,7 @@ void PluginManager::load()
     trace(fmt::format("Found {} plugin settings.", impl_->plugin_data_map_.size()));
 
     debug("Creating plugin instances ..");
-    for (const auto& plugin_id: impl_->enabled_plugins_)
-    {
-        if (impl_->plugin_data_map_.find(plugin_id) == impl_->plugin_data_map_.end())
-        {
-            error(fmt::format("Cannot find plugin ({}) in plugin directory.", plugin_id));
-            disable_plugin(plugin_id);
-            continue;
-        }
-
-        auto handle = impl_->load_plugin(plugin_id);
-
-        if (handle)
-            impl_->plugin_data_map_.at(plugin_id).instance.swap(handle);
-        else
-            disable_plugin(plugin_id);
-    }
+    impl_->load_plugins();
 }
 
 void PluginManager::disable_plugin(const PluginIDType& plugin_id)
@@ -623,6 +1037,10 @@ void PluginManager::disable_plugin(const PluginIDType& plugin_id)
 
     for (const auto& id_data: impl_->plugin_data_map_)
     {
+        // Plugins which are not loaded have no instance.
+        if (!id_data.second.instance)
+            continue;
+
         const auto& plugins = id_data.second.instance->get_required_plugins();
         if (std::find(plugins.begin(), plugins.end(), plugin_id) != plugins.end())
             disable_plugin(id_data.first);
@@ -631,23 +1049,7 @@ void PluginManager::disable_plugin(const PluginIDType& plugin_id)
 
 void PluginManager::load_base_settings(const Filename& plugin_dir)
 {
-    trace(fmt::format("Loading base setting from '{}'", plugin_dir.c_str()));
-
-    impl_->plugin_dir_ = rppanda::convert_path(plugin_dir);
-    if (impl_->plugin_dir_.empty())
-    {
-        error(fmt::format("Cannot find plugin directory ({}).", plugin_dir.c_str()));
-        return;
-    }
-
-    for (const auto& entry: rppanda::listdir(plugin_dir))
-    {
-        const Filename& abspath = rppanda::join(plugin_dir, entry);
-        if (rppanda::isdir(abspath) && (entry != "__pycache__" || entry != "plugin_prefab"))
-        {
-            load_plugin_settings(entry, abspath);
-        }
-    }
+    impl_->load_base_settings(plugin_dir);
 }
 
 void PluginManager::load_plugin_settings(const PluginIDType& plugin_id, const Filename& plugin_pth)
@@ -655,6 +1057,11 @@ void PluginManager::load_plugin_settings(const PluginIDType& plugin_id, const Fi
     impl_->load_plugin_settings(plugin_id, plugin_pth);
 }
 
+PluginManager::SettingsReloadResult PluginManager::reload_setting_overrides(const Filename& override_path)
+{
+    return impl_->reload_setting_overrides(override_path);
+}
+
 void PluginManager::load_daytime_overrides(const Filename& override_path)
 {
     trace(fmt::format("Loading daytime overrides from '{}'", override_path.to_os_specific()));
@@ -670,13 +1077,18 @@ void PluginManager::load_daytime_overrides(const Filename& override_path)
     {
         const std::string plugin_id(key_val.first.as<std::string>());
 
-        if (impl_->enabled_plugins_.find(plugin_id) == impl_->enabled_plugins_.end())
+        // Overrides of disabled plugins are kept, so that saving does not lose them.
+        auto plugin_data = impl_->plugin_data_map_.find(plugin_id);
+        if (plugin_data == impl_->plugin_data_map_.end())
+        {
+            warn(fmt::format("Unknown plugin in daytime overrides: {}", plugin_id));
             continue;
+        }
 
         for (const auto& id_points: key_val.second)
         {
             const std::string setting_id(id_points.first.as<std::string>());
-            const auto& plugin_day_setting_map = impl_->plugin_data_map_.at(plugin_id).day_settings.get<1>();
+            const auto& plugin_day_setting_map = plugin_data->second.day_settings.get<1>();
 
             auto found = plugin_day_setting_map.find(setting_id);
             if (found == plugin_day_setting_map.end())
@@ -711,6 +1123,11 @@ void PluginManager::save_daytime_overrides(const Filename& override_path)
     impl_->save_daytime_overrides(override_path);
 }
 
+void PluginManager::wait_for_saves()
+{
+    impl_->wait_for_pending_write();
+}
+
 void PluginManager::set_plugin_enabled(const PluginIDType& plugin_id, bool enabled)
 {
     if (enabled)
@@ -24,11 +24,14 @@
 
 #include "render_pipeline/rpcore/render_pipeline.hpp"
 
+#include <algorithm>
 #include <chrono>
+#include <limits>
 #include <regex>
 
 #include <pandaFramework.h>
 #include <graphicsWindow.h>
+#include <asyncTaskManager.h>
 #include <pandaSystem.h>
 #include <virtualFileSystem.h>
 #include <load_prc_file.h>
@@ -87,13 +90,13 @@ public:
     ~Impl();
 
     /**
-     * Task which repeatedly clears the state cache to avoid storing
-     * unused states. While running once a while, this task prevents over-polluting
-     * the state-cache with unused states. This complements Panda3D's internal
-     * state garbarge collector, which does a great job, but still cannot clear
-     * up all states.
+     * Task which purges unused states from the state cache to avoid storing
+     * unused states. This complements Panda3D's internal state garbarge
+     * collector: when the cache grew too much since the last purge, the
+     * collector is run again within a time budget of the frame. The whole
+     * cache is cleared only when it exceeds the maximum size.
      */
-    AsyncTask::DoneStatus clear_state_cache(rppanda::FunctionalTask* task);
+    AsyncTask::DoneStatus manage_state_cache(rppanda::FunctionalTask* task);
 
     /** Update task which gets called before the rendering, and updates all managers. */
     AsyncTask::DoneStatus manager_update_task(rppanda::FunctionalTask* task);
@@ -129,6 +132,11 @@ public:
 
     bool create(rppanda::ShowBase* base, PandaFramework* framework);
 
+    FrameTimings run_frames(int num_frames);
+
+    /** Returns the main window, or the offscreen buffer in headless mode. */
+    GraphicsOutput* get_main_output() const;
+
     /**
      * Re-applies all custom shaders the user applied, to avoid them getting
      * removed when the shaders are reloaded.
@@ -247,7 +255,22 @@ public:
     std::map<NodePath, std::pair<Effect::SourceType, int>> applied_effects_;
     StereoMode stereo_mode_;
 
+    StateCacheStats state_cache_stats_;
+
+    /** Settings of manage_state_cache(), which are read in RenderPipeline::load_settings(). */
+    ///@{
+    double state_cache_interval_ = 2.0;
+    double state_cache_purge_budget_ = 0.5;
+    int state_cache_growth_limit_ = 1000;
+    int state_cache_max_states_ = 100000;
+    ///@}
+
+    int state_cache_purged_size_ = 0;
+    double state_cache_last_purge_ = 0;
+    double state_cache_last_clear_ = 0;
+
     bool pre_showbase_initialized = false;
+    bool headless_ = false;
 
     std::unique_ptr<Debugger> debugger_;
     std::unique_ptr<LoadingScreen> loading_screen_;
@@ -386,23 +409,61 @@ void RenderPipeline::Impl::clear_effect(NodePath& nodepath)
     applied_effects_.erase(found);
 }
 
-AsyncTask::DoneStatus RenderPipeline::Impl::clear_state_cache(rppanda::FunctionalTask* task)
+AsyncTask::DoneStatus RenderPipeline::Impl::manage_state_cache(rppanda::FunctionalTask* task)
 {
-    task->set_delay(2.0f);
-    TransformState::clear_cache();
-    RenderState::clear_cache();
-    return AsyncTask::DS_again;
+    const auto& start_time = std::chrono::steady_clock::now();
+    const double now = Globals::clock->get_frame_time();
+
+    state_cache_stats_.purged_states = 0;
+
+    const int cache_size = RenderState::get_num_states() + TransformState::get_num_states();
+    if (state_cache_max_states_ > 0 && cache_size > state_cache_max_states_ && now - state_cache_last_clear_ >= state_cache_interval_)
+    {
+        self_.debug(fmt::format("Clearing state cache with {} states.", cache_size));
+        TransformState::clear_cache();
+        RenderState::clear_cache();
+        ++state_cache_stats_.clear_count;
+        state_cache_last_clear_ = now;
+        state_cache_purged_size_ = RenderState::get_num_states() + TransformState::get_num_states();
+        state_cache_stats_.purged_states = (std::max)(0, cache_size - state_cache_purged_size_);
+    }
+    else if (cache_size - state_cache_purged_size_ > state_cache_growth_limit_ || now - state_cache_last_purge_ >= state_cache_interval_)
+    {
+        // Each garbage collection only visits a part of the cache, so repeat it
+        // until nothing is freed or the budget of this frame runs out.
+        std::chrono::duration<double, std::milli> elapsed(0);
+        int purged;
+        do
+        {
+            purged = RenderState::garbage_collect() + TransformState::garbage_collect();
+            state_cache_stats_.purged_states += purged;
+            elapsed = std::chrono::steady_clock::now() - start_time;
+        } while (purged > 0 && elapsed.count() < state_cache_purge_budget_);
+
+        // continue in next frame if the budget ran out.
+        if (purged == 0)
+        {
+            state_cache_purged_size_ = RenderState::get_num_states() + TransformState::get_num_states();
+            state_cache_last_purge_ = now;
+        }
+    }
+
+    state_cache_stats_.render_states = RenderState::get_num_states();
+    state_cache_stats_.transform_states = TransformState::get_num_states();
+    state_cache_stats_.purge_time = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start_time).count();
+
+    return AsyncTask::DS_cont;
 }
 
 AsyncTask::DoneStatus RenderPipeline::Impl::manager_update_task(rppanda::FunctionalTask* task)
 {
-    task_scheduler_->step();
+    task_scheduler_->step(Globals::clock->get_dt() * 1000.0);
     if (debugger_)
         debugger_->update();
     daytime_mgr_->update();
     light_mgr_->update();
 
-    if (rpcore::Globals::clock->get_frame_count() == 10)
+    if (loading_screen_ && rpcore::Globals::clock->get_frame_count() == 10)
     {
         self_.debug("Hiding loading screen after 10 pre-rendered frames.");
         loading_screen_->remove();
@@ -503,7 +564,11 @@ bool RenderPipeline::Impl::create(rppanda::ShowBase* base, PandaFramework* frame
     if (!init_showbase(base, framework))
         return false;
 
-    if (!showbase_->get_win()->get_gsg()->get_supports_compute_shaders())
+    if (headless_)
+    {
+        self_.info("Running in headless mode. Render targets are created as stubs and not rendered.");
+    }
+    else if (!get_main_output()->get_gsg()->get_supports_compute_shaders())
     {
         self_.fatal("Sorry, your GPU does not support compute shaders! Make sure\n"
             "you have the latest drivers. If you already have, your gpu might\n"
@@ -512,7 +577,10 @@ bool RenderPipeline::Impl::create(rppanda::ShowBase* base, PandaFramework* frame
     }
 
     init_globals();
-    loading_screen_->create();
+    if (headless_)
+        loading_screen_.reset();
+    else
+        loading_screen_->create();
     adjust_camera_settings();
     create_managers();
     plugin_mgr_->load();
@@ -532,6 +600,10 @@ bool RenderPipeline::Impl::create(rppanda::ShowBase* base, PandaFramework* frame
 
     set_default_effect();
 
+    // Nothing is rendered in headless mode, but the tasks still run each frame.
+    if (headless_)
+        get_main_output()->set_active(false);
+
     // Measure how long it took to initialize everything, and also store
     // when we finished, so we can measure how long it took to render the
     // first frame (where the shaders are actually compiled)
@@ -542,6 +614,51 @@ bool RenderPipeline::Impl::create(rppanda::ShowBase* base, PandaFramework* frame
     return true;
 }
 
+RenderPipeline::FrameTimings RenderPipeline::Impl::run_frames(int num_frames)
+{
+    FrameTimings timings;
+    AsyncTaskManager* task_mgr = showbase_->get_task_mgr()->get_mgr();
+
+    timings.min_frame_time = std::numeric_limits<double>::max();
+    for (int k = 0; k < num_frames; ++k)
+    {
+        const auto& start_time = std::chrono::steady_clock::now();
+        task_mgr->poll();
+        const double frame_time = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start_time).count();
+
+        timings.total_time += frame_time;
+        timings.min_frame_time = (std::min)(timings.min_frame_time, frame_time);
+        timings.max_frame_time = (std::max)(timings.max_frame_time, frame_time);
+    }
+
+    timings.frame_count = (std::max)(0, num_frames);
+    if (timings.frame_count == 0)
+        return FrameTimings{};
+    timings.average_frame_time = timings.total_time / timings.frame_count;
+
+    const AsyncTaskCollection& tasks = task_mgr->get_tasks();
+    for (size_t k = 0, k_end = tasks.get_num_tasks(); k < k_end; ++k)
+    {
+        AsyncTask* task = tasks.get_task(k);
+        timings.task_timings.push_back({ task->get_name(), task->get_average_dt() * 1000.0, task->get_max_dt() * 1000.0 });
+    }
+    std::sort(timings.task_timings.begin(), timings.task_timings.end(), [](const auto& lhs, const auto& rhs) {
+        return lhs.average_time > rhs.average_time;
+    });
+
+    self_.info(fmt::format("Ran {} frames in {:.3f} ms (avg {:.3f} ms, min {:.3f} ms, max {:.3f} ms)",
+        timings.frame_count, timings.total_time, timings.average_frame_time, timings.min_frame_time, timings.max_frame_time));
+    for (const auto& task_timing: timings.task_timings)
+        self_.debug(fmt::format("  {}: avg {:.3f} ms, max {:.3f} ms", task_timing.name, task_timing.average_time, task_timing.max_time));
+
+    return timings;
+}
+
+GraphicsOutput* RenderPipeline::Impl::get_main_output() const
+{
+    return showbase_->get_window_framework()->get_graphics_output();
+}
+
 void RenderPipeline::Impl::apply_custom_shaders()
 {
     self_.debug(fmt::format("Re-applying {} custom shaders", applied_effects_.size()));
@@ -601,7 +718,7 @@ void RenderPipeline::Impl::initialize_managers()
 
 void RenderPipeline::Impl::init_debugger()
 {
-    if (self_.get_setting<bool>("pipeline.display_debugger"))
+    if (!headless_ && self_.get_setting<bool>("pipeline.display_debugger"))
     {
         debugger_ = std::make_unique<Debugger>(&self_);
     }
@@ -616,7 +733,8 @@ void RenderPipeline::Impl::init_globals()
     self_.trace("Initailizing global parameters.");
 
     Globals::load(showbase_.get());
-    Globals::native_resolution = showbase_->get_win()->get_size();
+    Globals::native_resolution = get_main_output()->get_size();
+    Globals::headless = headless_;
 
     last_window_dims = Globals::native_resolution;
     compute_render_resolution();
@@ -737,7 +855,7 @@ bool RenderPipeline::Impl::init_showbase(rppanda::ShowBase* base, PandaFramework
     }
 
     // Now that we have a showbase and a window, we can print out driver info
-    auto gsg = showbase_->get_win()->get_gsg();
+    auto gsg = get_main_output()->get_gsg();
     self_.debug(fmt::format("Driver Version = {}", gsg->get_driver_version()));
     self_.debug(fmt::format("Driver Vendor = {}", gsg->get_driver_vendor()));
     self_.debug(fmt::format("Driver Renderer = {}", gsg->get_driver_renderer()));
@@ -753,7 +871,7 @@ void RenderPipeline::Impl::init_bindings()
 
     // igloop has 50 sorting value.
     showbase_->add_task(std::bind(&Impl::plugin_post_render_update, this, std::placeholders::_1), "RP_Plugin_AfterRender", 55);
-    showbase_->get_task_mgr()->do_method_later(0.5f, std::bind(&Impl::clear_state_cache, this, std::placeholders::_1), "RP_ClearStateCache");
+    showbase_->add_task(std::bind(&Impl::manage_state_cache, this, std::placeholders::_1), "RP_ManageStateCache", 56);
     showbase_->accept("window-event", [this](const Event* ev) { handle_window_event(ev); });
 }
 
@@ -768,13 +886,13 @@ void RenderPipeline::Impl::create_common_defines()
     defines["CAMERA_FAR"] = std::to_string(std::round(static_cast<double>(Globals::base->get_cam_lens()->get_far()) * round_ratio) / round_ratio);
 
     // Work arround buggy nvidia driver, which expects arrays to be const
-    if (showbase_->get_win()->get_gsg()->get_driver_version().find("NVIDIA 361.43") != std::string::npos)
+    if (get_main_output()->get_gsg()->get_driver_version().find("NVIDIA 361.43") != std::string::npos)
         defines["CONST_ARRAY"] = std::string("const");
     else
         defines["CONST_ARRAY"] = std::string("");
 
     // Provide driver vendor as a define
-    const std::string& vendor = showbase_->get_win()->get_gsg()->get_driver_vendor();
+    const std::string& vendor = get_main_output()->get_gsg()->get_driver_vendor();
     defines["IS_NVIDIA"] = std::string(vendor.find("NVIDIA") != std::string::npos ? "1" : "0");
     defines["IS_AMD"] = std::string(vendor.find("ATI") != std::string::npos ? "1" : "0");
     defines["IS_INTEL"] = std::string(vendor.find("Intel") != std::string::npos ? "1" : "0");
@@ -784,7 +902,7 @@ void RenderPipeline::Impl::create_common_defines()
 
     defines["REFERENCE_MODE"] = std::string(self_.get_setting<bool>("pipeline.reference_mode", false) ? "1" : "0");
 
-    bool has_nv_stereo_view = rpcore::Globals::base->get_win()->get_gsg()->has_extension("GL_NV_stereo_view_rendering") &&
+    bool has_nv_stereo_view = get_main_output()->get_gsg()->has_extension("GL_NV_stereo_view_rendering") &&
         self_.get_setting<bool>("pipeline.nvidia_stereo_view", false);
 
     defines["STEREO_MODE"] = std::to_string(static_cast<int>(self_.get_stereo_mode()));
@@ -937,6 +1055,22 @@ RenderPipeline::~RenderPipeline() = default;
 
 RenderPipeline& RenderPipeline::operator=(RenderPipeline&&) = default;
 
+RenderPipeline::FrameTimings RenderPipeline::run_frames(int num_frames)
+{
+    if (!impl_->showbase_)
+    {
+        error("ShowBase is not initialized! Call RenderPipeline::create() function, first!");
+        return FrameTimings{};
+    }
+
+    return impl_->run_frames(num_frames);
+}
+
+bool RenderPipeline::is_headless() const
+{
+    return impl_->headless_;
+}
+
 void RenderPipeline::run()
 {
     if (impl_->showbase_)
@@ -983,6 +1117,11 @@ bool RenderPipeline::load_settings(const Filename& path)
         LoggerManager::get_instance().get_logger()->set_level(spdlog::level::debug);
     }
 
+    impl_->state_cache_interval_ = get_setting<double>("pipeline.state_cache.interval", 2.0);
+    impl_->state_cache_purge_budget_ = get_setting<double>("pipeline.state_cache.purge_budget", 0.5);
+    impl_->state_cache_growth_limit_ = get_setting<int>("pipeline.state_cache.growth_limit", 1000);
+    impl_->state_cache_max_states_ = get_setting<int>("pipeline.state_cache.max_states", 100000);
+
     return true;
 }
 
@@ -991,6 +1130,11 @@ void RenderPipeline::reload_shaders()
     impl_->reload_shaders();
 }
 
+void RenderPipeline::reload_effects()
+{
+    impl_->apply_custom_shaders();
+}
+
 bool RenderPipeline::pre_showbase_init()
 {
     if (!impl_->mount_mgr_->is_mounted())
@@ -1011,6 +1155,18 @@ bool RenderPipeline::pre_showbase_init()
     //    fatal("You didn't setup the pipeline yet! Please run setup.py.");
 
     load_prc_file("/$$rpconfig/panda3d-config.prc");
+
+    impl_->headless_ = get_setting<bool>("pipeline.headless", false);
+    if (impl_->headless_)
+    {
+        // Use offscreen buffer instead of window, and fallback to the software
+        // renderer when there is no GPU (ex, build servers).
+        load_prc_file_data("headless",
+            "window-type offscreen\n"
+            "aux-display p3tinydisplay\n"
+            "audio-library-name null\n");
+    }
+
     impl_->pre_showbase_initialized = true;
 
     return true;
@@ -1217,6 +1373,11 @@ RenderPipeline::StereoMode RenderPipeline::get_stereo_mode() const
     return impl_->stereo_mode_;
 }
 
+const RenderPipeline::StateCacheStats& RenderPipeline::get_state_cache_stats() const
+{
+    return impl_->state_cache_stats_;
+}
+
 const YAML::Node& RenderPipeline::get_setting(const std::string& setting_path) const
 {
     return impl_->settings.at(setting_path);
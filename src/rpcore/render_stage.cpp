@@ -22,6 +22,8 @@
 
 #include "render_pipeline/rpcore/render_stage.hpp"
 
+#include <algorithm>
+
 #include <graphicsWindow.h>
 
 #include <fmt/format.h>
@@ -65,10 +67,35 @@ RenderStage::DefinesType RenderStage::get_produced_defines() const
 
 void RenderStage::set_shader_input(const ShaderInput& inp)
 {
+    const bool inserted = shader_inputs_.insert_or_assign(inp.get_name(), inp).second;
+
+    if (defer_inputs_)
+    {
+        // An input which is set again replaces the collected one.
+        auto found = inserted ? deferred_inputs_.end() : std::find_if(deferred_inputs_.begin(), deferred_inputs_.end(),
+            [&inp](const ShaderInput& deferred) { return deferred.get_name() == inp.get_name(); });
+        if (found != deferred_inputs_.end())
+            *found = inp;
+        else
+            deferred_inputs_.push_back(inp);
+        return;
+    }
+
     for (const auto& target: targets_)
         target.second->set_shader_input(inp);
 }
 
+void RenderStage::commit_shader_inputs()
+{
+    defer_inputs_ = false;
+
+    for (const auto& target: targets_)
+        target.second->set_shader_inputs(deferred_inputs_);
+
+    deferred_inputs_.clear();
+    deferred_inputs_.shrink_to_fit();
+}
+
 void RenderStage::set_active(bool state)
 {
     if (active_ != state)
@@ -79,7 +106,7 @@ void RenderStage::set_active(bool state)
     }
 }
 
-RenderTarget* RenderStage::create_target(boost::string_view name)
+RenderTarget* RenderStage::create_target(boost::string_view name, bool transient)
 {
     const std::string& target_name = fmt::format("{}:{}:{}", get_plugin_id(), stage_id_, name);
 
@@ -89,7 +116,12 @@ RenderTarget* RenderStage::create_target(boost::string_view name)
         return nullptr;
     }
 
-    return targets_.emplace(target_name, std::make_unique<RenderTarget>(target_name)).first->second.get();
+    const std::string& group = fmt::format("{}:{}", get_plugin_id(), stage_id_);
+    auto target = targets_.emplace(target_name, std::make_unique<RenderTarget>(target_name)).first->second.get();
+    target->set_buffer_group(group);
+    if (transient)
+        target->set_transient(group);
+    return target;
 }
 
 void RenderStage::remove_target(RenderTarget* target)
@@ -105,6 +137,21 @@ void RenderStage::remove_target(RenderTarget* target)
     }
 }
 
+void RenderStage::remove_all_targets()
+{
+    for (const auto& target: targets_)
+        target.second->remove();
+    targets_.clear();
+
+    // New targets are created as active.
+    active_ = true;
+
+    defer_inputs_ = true;
+    deferred_inputs_.clear();
+    for (const auto& name_input: shader_inputs_)
+        deferred_inputs_.push_back(name_input.second);
+}
+
 PT(Shader) RenderStage::load_shader(const std::vector<Filename>& args, bool stereo_post, bool use_post_gs) const
 {
     return get_shader_handle("/$$rp/shader/", args, stereo_post, use_post_gs);
@@ -174,6 +221,13 @@ PT(Shader) RenderStage::get_shader_handle(const Filename& base_path, const std::
         }
     }
 
+    // Remember the files to find the stages using changed defines.
+    for (const auto& path: path_args)
+    {
+        if (std::find(shader_files_.begin(), shader_files_.end(), path) == shader_files_.end())
+            shader_files_.push_back(path);
+    }
+
     return RPLoader::load_shader(path_args);
 }
 
@@ -24,14 +24,20 @@
 
 #include <graphicsWindow.h>
 #include <graphicsEngine.h>
+#include <windowFramework.h>
 #include <graphicsBuffer.h>
 #include <colorWriteAttrib.h>
 #include <auxBitplaneAttrib.h>
 #include <transparencyAttrib.h>
+#include <paramTexture.h>
+
+#include <algorithm>
+#include <map>
 
 #include <fmt/ostream.h>
 
 #include "render_pipeline/rpcore/globals.hpp"
+#include "render_pipeline/rpcore/resource_registry.hpp"
 #include "render_pipeline/rppanda/showbase/showbase.hpp"
 #include "render_pipeline/rpcore/util/post_process_region.hpp"
 
@@ -44,9 +50,58 @@ inline static int max_color_bits(const LVecBase4i& color_bits)
         (std::max)(color_bits[2], color_bits[3]));
 }
 
+inline static bool is_texture_input(const ShaderInput& inp)
+{
+    const int type = inp.get_value_type();
+    return type == ShaderInput::M_texture || type == ShaderInput::M_texture_sampler || type == ShaderInput::M_texture_image;
+}
+
+/** Returns the texture input @p inp with the texture @p tex, keeping the sampler or the image access. */
+static ShaderInput replace_input_texture(const ShaderInput& inp, Texture* tex)
+{
+    switch (inp.get_value_type())
+    {
+    case ShaderInput::M_texture_sampler:
+        return ShaderInput(inp.get_name(), tex, inp.get_sampler(), inp.get_priority());
+
+    case ShaderInput::M_texture_image:
+    {
+        const ParamTextureImage* param = DCAST(ParamTextureImage, inp.get_value());
+        return ShaderInput(inp.get_name(), tex, param->has_read_access(), param->has_write_access(),
+            param->get_bind_layered() ? -1 : param->get_bind_layer(), param->get_bind_level(), inp.get_priority());
+    }
+
+    default:
+        return ShaderInput(inp.get_name(), tex, inp.get_priority());
+    }
+}
+
 // ************************************************************************************************
 class RenderTarget::Impl
 {
+public:
+    /** Textures shared by transient targets which have the same signature. */
+    struct PoolEntry
+    {
+        std::string signature;
+        std::unordered_map<std::string, PT(Texture)> textures;
+        std::vector<Impl*> users;
+    };
+
+    static std::vector<std::unique_ptr<PoolEntry>> pool_;
+
+    /** Buffer shared by targets without attachments, which render as display regions. */
+    struct SharedBuffer
+    {
+        GraphicsBuffer* buffer;
+        std::vector<Impl*> users;
+    };
+
+    static std::vector<std::unique_ptr<SharedBuffer>> shared_buffers_;
+
+    /** The target which created its buffer last. */
+    static Impl* last_created_;
+
 public:
     Impl(RenderTarget& self);
 
@@ -64,11 +119,56 @@ public:
     void make_properties(WindowProperties& window_props, FrameBufferProperties& buffer_props);
     bool create();
 
+    /** Binds the textures of the targets to the buffer. */
+    void add_render_textures();
+
+    /** Get a key of attachments, size and type. Transient targets with same key can share textures. */
+    std::string get_signature() const;
+
+    /** Estimate bytes of each texture from the attachments, keyed like targets_. */
+    std::unordered_map<std::string, size_t> estimate_attachment_bytes() const;
+
+    /** Estimate bytes of the textures from the attachments. */
+    size_t estimate_bytes() const;
+
+    void acquire_pooled_textures();
+    void release_pooled_textures();
+
+    /**
+     * Uses the textures of @p entry instead of the own pool entry, and sets the
+     * new textures on the inputs of @p readers which read the old textures.
+     */
+    void share_pooled_textures(PoolEntry* entry, const std::vector<RenderTarget*>& readers);
+
+    /** Remembers the input if it reads textures of the pool, so that it can be replaced. */
+    void record_pooled_input(const ShaderInput& inp, bool override_input);
+
+    /** Sets the textures of @p new_textures on the inputs reading the same key of @p old_textures. */
+    void replace_pooled_inputs(const std::unordered_map<std::string, PT(Texture)>& old_textures,
+        const std::unordered_map<std::string, PT(Texture)>& new_textures);
+
+    /** Returns the sort of the last target in @p readers which reads the textures, or the own sort. */
+    int get_last_read_sort(const std::vector<RenderTarget*>& readers) const;
+
+    bool has_attachments() const;
+
+    /** Size of the display region. Targets with zero size render to 1x1 region. */
+    LVecBase2i get_region_size() const;
+
+    /** Return true if this target can render to the buffer of the previous target. */
+    bool can_share_buffer() const;
+
+    void join_shared_buffer();
+    void leave_shared_buffer();
+
+    /** Resize the shared buffer to fit all regions, and set dimensions of the regions. */
+    void update_shared_buffer_layout();
+
 public:
     RenderTarget& self_;
 
     GraphicsBuffer* internal_buffer_ = nullptr;
-    GraphicsWindow* source_window_ = nullptr;
+    GraphicsOutput* source_window_ = nullptr;
 
     PT(DisplayRegion) source_display_region_ = nullptr;
     std::unique_ptr<PostProcessRegion> source_postprocess_region_;
@@ -90,15 +190,34 @@ public:
     boost::optional<GraphicsOutput::RenderTextureMode> rtmode_;
     LVecBase2i size_ = LVecBase2i(-1);
     LVecBase2i size_constraint_ = LVecBase2i(-1);
+
+    std::string transient_group_;
+    PoolEntry* pool_entry_ = nullptr;
+
+    /** Sort of the last reader in the group, which is set by RenderTarget::alias_transient_targets. */
+    boost::optional<int> last_read_sort_;
+
+    /** Inputs reading textures of the pool, with the override flag. */
+    std::vector<std::pair<ShaderInput, bool>> pooled_inputs_;
+
+    std::string buffer_group_;
+    SharedBuffer* shared_buffer_ = nullptr;
+
+    ResourceRegistry::Handle registry_handle_;
 };
 
+std::vector<std::unique_ptr<RenderTarget::Impl::PoolEntry>> RenderTarget::Impl::pool_;
+std::vector<std::unique_ptr<RenderTarget::Impl::SharedBuffer>> RenderTarget::Impl::shared_buffers_;
+RenderTarget::Impl* RenderTarget::Impl::last_created_ = nullptr;
+
 RenderTarget::Impl::Impl(RenderTarget& self): self_(self)
 {
 }
 
 void RenderTarget::Impl::initilize()
 {
-    source_window_ = Globals::base->get_win();
+    // This is offscreen buffer in headless mode.
+    source_window_ = Globals::base->get_window_framework()->get_graphics_output();
 
     // Public attributes
     engine_ = Globals::base->get_graphics_engine();
@@ -111,6 +230,13 @@ void RenderTarget::Impl::initilize()
 
 void RenderTarget::Impl::set_active(bool flag)
 {
+    if (shared_buffer_)
+    {
+        source_postprocess_region_->set_active(flag);
+        active_ = flag;
+        return;
+    }
+
     const int num_display_regions = internal_buffer_->get_num_display_regions();
     for (int k = 0; k < num_display_regions; k++)
         internal_buffer_->get_display_region(k)->set_active(flag);
@@ -168,21 +294,40 @@ void RenderTarget::Impl::prepare_render(const NodePath& camera_np)
 
 void RenderTarget::Impl::remove()
 {
-    if (internal_buffer_)
+    if (last_created_ == this)
+        last_created_ = nullptr;
+
+    if (shared_buffer_)
+    {
+        leave_shared_buffer();
+    }
+    else if (internal_buffer_)
     {
         internal_buffer_->clear_render_textures();
         engine_->remove_window(internal_buffer_);
+    }
 
-        RenderTarget::REGISTERED_TARGETS.erase(std::find(RenderTarget::REGISTERED_TARGETS.begin(), RenderTarget::REGISTERED_TARGETS.end(), &self_));
+    if (internal_buffer_)
+    {
+        ResourceRegistry::get_global_instance().unregister(registry_handle_);
         internal_buffer_ = nullptr;
     }
 
     source_postprocess_region_.reset();
 
     active_ = false;
-    for (const auto& target: targets_)
-        target.second->release_all();
+    if (pool_entry_)
+    {
+        release_pooled_textures();
+    }
+    else
+    {
+        for (const auto& target: targets_)
+            target.second->release_all();
+    }
     targets_.clear();
+    pooled_inputs_.clear();
+    last_read_sort_.reset();
 }
 
 int RenderTarget::Impl::percent_to_number(const std::string& v) const noexcept
@@ -207,7 +352,13 @@ int RenderTarget::Impl::percent_to_number(const std::string& v) const noexcept
 void RenderTarget::Impl::create_buffer(bool point_buffer)
 {
     compute_size_from_constraint();
-    if (!create())
+
+    const bool shared = can_share_buffer();
+    if (shared)
+    {
+        join_shared_buffer();
+    }
+    else if (!create())
     {
         self_.error("Failed to create buffer!");
         return;
@@ -221,6 +372,11 @@ void RenderTarget::Impl::create_buffer(bool point_buffer)
         if (max_color_bits(color_bits_) == 0)
             source_postprocess_region_->set_attrib(ColorWriteAttrib::make(ColorWriteAttrib::M_none), 1000);
     }
+
+    if (shared)
+        update_shared_buffer_layout();
+
+    last_created_ = this;
 }
 
 void RenderTarget::Impl::compute_size_from_constraint()
@@ -299,6 +455,16 @@ void RenderTarget::Impl::setup_textures()
 
 void RenderTarget::Impl::make_properties(WindowProperties& window_props, FrameBufferProperties& buffer_props)
 {
+    // In headless mode, the buffer is only a stub which keeps display regions and
+    // the scene graph of the target, so the smallest buffer is used.
+    if (Globals::headless)
+    {
+        window_props = WindowProperties::size(1, 1);
+        buffer_props.set_rgba_bits(8, 8, 8, 8);
+        buffer_props.set_back_buffers(0);
+        return;
+    }
+
     window_props = WindowProperties::size(size_.get_x(), size_.get_y());
 
     if (size_constraint_.get_x() == 0 || size_constraint_.get_y() == 0)
@@ -359,6 +525,8 @@ void RenderTarget::Impl::make_properties(WindowProperties& window_props, FrameBu
 bool RenderTarget::Impl::create()
 {
     setup_textures();
+    if (!transient_group_.empty())
+        acquire_pooled_textures();
     WindowProperties window_props;
     FrameBufferProperties buffer_props;
     make_properties(window_props, buffer_props);
@@ -379,6 +547,35 @@ bool RenderTarget::Impl::create()
         return false;
     }
 
+    if (Globals::headless)
+    {
+        // The stub is never rendered, so the textures are not bound.
+        internal_buffer_->set_active(false);
+    }
+    else
+    {
+        add_render_textures();
+    }
+
+    if (!sort_.is_initialized())
+    {
+        RenderTarget::CURRENT_SORT += 20;
+        sort_ = RenderTarget::CURRENT_SORT;
+    }
+
+    internal_buffer_->set_sort(sort_.value());
+    internal_buffer_->disable_clears();
+    internal_buffer_->get_display_region(0)->disable_clears();
+    internal_buffer_->get_overlay_display_region()->disable_clears();
+    internal_buffer_->get_overlay_display_region()->set_active(false);
+
+    registry_handle_ = ResourceRegistry::get_global_instance().register_render_target(&self_);
+
+    return true;
+}
+
+void RenderTarget::Impl::add_render_textures()
+{
     if (!rtmode_)
     {
         switch (texture_type_)
@@ -416,27 +613,283 @@ bool RenderTarget::Impl::create()
         internal_buffer_->add_render_texture(self_.get_aux_tex(k), *rtmode_,
             DrawableRegion::RenderTexturePlane(target_mode));
     }
+}
 
-    if (!sort_.is_initialized())
+std::string RenderTarget::Impl::get_signature() const
+{
+    return fmt::format("{}:{}:{}:{}:{}:{}:{}:{}:{}",
+        color_bits_, aux_bits_, aux_count_, depth_bits_, size_constraint_,
+        int(texture_type_), layers_, rtmode_ ? int(*rtmode_) : -1, int(RenderTarget::USE_R11G11B10));
+}
+
+std::unordered_map<std::string, size_t> RenderTarget::Impl::estimate_attachment_bytes() const
+{
+    const size_t layers = texture_type_ == Texture::TextureType::TT_cube_map ? 6 : layers_;
+    const size_t texels = size_t((std::max)(0, size_.get_x())) * size_t((std::max)(0, size_.get_y())) * layers;
+
+    std::unordered_map<std::string, size_t> bytes;
+    if (max_color_bits(color_bits_) > 0)
     {
-        RenderTarget::CURRENT_SORT += 20;
-        sort_ = RenderTarget::CURRENT_SORT;
+        size_t bits;
+        if (color_bits_ == LVecBase4i(16, 16, 16, 0) && RenderTarget::USE_R11G11B10)
+            bits = 32;
+        else
+            bits = color_bits_[0] + color_bits_[1] + color_bits_[2] + color_bits_[3];
+        bytes["color"] = texels * bits / 8;
     }
 
-    internal_buffer_->set_sort(sort_.value());
-    internal_buffer_->disable_clears();
-    internal_buffer_->get_display_region(0)->disable_clears();
-    internal_buffer_->get_overlay_display_region()->disable_clears();
-    internal_buffer_->get_overlay_display_region()->set_active(false);
+    if (depth_bits_ > 0)
+        bytes["depth"] = texels * depth_bits_ / 8;
 
-    RenderTarget::REGISTERED_TARGETS.push_back(&self_);
+    for (int k = 0; k < aux_count_; ++k)
+        bytes[std::string("aux_") + std::to_string(k)] = texels * aux_bits_ * 4 / 8;
 
-    return true;
+    return bytes;
+}
+
+size_t RenderTarget::Impl::estimate_bytes() const
+{
+    size_t total = 0;
+    for (const auto& kv: estimate_attachment_bytes())
+        total += kv.second;
+    return total;
+}
+
+void RenderTarget::Impl::acquire_pooled_textures()
+{
+    const std::string& signature = get_signature();
+    for (auto& entry: pool_)
+    {
+        if (entry->signature != signature)
+            continue;
+
+        // targets in the same group are alive at the same time.
+        const bool overlapped = std::any_of(entry->users.begin(), entry->users.end(), [this](const Impl* user) {
+            return user->transient_group_ == transient_group_;
+        });
+        if (overlapped)
+            continue;
+
+        self_.trace(fmt::format("Sharing textures with '{}'", entry->users.front()->self_.get_debug_name()));
+        targets_ = entry->textures;
+        entry->users.push_back(this);
+        pool_entry_ = entry.get();
+        return;
+    }
+
+    auto entry = std::make_unique<PoolEntry>();
+    entry->signature = signature;
+    entry->textures = targets_;
+    entry->users.push_back(this);
+    pool_entry_ = entry.get();
+    pool_.push_back(std::move(entry));
+}
+
+bool RenderTarget::Impl::has_attachments() const
+{
+    return max_color_bits(color_bits_) > 0 || aux_count_ > 0 || depth_bits_ > 0;
+}
+
+LVecBase2i RenderTarget::Impl::get_region_size() const
+{
+    if (size_constraint_.get_x() == 0 || size_constraint_.get_y() == 0)
+        return LVecBase2i(1);
+    return LVecBase2i((std::max)(1, size_.get_x()), (std::max)(1, size_.get_y()));
+}
+
+bool RenderTarget::Impl::can_share_buffer() const
+{
+    // Regions of the buffer render one after another, so only targets created
+    // right after the previous target in the same group keep the render order.
+    const Impl* previous = last_created_;
+    return !buffer_group_.empty() && create_default_region_ && !has_attachments() && !sort_ &&
+        previous && previous->buffer_group_ == buffer_group_ && previous->internal_buffer_ &&
+        previous->create_default_region_ && !previous->has_attachments();
+}
+
+void RenderTarget::Impl::join_shared_buffer()
+{
+    Impl* previous = last_created_;
+    if (!previous->shared_buffer_)
+    {
+        auto shared_buffer = std::make_unique<SharedBuffer>();
+        shared_buffer->buffer = previous->internal_buffer_;
+        shared_buffer->users.push_back(previous);
+        previous->shared_buffer_ = shared_buffer.get();
+        shared_buffers_.push_back(std::move(shared_buffer));
+    }
+
+    self_.trace(fmt::format("Rendering to buffer of '{}'", previous->self_.get_debug_name()));
+
+    shared_buffer_ = previous->shared_buffer_;
+    shared_buffer_->users.push_back(this);
+    internal_buffer_ = shared_buffer_->buffer;
+    sort_ = previous->sort_;
+
+    registry_handle_ = ResourceRegistry::get_global_instance().register_render_target(&self_);
+}
+
+void RenderTarget::Impl::leave_shared_buffer()
+{
+    if (source_postprocess_region_)
+        internal_buffer_->remove_display_region(source_postprocess_region_->get_region());
+
+    auto& users = shared_buffer_->users;
+    users.erase(std::find(users.begin(), users.end(), this));
+    if (users.empty())
+    {
+        internal_buffer_->clear_render_textures();
+        engine_->remove_window(internal_buffer_);
+
+        shared_buffers_.erase(std::find_if(shared_buffers_.begin(), shared_buffers_.end(), [this](const auto& shared_buffer) {
+            return shared_buffer.get() == shared_buffer_;
+        }));
+    }
+    else
+    {
+        users.front()->update_shared_buffer_layout();
+    }
+
+    shared_buffer_ = nullptr;
+}
+
+void RenderTarget::Impl::update_shared_buffer_layout()
+{
+    LVecBase2i buffer_size(1);
+    for (const auto& user: shared_buffer_->users)
+    {
+        const LVecBase2i& region_size = user->get_region_size();
+        buffer_size.set((std::max)(buffer_size.get_x(), region_size.get_x()), (std::max)(buffer_size.get_y(), region_size.get_y()));
+    }
+
+    GraphicsBuffer* buffer = shared_buffer_->buffer;
+    if (!Globals::headless && buffer->get_size() != buffer_size)
+        buffer->set_size(buffer_size.get_x(), buffer_size.get_y());
+
+    for (int k = 0, k_end = int(shared_buffer_->users.size()); k < k_end; ++k)
+    {
+        const auto& user = shared_buffer_->users[k];
+        if (!user->source_postprocess_region_)
+            continue;
+
+        const LVecBase2i& region_size = user->get_region_size();
+        DisplayRegion* region = user->source_postprocess_region_->get_region();
+        region->set_sort(k);
+        region->set_dimensions(0, region_size.get_x() / float(buffer_size.get_x()), 0, region_size.get_y() / float(buffer_size.get_y()));
+    }
+}
+
+void RenderTarget::Impl::share_pooled_textures(PoolEntry* entry, const std::vector<RenderTarget*>& readers)
+{
+    self_.trace(fmt::format("Sharing textures with '{}' after its last reader", entry->users.front()->self_.get_debug_name()));
+
+    const bool bound = internal_buffer_ && !Globals::headless;
+    if (bound)
+        internal_buffer_->clear_render_textures();
+
+    const auto old_textures = targets_;
+    release_pooled_textures();
+
+    targets_ = entry->textures;
+    entry->users.push_back(this);
+    pool_entry_ = entry;
+
+    if (bound)
+        add_render_textures();
+
+    for (const auto& reader: readers)
+        reader->impl_->replace_pooled_inputs(old_textures, targets_);
+}
+
+void RenderTarget::Impl::record_pooled_input(const ShaderInput& inp, bool override_input)
+{
+    if (!is_texture_input(inp))
+        return;
+
+    const Texture* tex = inp.get_texture();
+    const bool pooled = std::any_of(pool_.begin(), pool_.end(), [tex](const auto& entry) {
+        return std::any_of(entry->textures.begin(), entry->textures.end(), [tex](const auto& key_tex) {
+            return key_tex.second == tex;
+        });
+    });
+
+    auto found = std::find_if(pooled_inputs_.begin(), pooled_inputs_.end(), [&inp](const auto& pooled_input) {
+        return pooled_input.first.get_name() == inp.get_name();
+    });
+
+    if (found == pooled_inputs_.end())
+    {
+        if (pooled)
+            pooled_inputs_.emplace_back(inp, override_input);
+    }
+    else if (pooled)
+    {
+        *found = { inp, override_input };
+    }
+    else
+    {
+        pooled_inputs_.erase(found);
+    }
+}
+
+void RenderTarget::Impl::replace_pooled_inputs(const std::unordered_map<std::string, PT(Texture)>& old_textures,
+    const std::unordered_map<std::string, PT(Texture)>& new_textures)
+{
+    for (auto& pooled_input: pooled_inputs_)
+    {
+        const Texture* tex = pooled_input.first.get_texture();
+        for (const auto& key_tex: old_textures)
+        {
+            if (key_tex.second != tex)
+                continue;
+
+            pooled_input.first = replace_input_texture(pooled_input.first, new_textures.at(key_tex.first));
+            if (create_default_region_)
+                source_postprocess_region_->set_shader_input(pooled_input.first, pooled_input.second);
+            break;
+        }
+    }
+}
+
+int RenderTarget::Impl::get_last_read_sort(const std::vector<RenderTarget*>& readers) const
+{
+    int last_read_sort = sort_.value();
+    for (const auto& reader: readers)
+    {
+        const Impl* impl = reader->impl_.get();
+        if (impl == this || !impl->sort_)
+            continue;
+
+        const bool reads = std::any_of(impl->pooled_inputs_.begin(), impl->pooled_inputs_.end(), [this](const auto& pooled_input) {
+            return std::any_of(targets_.begin(), targets_.end(), [&pooled_input](const auto& key_tex) {
+                return key_tex.second == pooled_input.first.get_texture();
+            });
+        });
+        if (reads)
+            last_read_sort = (std::max)(last_read_sort, impl->sort_.value());
+    }
+    return last_read_sort;
+}
+
+void RenderTarget::Impl::release_pooled_textures()
+{
+    auto& users = pool_entry_->users;
+    users.erase(std::find(users.begin(), users.end(), this));
+    if (users.empty())
+    {
+        for (const auto& target: pool_entry_->textures)
+            target.second->release_all();
+
+        pool_.erase(std::find_if(pool_.begin(), pool_.end(), [this](const auto& entry) {
+            return entry.get() == pool_entry_;
+        }));
+    }
+    pool_entry_ = nullptr;
 }
 
 // ************************************************************************************************
 bool RenderTarget::USE_R11G11B10 = true;
-std::vector<RenderTarget*> RenderTarget::REGISTERED_TARGETS;
+const ResourceRegistry::RenderTargetView RenderTarget::REGISTERED_TARGETS{};
 int RenderTarget::CURRENT_SORT = -300;
 
 RenderTarget::RenderTarget(boost::string_view name): RPObject(name), impl_(std::make_unique<Impl>(*this))
@@ -553,6 +1006,8 @@ const boost::optional<int>& RenderTarget::get_sort() const noexcept
 void RenderTarget::set_sort(int sort) noexcept
 {
     impl_->sort_ = sort;
+    if (impl_->internal_buffer_)
+        impl_->internal_buffer_->set_sort(sort);
 }
 
 void RenderTarget::set_size(const std::string& width, const std::string& height) noexcept
@@ -583,6 +1038,149 @@ void RenderTarget::set_instance_count(int count)
     impl_->source_postprocess_region_->set_instance_count(count);
 }
 
+void RenderTarget::alias_transient_targets(const std::vector<RenderTarget*>& targets)
+{
+    struct Lifetime
+    {
+        Impl* target;
+        int first_sort;
+        int last_sort;
+    };
+
+    std::vector<Lifetime> lifetimes;
+    for (const auto& target: targets)
+    {
+        Impl* impl = target->impl_.get();
+        if (!impl->pool_entry_ || !impl->sort_)
+            continue;
+
+        impl->last_read_sort_ = impl->get_last_read_sort(targets);
+        lifetimes.push_back({ impl, impl->sort_.value(), impl->last_read_sort_.value() });
+    }
+
+    std::stable_sort(lifetimes.begin(), lifetimes.end(), [](const Lifetime& lhs, const Lifetime& rhs) {
+        return lhs.first_sort < rhs.first_sort;
+    });
+
+    for (size_t k = 0, k_end = lifetimes.size(); k < k_end; ++k)
+    {
+        const auto& lifetime = lifetimes[k];
+        Impl* target = lifetime.target;
+
+        // Only sharing of own textures saves memory.
+        if (target->pool_entry_->users.size() != 1)
+            continue;
+
+        for (size_t j = 0; j < k; ++j)
+        {
+            Impl::PoolEntry* entry = lifetimes[j].target->pool_entry_;
+            if (entry == target->pool_entry_ || entry->signature != target->pool_entry_->signature)
+                continue;
+
+            // Targets of the group using the entry must be dead before the target is rendered.
+            const bool overlapped = std::any_of(lifetimes.begin(), lifetimes.end(), [&](const Lifetime& other) {
+                return other.target->pool_entry_ == entry &&
+                    other.first_sort <= lifetime.last_sort && lifetime.first_sort <= other.last_sort;
+            });
+            if (overlapped)
+                continue;
+
+            target->share_pooled_textures(entry, targets);
+            break;
+        }
+    }
+}
+
+void RenderTarget::set_transient(const std::string& group)
+{
+    if (impl_->internal_buffer_)
+    {
+        error("Transient should be set before the buffer is created.");
+        return;
+    }
+    impl_->transient_group_ = group;
+}
+
+bool RenderTarget::is_transient() const
+{
+    return !impl_->transient_group_.empty();
+}
+
+size_t RenderTarget::get_estimated_bytes() const
+{
+    return impl_->estimate_bytes();
+}
+
+std::unordered_map<std::string, size_t> RenderTarget::get_estimated_attachment_bytes() const
+{
+    return impl_->estimate_attachment_bytes();
+}
+
+int RenderTarget::get_pool_slot() const
+{
+    const auto& pool = Impl::pool_;
+    const auto found = std::find_if(pool.begin(), pool.end(), [this](const auto& entry) {
+        return entry.get() == impl_->pool_entry_;
+    });
+    return found == pool.end() ? -1 : static_cast<int>(std::distance(pool.begin(), found));
+}
+
+void RenderTarget::set_buffer_group(const std::string& group)
+{
+    impl_->buffer_group_ = group;
+}
+
+bool RenderTarget::is_buffer_shared() const
+{
+    return impl_->shared_buffer_ != nullptr;
+}
+
+size_t RenderTarget::get_num_active_buffers()
+{
+    std::vector<GraphicsOutput*> buffers;
+    for (const auto& entry: ResourceRegistry::get_global_instance().get_entries())
+    {
+        auto target = entry.get_render_target();
+        if (target && target->get_active() && target->get_internal_buffer()->is_active())
+            buffers.push_back(target->get_internal_buffer());
+    }
+    std::sort(buffers.begin(), buffers.end());
+    return std::distance(buffers.begin(), std::unique(buffers.begin(), buffers.end()));
+}
+
+RenderTarget::PoolStats RenderTarget::get_pool_stats()
+{
+    PoolStats stats;
+
+    // Changes of the alive bytes at each sort. A target is alive from its sort to the sort of its last reader.
+    std::map<int, long long> alive_bytes_changes;
+    for (const auto& entry: Impl::pool_)
+    {
+        ++stats.num_allocations;
+        stats.allocated_bytes += entry->users.front()->estimate_bytes();
+        for (const auto& user: entry->users)
+        {
+            const size_t bytes = user->estimate_bytes();
+            ++stats.num_targets;
+            stats.requested_bytes += bytes;
+
+            if (!user->sort_)
+                continue;
+            alive_bytes_changes[user->sort_.value()] += bytes;
+            alive_bytes_changes[user->last_read_sort_.value_or(user->sort_.value()) + 1] -= bytes;
+        }
+    }
+
+    long long alive_bytes = 0;
+    for (const auto& sort_change: alive_bytes_changes)
+    {
+        alive_bytes += sort_change.second;
+        stats.peak_bytes = (std::max)(stats.peak_bytes, static_cast<size_t>(alive_bytes));
+    }
+
+    return stats;
+}
+
 bool RenderTarget::get_active() const
 {
     return impl_->active_;
@@ -590,10 +1188,21 @@ bool RenderTarget::get_active() const
 
 void RenderTarget::set_shader_input(const ShaderInput& inp, bool override_input)
 {
+    impl_->record_pooled_input(inp, override_input);
+
     if (impl_->create_default_region_)
         impl_->source_postprocess_region_->set_shader_input(inp, override_input);
 }
 
+void RenderTarget::set_shader_inputs(const std::vector<ShaderInput>& inputs, bool override_input)
+{
+    for (const auto& inp: inputs)
+        impl_->record_pooled_input(inp, override_input);
+
+    if (impl_->create_default_region_)
+        impl_->source_postprocess_region_->set_shader_inputs(inputs, override_input);
+}
+
 void RenderTarget::set_shader(const Shader* sha)
 {
     if (!sha)
@@ -625,7 +1234,9 @@ void RenderTarget::consider_resize()
     impl_->compute_size_from_constraint();
     if (current_size != impl_->size_)
     {
-        if (impl_->internal_buffer_)
+        if (impl_->shared_buffer_)
+            impl_->update_shared_buffer_layout();
+        else if (impl_->internal_buffer_ && !Globals::headless)
             impl_->internal_buffer_->set_size(impl_->size_.get_x(), impl_->size_.get_y());
     }
 }
@@ -0,0 +1,235 @@
+/**
+ * Render Pipeline C++
+ *
+ * Copyright (c) 2018 Center of Human-centered Interaction for Coexistence.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+ * and associated documentation files (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial
+ * portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT
+ * LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "render_pipeline/rpcore/resource_registry.hpp"
+
+#include <texture.h>
+
+#include <unordered_set>
+
+#include <fmt/format.h>
+
+#include "render_pipeline/rppanda/stdpy/file.hpp"
+#include "render_pipeline/rpcore/image.hpp"
+#include "render_pipeline/rpcore/render_target.hpp"
+#include "render_pipeline/rpcore/util/generic.hpp"
+
+namespace rpcore {
+
+/** Get bytes of a texel in GPU memory. */
+static size_t get_texel_bytes(const Texture* texture)
+{
+    switch (texture->get_format())
+    {
+    case Texture::F_r11_g11_b10:
+    case Texture::F_rgb10_a2:
+    case Texture::F_depth_stencil:
+    case Texture::F_depth_component24:
+        return 4;
+    case Texture::F_rgb5:
+    case Texture::F_rgba4:
+    case Texture::F_rgba5:
+        return 2;
+    case Texture::F_rgb332:
+        return 1;
+    default:
+        break;
+    }
+
+    // three components are padded to four except 32-bit components.
+    int num_components = texture->get_num_components();
+    if (num_components == 3 && texture->get_component_width() < 4)
+        num_components = 4;
+
+    return size_t(num_components) * texture->get_component_width();
+}
+
+// ************************************************************************************************
+
+Image* ResourceRegistry::Entry::get_image() const
+{
+    return type == ResourceType::image ? static_cast<Image*>(resource) : nullptr;
+}
+
+RenderTarget* ResourceRegistry::Entry::get_render_target() const
+{
+    return type == ResourceType::render_target ? static_cast<RenderTarget*>(resource) : nullptr;
+}
+
+std::string ResourceRegistry::Entry::get_name() const
+{
+    if (type == ResourceType::image)
+        return get_image()->get_texture()->get_name();
+    else
+        return get_render_target()->get_debug_name();
+}
+
+std::vector<Texture*> ResourceRegistry::Entry::get_textures() const
+{
+    std::vector<Texture*> textures;
+    if (type == ResourceType::image)
+    {
+        textures.push_back(get_image()->get_texture());
+    }
+    else
+    {
+        for (const auto& id_target: get_render_target()->get_targets())
+            textures.push_back(id_target.second);
+    }
+    return textures;
+}
+
+// ************************************************************************************************
+
+ResourceRegistry::OwnerScope::OwnerScope(const std::string& owner)
+{
+    auto& registry = ResourceRegistry::get_global_instance();
+    previous_owner_ = registry.current_owner_;
+    registry.current_owner_ = owner;
+}
+
+ResourceRegistry::OwnerScope::~OwnerScope()
+{
+    ResourceRegistry::get_global_instance().current_owner_ = previous_owner_;
+}
+
+// ************************************************************************************************
+
+ResourceRegistry& ResourceRegistry::get_global_instance()
+{
+    static ResourceRegistry instance;
+    return instance;
+}
+
+size_t ResourceRegistry::compute_texture_bytes(const Texture* texture)
+{
+    const size_t texel_bytes = get_texel_bytes(texture);
+    const size_t x_size = (std::max)(0, texture->get_x_size());
+    const size_t y_size = (std::max)(0, texture->get_y_size());
+    const size_t z_size = (std::max)(0, texture->get_z_size());
+    const size_t num_views = (std::max)(1, texture->get_num_views());
+
+    const bool is_3d = texture->get_texture_type() == Texture::TT_3d_texture;
+    const int num_levels = (texture->uses_mipmaps() && texture->get_texture_type() != Texture::TT_buffer_texture) ?
+        texture->get_expected_num_mipmap_levels() : 1;
+
+    size_t texels = 0;
+    for (int level = 0; level < num_levels; ++level)
+    {
+        texels += (std::max)(size_t(1), x_size >> level) *
+            (std::max)(size_t(1), y_size >> level) *
+            (is_3d ? (std::max)(size_t(1), z_size >> level) : z_size);
+    }
+
+    return texels * texel_bytes * num_views;
+}
+
+ResourceRegistry::Handle ResourceRegistry::register_image(Image* image)
+{
+    ++num_images_;
+    return entries_.insert(entries_.end(), Entry{ ResourceType::image, image, current_owner_ });
+}
+
+ResourceRegistry::Handle ResourceRegistry::register_render_target(RenderTarget* target)
+{
+    ++num_render_targets_;
+    return entries_.insert(entries_.end(), Entry{ ResourceType::render_target, target, current_owner_ });
+}
+
+void ResourceRegistry::unregister(Handle handle)
+{
+    if (handle->type == ResourceType::image)
+        --num_images_;
+    else
+        --num_render_targets_;
+    entries_.erase(handle);
+}
+
+std::map<std::string, size_t> ResourceRegistry::get_owner_bytes() const
+{
+    std::map<std::string, size_t> owner_bytes;
+    std::unordered_set<const Texture*> counted;
+    for (const auto& entry: entries_)
+    {
+        size_t& bytes = owner_bytes[entry.owner];
+        for (const auto& tex: entry.get_textures())
+        {
+            if (counted.insert(tex).second)
+                bytes += compute_texture_bytes(tex);
+        }
+    }
+    return owner_bytes;
+}
+
+size_t ResourceRegistry::get_total_bytes() const
+{
+    size_t total = 0;
+    for (const auto& owner_bytes: get_owner_bytes())
+        total += owner_bytes.second;
+    return total;
+}
+
+std::string ResourceRegistry::dump_json() const
+{
+    const auto& owner_bytes = get_owner_bytes();
+
+    size_t total = 0;
+    std::string owners;
+    for (const auto& kv: owner_bytes)
+    {
+        total += kv.second;
+        owners += fmt::format("{}\n    \"{}\": {}", owners.empty() ? "" : ",", escape_json(kv.first), kv.second);
+    }
+
+    std::string resources;
+    for (const auto& entry: entries_)
+    {
+        std::string textures;
+        for (const auto& tex: entry.get_textures())
+        {
+            textures += fmt::format("{}\n        {{\"name\": \"{}\", \"format\": \"{}\", \"size\": [{}, {}, {}], \"bytes\": {}}}",
+                textures.empty() ? "" : ",",
+                escape_json(tex->get_name()), Texture::format_format(tex->get_format()),
+                tex->get_x_size(), tex->get_y_size(), tex->get_z_size(),
+                compute_texture_bytes(tex));
+        }
+
+        resources += fmt::format("{}\n    {{\"type\": \"{}\", \"name\": \"{}\", \"owner\": \"{}\", \"textures\": [{}\n    ]}}",
+            resources.empty() ? "" : ",",
+            entry.type == ResourceType::image ? "image" : "render_target",
+            escape_json(entry.get_name()), escape_json(entry.owner), textures);
+    }
+
+    return fmt::format("{{\n  \"total_bytes\": {},\n  \"owners\": {{{}\n  }},\n  \"resources\": [{}\n  ]\n}}\n",
+        total, owners, resources);
+}
+
+bool ResourceRegistry::write_json(const Filename& path) const
+{
+    auto file = rppanda::open_write_file(path, false, true);
+    if (!file || !(*file))
+        return false;
+
+    (*file) << dump_json();
+    return file->good();
+}
+
+}
@@ -22,27 +22,89 @@
 
 #include "render_pipeline/rpcore/stage_manager.hpp"
 
-#include <regex>
-
 #include <boost/algorithm/string.hpp>
+#include <boost/optional.hpp>
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <set>
+#include <tuple>
 
 #include <shaderInput.h>
 #include <texture.h>
+#include <pStatCollector.h>
+#include <pStatTimer.h>
+#include <virtualFileSystem.h>
+#include <config_putil.h>
 
 #include <fmt/ostream.h>
 
 #include "rplibs/yaml.hpp"
-#include "render_pipeline/rppanda/stdpy/file.hpp"
+#include "render_pipeline/rpcore/mount_manager.hpp"
 #include "render_pipeline/rpcore/image.hpp"
 #include "render_pipeline/rpcore/stages/update_previous_pipes_stage.hpp"
 #include "render_pipeline/rpcore/render_pipeline.hpp"
 #include "render_pipeline/rpcore/render_stage.hpp"
+#include "render_pipeline/rpcore/render_target.hpp"
+#include "render_pipeline/rpcore/resource_registry.hpp"
+#include "render_pipeline/rpcore/util/generic.hpp"
 #include "render_pipeline/rpcore/util/shader_input_blocks.hpp"
+#include "render_pipeline/rpcore/util/task_scheduler.hpp"
+#include "render_pipeline/rppanda/stdpy/file.hpp"
 
 namespace rpcore {
 
 class StageManager::Impl
 {
+public:
+    using InputBlockType = boost::variant<
+        std::shared_ptr<SimpleInputBlock>,
+        std::shared_ptr<GroupedInputBlock>>;
+
+    /** Frame of a required pipe, which is selected by 'PreviousFrame::' or 'FuturePipe::' prefix. */
+    enum class PipeFrame: int
+    {
+        current = 0,
+        previous,
+        future,
+    };
+
+    struct PipeRequirement
+    {
+        PipeFrame frame;
+        size_t id;
+    };
+
+    /** Pipe, input and input block registered with the same name. */
+    struct Resource
+    {
+        boost::optional<ShaderInput> pipe;
+        boost::optional<ShaderInput> input;
+        boost::optional<InputBlockType> block;
+    };
+
+    struct StageNode
+    {
+        RenderStage* stage;
+
+        std::vector<PipeRequirement> required_pipes;
+        std::vector<size_t> required_inputs;
+
+        RenderStage::ProduceType produced_pipes;
+        RenderStage::ProduceType produced_inputs;
+        RenderStage::DefinesType produced_defines;
+
+        /** Indices of the stages whose results are used by this stage. */
+        std::vector<size_t> producers;
+
+        /** Names of pipes, inputs and defines produced by this stage. */
+        std::vector<std::string> outputs;
+
+        bool sink = false;
+        bool alive = false;
+    };
+
 public:
     Impl(StageManager& self, RenderPipeline& pipeline);
 
@@ -51,17 +113,40 @@ public:
 
     void prepare_stages();
 
+    /** Returns the unique id of the pipe or input name, and registers the name at first. */
+    size_t intern(const std::string& name);
+
+    /** Returns the id of the name or -1 if the name is not registered. */
+    int find_id(const std::string& name) const;
+
+    /** Splits the frame prefix from the required pipe name. */
+    PipeRequirement parse_pipe_requirement(const std::string& pipe);
+
+    /**
+     * Builds the dependency graph of the created stages from their required
+     * and produced pipes, inputs and defines. Returns false when a required pipe
+     * is produced only by a later stage, which is a dependency cycle with
+     * respect to the stage order.
+     */
+    bool build_stage_graph();
+
+    /** Disables the stages whose outputs do not reach any sink stage. */
+    void cull_unused_stages();
+
     /** Sets all required pipes on a stage. */
-    bool bind_pipes_to_stage(RenderStage* stage);
+    bool bind_pipes_to_stage(const StageNode& node);
 
     /** Binds all inputs including common inputs to the given stage. */
-    bool bind_inputs_to_stage(RenderStage* stage);
+    bool bind_inputs_to_stage(const StageNode& node);
 
     /**
      * Registers all produced pipes, inputs and defines from the given
      * stage, so they can be used by later stages.
      */
-    void register_stage_result(RenderStage* stage);
+    void register_stage_result(const StageNode& node);
+
+    /** Removes the pipes, inputs and defines registered by register_stage_result(). */
+    void unregister_stage_result(const StageNode& node);
 
     /**
      * Creates a target for each last-frame's pipe, any pipe starting
@@ -75,38 +160,134 @@ public:
      */
     void apply_future_bindings();
 
+    /** Creates the timings and collectors for the current stages. */
+    void reset_stage_timings();
+
+    /** Collects the grouped input blocks which are flushed in every update. */
+    void collect_grouped_blocks();
+
 public:
+    static const std::string previous_frame_prefix;
+    static const std::string future_pipe_prefix;
+
     StageManager& self_;
     RenderPipeline& pipeline_;
 
     bool created_ = false;
     std::vector<RenderStage*> stages_;
-    std::unordered_map<std::string, ShaderInput> inputs_;
+    std::vector<StageNode> stage_graph_;
 
-    std::unordered_map<std::string, ShaderInput> pipes_;
+    /** { name, id } where the id is the index of resources_. */
+    std::unordered_map<std::string, size_t> name_ids_;
+    std::vector<std::string> names_;
+    std::vector<Resource> resources_;
 
-    /** { id, std::shared_ptr<[SimpleInputBlock | GroupedInputBlock]> } */
-    std::unordered_map<std::string, boost::variant<
-        std::shared_ptr<SimpleInputBlock>,
-        std::shared_ptr<GroupedInputBlock>>> input_blocks_;
+    std::vector<size_t> common_inputs_;
 
-    std::vector<boost::variant<
-        std::shared_ptr<SimpleInputBlock>,
-        std::shared_ptr<GroupedInputBlock>>> input_block_list_;
-    std::unordered_map<std::string, std::unique_ptr<Image>> previous_pipes_;
+    std::vector<InputBlockType> input_block_list_;
+
+    /** Grouped input blocks whose packed data is flushed in every update. */
+    std::vector<std::shared_ptr<GroupedInputBlock>> grouped_blocks_;
+
+    /** { id, image } */
+    std::unordered_map<size_t, std::unique_ptr<Image>> previous_pipes_;
 
-    std::vector<std::pair<std::string, RenderStage*>> future_bindings_;
+    std::vector<std::pair<size_t, RenderStage*>> future_bindings_;
     DefinesType defines_;
 
     std::shared_ptr<UpdatePreviousPipesStage> prev_stage_;
 
+    std::vector<StageTiming> stage_timings_;
+    std::vector<PStatCollector> stage_collectors_;
+
     std::vector<std::string> stage_order_;
+    std::unordered_map<std::string, size_t> stage_order_index_;
+    std::vector<std::string> sink_stages_ = { "FinalStage", "AutoExposureStage" };
+    bool cull_unused_stages_ = true;
+
+    /** Stages disabled by cull_unused_stages(), which are enabled again when they are used. */
+    std::unordered_set<RenderStage*> culled_stages_;
 };
 
+const std::string StageManager::Impl::previous_frame_prefix = "PreviousFrame::";
+const std::string StageManager::Impl::future_pipe_prefix = "FuturePipe::";
+
 StageManager::Impl::Impl(StageManager& self, RenderPipeline& pipeline): self_(self), pipeline_(pipeline)
 {
 }
 
+static std::string get_produce_name(const RenderStage::ProduceType::value_type& data)
+{
+    if (auto input = boost::get<ShaderInput>(&data))
+        return input->get_name()->get_name();
+    else if (auto block = boost::get<std::shared_ptr<SimpleInputBlock>>(&data))
+        return (*block)->get_name();
+    else
+        return boost::get<std::shared_ptr<GroupedInputBlock>>(data)->get_name();
+}
+
+static std::string format_texture_json(const Texture* tex, size_t bytes)
+{
+    return fmt::format("{{\"name\": \"{}\", \"format\": \"{}\", \"size\": [{}, {}, {}], \"bytes\": {}}}",
+        escape_json(tex->get_name()), Texture::format_format(tex->get_format()),
+        tex->get_x_size(), tex->get_y_size(), tex->get_z_size(), bytes);
+}
+
+static std::string format_string_list_json(const std::vector<std::string>& values)
+{
+    std::string output;
+    for (const auto& value: values)
+        output += fmt::format("{}\"{}\"", output.empty() ? "" : ", ", escape_json(value));
+    return "[" + output + "]";
+}
+
+/** Returns the sorts of the created targets of the stage. */
+static std::set<int> get_target_sorts(const RenderStage* stage)
+{
+    std::set<int> sorts;
+    for (const auto& id_target: stage->get_targets())
+    {
+        if (const auto& sort = id_target.second->get_sort())
+            sorts.insert(sort.value());
+    }
+    return sorts;
+}
+
+/**
+ * Moves the sorts of the targets of the stage into [@p sort_begin, @p sort_end)
+ * keeping their order, so that the stage renders at its old position.
+ */
+static void move_target_sorts(const RenderStage* stage, int sort_begin, int sort_end)
+{
+    const auto& sorts = get_target_sorts(stage);
+    if (sorts.empty())
+        return;
+
+    // Targets sharing a buffer have the same sort, so they get the same new sort.
+    std::unordered_map<int, int> new_sorts;
+    const int sort_count = static_cast<int>(sorts.size());
+    for (const int sort: sorts)
+    {
+        const int index = static_cast<int>(new_sorts.size());
+        new_sorts.emplace(sort, sort_begin + (std::max)(sort_end - sort_begin, sort_count) * index / sort_count);
+    }
+
+    for (const auto& id_target: stage->get_targets())
+    {
+        if (const auto& sort = id_target.second->get_sort())
+            id_target.second->set_sort(new_sorts.at(sort.value()));
+    }
+}
+
+/** Shares textures between the transient targets of the stage which are not read at the same time. */
+static void alias_stage_targets(const RenderStage* stage)
+{
+    std::vector<RenderTarget*> targets;
+    for (const auto& id_target: stage->get_targets())
+        targets.push_back(id_target.second.get());
+    RenderTarget::alias_transient_targets(targets);
+}
+
 void StageManager::Impl::load_stage_order()
 {
     YAML::Node orders;
@@ -121,9 +302,17 @@ void StageManager::Impl::load_stage_order()
 
     const size_t stage_count = orders["global_stage_order"].size();
     stage_order_.reserve(stage_count);
-    const std::regex double_colon_re("::");
     for (auto stage_id: orders["global_stage_order"])
+    {
+        stage_order_index_.emplace(stage_id.as<std::string>(), stage_order_.size());
         stage_order_.push_back(stage_id.as<std::string>());
+    }
+
+    if (orders["sink_stages"])
+        sink_stages_ = orders["sink_stages"].as<std::vector<std::string>>();
+
+    if (orders["cull_unused_stages"])
+        cull_unused_stages_ = orders["cull_unused_stages"].as<bool>();
 }
 
 void StageManager::Impl::prepare_stages()
@@ -140,33 +329,245 @@ void StageManager::Impl::prepare_stages()
 
     stages_.swap(enabled_stages);
 
-    std::sort(stages_.begin(), stages_.end(), [this](RenderStage* lhs, RenderStage* rhs) {
-        return std::find(stage_order_.begin(), stage_order_.end(), lhs->get_stage_id()) < std::find(stage_order_.begin(), stage_order_.end(), rhs->get_stage_id());
+    // add_stage() rejects stages which are not in the order, so every stage has an index.
+    std::stable_sort(stages_.begin(), stages_.end(), [this](RenderStage* lhs, RenderStage* rhs) {
+        return stage_order_index_.at(lhs->get_stage_id()) < stage_order_index_.at(rhs->get_stage_id());
     });
 }
 
-bool StageManager::Impl::bind_pipes_to_stage(RenderStage* stage)
+size_t StageManager::Impl::intern(const std::string& name)
+{
+    auto result = name_ids_.emplace(name, names_.size());
+    if (result.second)
+    {
+        names_.push_back(name);
+        resources_.emplace_back();
+    }
+    return result.first->second;
+}
+
+int StageManager::Impl::find_id(const std::string& name) const
+{
+    auto found = name_ids_.find(name);
+    if (found == name_ids_.end())
+        return -1;
+    return static_cast<int>(found->second);
+}
+
+StageManager::Impl::PipeRequirement StageManager::Impl::parse_pipe_requirement(const std::string& pipe)
+{
+    if (pipe.compare(0, previous_frame_prefix.size(), previous_frame_prefix) == 0)
+        return { PipeFrame::previous, intern(pipe.substr(previous_frame_prefix.size())) };
+    else if (pipe.compare(0, future_pipe_prefix.size(), future_pipe_prefix) == 0)
+        return { PipeFrame::future, intern(pipe.substr(future_pipe_prefix.size())) };
+    else
+        return { PipeFrame::current, intern(pipe) };
+}
+
+bool StageManager::Impl::build_stage_graph()
+{
+    const size_t stage_count = stages_.size();
+
+    stage_graph_.clear();
+    stage_graph_.resize(stage_count);
+
+    // Indices of producing stages in ascending order for each id.
+    std::vector<std::vector<size_t>> producers;
+
+    for (size_t k = 0; k < stage_count; ++k)
+    {
+        RenderStage* stage = stages_[k];
+        auto& node = stage_graph_[k];
+        node.stage = stage;
+
+        // Stages may add their requirements again when they are created again.
+        for (const auto& pipe: stage->get_required_pipes())
+        {
+            const auto& requirement = parse_pipe_requirement(pipe);
+            if (std::none_of(node.required_pipes.begin(), node.required_pipes.end(), [&](const PipeRequirement& required) {
+                return required.frame == requirement.frame && required.id == requirement.id;
+            }))
+                node.required_pipes.push_back(requirement);
+        }
+
+        for (const auto& input: stage->get_required_inputs())
+        {
+            const size_t id = intern(input);
+            if (std::find(node.required_inputs.begin(), node.required_inputs.end(), id) == node.required_inputs.end())
+                node.required_inputs.push_back(id);
+        }
+
+        node.produced_pipes = stage->get_produced_pipes();
+        node.produced_inputs = stage->get_produced_inputs();
+        node.produced_defines = stage->get_produced_defines();
+
+        for (const auto* produced: { &node.produced_pipes, &node.produced_inputs })
+        {
+            for (const auto& data: *produced)
+            {
+                node.outputs.push_back(get_produce_name(data));
+
+                const size_t id = intern(node.outputs.back());
+                if (producers.size() <= id)
+                    producers.resize(id + 1);
+                producers[id].push_back(k);
+            }
+        }
+
+        for (const auto& define: node.produced_defines)
+            node.outputs.push_back("#" + define.first);
+
+        // Stages without any outputs only work through side effects, and
+        // defines are consumed by every shader, so both are always kept.
+        node.sink = std::find(sink_stages_.begin(), sink_stages_.end(), stage->get_stage_id()) != sink_stages_.end() ||
+            (node.produced_pipes.empty() && node.produced_inputs.empty()) ||
+            !node.produced_defines.empty();
+    }
+
+    producers.resize(resources_.size());
+
+    bool success = true;
+
+    // Resolves the producer of a resource that a stage requires, where the
+    // nearest preceding producer wins as in the binding.
+    const auto add_dependency = [&](size_t consumer, size_t id, bool is_pipe) {
+        const auto& resource = resources_[id];
+        const bool is_global = resource.block || (!is_pipe && resource.input);
+
+        const auto& indices = producers[id];
+        if (indices.empty())
+        {
+            if (is_global)
+                return;
+
+            self_.error(fmt::format("{} '{}' required by {} is not produced by any stage!",
+                is_pipe ? "Pipe" : "Input", names_[id], stages_[consumer]->get_debug_name()));
+            success = false;
+            return;
+        }
+
+        auto prev_iter = std::lower_bound(indices.begin(), indices.end(), consumer);
+        if (prev_iter != indices.begin())
+        {
+            stage_graph_[consumer].producers.push_back(*std::prev(prev_iter));
+            return;
+        }
+
+        // global inputs are bound before any stage result
+        if (is_global)
+            return;
+
+        self_.error(fmt::format("Dependency cycle: {} requires '{}', but it is produced by {} which runs after it. "
+            "Fix the order in stages.yaml or require '{}{}'.",
+            stages_[consumer]->get_debug_name(), names_[id], stages_[indices.front()]->get_debug_name(), future_pipe_prefix, names_[id]));
+        success = false;
+    };
+
+    for (size_t k = 0; k < stage_count; ++k)
+    {
+        auto& node = stage_graph_[k];
+
+        for (const auto& pipe: node.required_pipes)
+        {
+            if (pipe.frame == PipeFrame::current)
+            {
+                add_dependency(k, pipe.id, true);
+            }
+            // Resources of the previous or the future frame come from the last producer.
+            else if (!producers[pipe.id].empty())
+            {
+                node.producers.push_back(producers[pipe.id].back());
+            }
+            else
+            {
+                self_.error(fmt::format("Pipe '{}' required by {} is not produced by any stage!", names_[pipe.id], node.stage->get_debug_name()));
+                success = false;
+            }
+        }
+
+        for (const size_t id: node.required_inputs)
+            add_dependency(k, id, false);
+    }
+
+    return success;
+}
+
+void StageManager::Impl::cull_unused_stages()
 {
-    const auto& required_pipes = stage->get_required_pipes();
-    for (const auto& pipe: required_pipes)
+    std::vector<size_t> queue;
+    for (size_t k = 0, k_end = stage_graph_.size(); k < k_end; ++k)
+    {
+        if (stage_graph_[k].sink)
+        {
+            stage_graph_[k].alive = true;
+            queue.push_back(k);
+        }
+    }
+
+    while (!queue.empty())
     {
+        const size_t index = queue.back();
+        queue.pop_back();
+        for (const size_t producer: stage_graph_[index].producers)
+        {
+            if (!stage_graph_[producer].alive)
+            {
+                stage_graph_[producer].alive = true;
+                queue.push_back(producer);
+            }
+        }
+    }
+
+    for (const auto& node: stage_graph_)
+    {
+        if (node.alive)
+        {
+            if (culled_stages_.erase(node.stage))
+            {
+                self_.info(fmt::format("Enabling stage ({}), its outputs are used again.", node.stage->get_debug_name()));
+                node.stage->set_active(true);
+            }
+            continue;
+        }
+
+        if (!node.stage->get_active())
+            continue;
+
+        if (cull_unused_stages_)
+        {
+            self_.info(fmt::format("Disabling stage ({}), its outputs are not used by any stage.", node.stage->get_debug_name()));
+            node.stage->set_active(false);
+            culled_stages_.insert(node.stage);
+        }
+        else
+        {
+            self_.debug(fmt::format("Outputs of stage ({}) are not used by any stage.", node.stage->get_debug_name()));
+        }
+    }
+}
+
+bool StageManager::Impl::bind_pipes_to_stage(const StageNode& node)
+{
+    RenderStage* stage = node.stage;
+    for (const auto& pipe: node.required_pipes)
+    {
+        const auto& resource = resources_[pipe.id];
+        const std::string& pipe_name = names_[pipe.id];
+
         // Check if there is an input block named like the pipe
-        if (input_blocks_.find(pipe) != input_blocks_.end())
+        if (pipe.frame == PipeFrame::current && resource.block)
         {
-            boost::apply_visitor([&](const auto& block) { block->bind_to(stage); }, input_blocks_.at(pipe));
+            boost::apply_visitor([&](const auto& block) { block->bind_to(stage); }, *resource.block);
             continue;
         }
 
-        if (pipe.find("PreviousFrame::") == 0)
+        if (pipe.frame == PipeFrame::previous)
         {
             // Special case: Pipes from the previous frame.We assume those
             // pipes have the same size as the window and a format of
             // F_rgba16.Could be subject to change.
-            const std::regex double_colon_re("::");
-            std::vector<std::string> result(std::sregex_token_iterator(pipe.begin(), pipe.end(), double_colon_re, -1), std::sregex_token_iterator());
-            const std::string& pipe_name = result.back();
-
-            if (previous_pipes_.find(pipe_name) == previous_pipes_.end())
+            auto& prev_image = previous_pipes_[pipe.id];
+            if (!prev_image)
             {
                 // setup dest image that has the same format as the source texture.
                 std::string tex_format = "RGBA16";
@@ -176,110 +577,127 @@ bool StageManager::Impl::bind_pipes_to_stage(RenderStage* stage)
                 if (boost::to_lower_copy(pipe_name).find("depth") != std::string::npos)
                     tex_format = "R32";
 
-                previous_pipes_.insert_or_assign(pipe_name, Image::create_2d("Prev-" + pipe_name, 0, 0, tex_format));
-                previous_pipes_.at(pipe_name)->clear_image();
+                prev_image = Image::create_2d("Prev-" + pipe_name, 0, 0, tex_format);
+                prev_image->clear_image();
             }
-            stage->set_shader_input(ShaderInput(std::string("Previous_") + pipe_name, previous_pipes_.at(pipe_name)->get_texture()));
+            stage->set_shader_input(ShaderInput(std::string("Previous_") + pipe_name, prev_image->get_texture()));
             continue;
         }
-        else if (pipe.find("FuturePipe::") == 0)
+        else if (pipe.frame == PipeFrame::future)
         {
             // Special case: Future Pipes which are not available yet.
             // They will contain the unmodified data from the last frame.
-            const std::regex double_colon_re("::");
-            std::vector<std::string> result(std::sregex_token_iterator(pipe.begin(), pipe.end(), double_colon_re, -1), std::sregex_token_iterator());
-            std::string pipe_name = result.back();
             self_.debug(fmt::format("Awaiting future pipe {}", pipe_name));
-            future_bindings_.push_back({pipe_name, stage});
+            future_bindings_.push_back({pipe.id, stage});
             continue;
         }
 
-        if (pipes_.find(pipe) == pipes_.end())
-        {
-            self_.fatal(std::string("Pipe '") + pipe + "' is missing for " + stage->get_debug_name());
+        // A pipe without producer is already reported in build_stage_graph().
+        if (!resource.pipe)
             return false;
-        }
 
-        stage->set_shader_input(pipes_.at(pipe));
+        stage->set_shader_input(*resource.pipe);
     }
 
     return true;
 }
 
-bool StageManager::Impl::bind_inputs_to_stage(RenderStage* stage)
+bool StageManager::Impl::bind_inputs_to_stage(const StageNode& node)
 {
-    std::vector<std::string> common_inputs = { "MainSceneData", "TimeOfDay" };
-
-    if (!pipeline_.is_stereo_mode())
-    {
-        common_inputs.insert(common_inputs.begin(), "mainRender");
-        common_inputs.insert(common_inputs.begin(), "mainCam");
-    }
+    RenderStage* stage = node.stage;
+
+    const auto bind_input = [&](size_t id) {
+        const auto& resource = resources_[id];
+        if (resource.input)
+            stage->set_shader_input(*resource.input);
+        else if (resource.block)
+            boost::apply_visitor([&](const auto& block){ block->bind_to(stage); }, *resource.block);
+        else
+            return false;
+        return true;
+    };
 
-    const auto& required_inputs = stage->get_required_inputs();
-    common_inputs.insert(common_inputs.begin(), required_inputs.begin(), required_inputs.end());
+    // Required inputs without producer are already reported in build_stage_graph().
+    for (const size_t id: node.required_inputs)
+        bind_input(id);
 
-    for (const auto& input_binding: common_inputs)
+    for (const size_t id: common_inputs_)
     {
-        decltype(input_blocks_)::iterator input_blocks_found;
-
-        auto input_found = inputs_.find(input_binding);
-        if (input_found != inputs_.end())
-        {
-            stage->set_shader_input(input_found->second);
-        }
-        else if ((input_blocks_found = input_blocks_.find(input_binding)) != input_blocks_.end())
-        {
-            boost::apply_visitor([&](const auto& block){ block->bind_to(stage); }, input_blocks_found->second);
-        }
-        else
-        {
-            self_.error(fmt::format("Input {} is missing for {}", input_binding, stage->get_debug_name()));
-        }
+        if (!bind_input(id))
+            self_.error(fmt::format("Input {} is missing for {}", names_[id], stage->get_debug_name()));
     }
 
     return true;
 }
 
-void StageManager::Impl::register_stage_result(RenderStage* stage)
+void StageManager::Impl::register_stage_result(const StageNode& node)
 {
+    RenderStage* stage = node.stage;
+
     self_.trace(fmt::format("Registring the result of stage ({}).", stage->get_debug_name()));
 
-    for (const auto& pipe_data: stage->get_produced_pipes())
+    for (const auto& pipe_data: node.produced_pipes)
     {
         if (auto data = boost::get<ShaderInput>(&pipe_data))
-            pipes_.insert_or_assign(data->get_name()->get_name(), *data);
+            resources_[intern(data->get_name()->get_name())].pipe = *data;
         else if (auto data = boost::get<std::shared_ptr<SimpleInputBlock>>(&pipe_data))
-            input_blocks_.insert_or_assign((*data)->get_name(), *data);
+            resources_[intern((*data)->get_name())].block = InputBlockType(*data);
         else if (auto data = boost::get<std::shared_ptr<GroupedInputBlock>>(&pipe_data))
-            input_blocks_.insert_or_assign((*data)->get_name(), *data);
+            resources_[intern((*data)->get_name())].block = InputBlockType(*data);
     }
 
-    for (const auto& define: stage->get_produced_defines())
+    for (const auto& define: node.produced_defines)
     {
         if (defines_.find(define.first) != defines_.end())
             self_.warn(fmt::format("Stage {} overrides define {}", stage->get_debug_name(), define.first));
         defines_[define.first] = define.second;
     }
 
-    for (const auto& input_data: stage->get_produced_inputs())
+    for (const auto& input_data: node.produced_inputs)
     {
         if (auto data = boost::get<ShaderInput>(&input_data))
         {
             const auto& input_name = data->get_name()->get_name();
-            if (inputs_.find(input_name) != inputs_.end())
+            auto& resource = resources_[intern(input_name)];
+            if (resource.input)
                 self_.warn(fmt::format("Stage {} overrides input {}", stage->get_debug_name(), input_name));
-            inputs_.insert_or_assign(input_name, *data);
+            resource.input = *data;
         }
         else if (auto data = boost::get<std::shared_ptr<SimpleInputBlock>>(&input_data))
         {
-            input_blocks_.insert_or_assign((*data)->get_name(), *data);
+            resources_[intern((*data)->get_name())].block = InputBlockType(*data);
         }
         else if (auto data = boost::get<std::shared_ptr<GroupedInputBlock>>(&input_data))
         {
-            input_blocks_.insert_or_assign((*data)->get_name(), *data);
+            resources_[intern((*data)->get_name())].block = InputBlockType(*data);
+        }
+    }
+}
+
+void StageManager::Impl::unregister_stage_result(const StageNode& node)
+{
+    for (const auto* produced: { &node.produced_pipes, &node.produced_inputs })
+    {
+        const bool is_pipe = produced == &node.produced_pipes;
+        for (const auto& data: *produced)
+        {
+            auto& resource = resources_[intern(get_produce_name(data))];
+            if (boost::get<ShaderInput>(&data))
+            {
+                if (is_pipe)
+                    resource.pipe.reset();
+                else
+                    resource.input.reset();
+            }
+            else
+            {
+                resource.block.reset();
+            }
         }
     }
+
+    for (const auto& define: node.produced_defines)
+        defines_.erase(define.first);
 }
 
 bool StageManager::Impl::create_previous_pipes()
@@ -287,16 +705,17 @@ bool StageManager::Impl::create_previous_pipes()
     if (!previous_pipes_.empty())
     {
         prev_stage_ = std::make_shared<UpdatePreviousPipesStage>(pipeline_);
+        const RenderStage* stage = prev_stage_.get();
+        ResourceRegistry::OwnerScope owner_scope(fmt::format("{}:{}", stage->get_plugin_id(), stage->get_stage_id()));
         for (const auto& prev_pipe_tex: previous_pipes_)
         {
-            if (pipes_.find(prev_pipe_tex.first) == pipes_.end())
-            {
-                self_.error(fmt::format("Attempted to use previous frame data from pipe {} - however, that pipe was never created!", prev_pipe_tex.first));
-                return false;
-            }
+            // A pipe without producer is already reported in build_stage_graph().
+            const auto& src_pipe = resources_[prev_pipe_tex.first].pipe;
+            if (!src_pipe)
+                continue;
 
             const auto& dest_tex = prev_pipe_tex.second;
-            Texture* src_tex = pipes_.at(prev_pipe_tex.first).get_texture();
+            Texture* src_tex = src_pipe->get_texture();
 
             // re-setup for layered texture when stereo mode.
             if (src_tex->get_texture_type() == Texture::TextureType::TT_2d_texture_array)
@@ -323,16 +742,41 @@ void StageManager::Impl::apply_future_bindings()
 {
     for (const auto& pipe_stage: future_bindings_)
     {
-        if (pipes_.find(pipe_stage.first) == pipes_.end())
-        {
-            self_.error(fmt::format("Could not bind future pipe: {} not present!", pipe_stage.first));
-            continue;
-        }
-        pipe_stage.second->set_shader_input(pipes_.at(pipe_stage.first));
+        // A pipe without producer is already reported in build_stage_graph().
+        const auto& pipe = resources_[pipe_stage.first].pipe;
+        if (pipe)
+            pipe_stage.second->set_shader_input(*pipe);
     }
     future_bindings_.clear();
 }
 
+void StageManager::Impl::reset_stage_timings()
+{
+    static PStatCollector update_stages_collector("App:Show code:RP_UpdateStages");
+
+    stage_timings_.clear();
+    stage_collectors_.clear();
+    for (const auto& stage: stages_)
+    {
+        stage_timings_.emplace_back();
+        stage_timings_.back().stage_id = stage->get_stage_id();
+        stage_timings_.back().active = stage->get_active();
+        stage_collectors_.emplace_back(update_stages_collector, stage->get_stage_id());
+    }
+}
+
+void StageManager::Impl::collect_grouped_blocks()
+{
+    grouped_blocks_.clear();
+    for (const auto& resource: resources_)
+    {
+        if (!resource.block)
+            continue;
+        if (auto block = boost::get<std::shared_ptr<GroupedInputBlock>>(&resource.block.get()))
+            grouped_blocks_.push_back(*block);
+    }
+}
+
 // ************************************************************************************************
 
 StageManager::StageManager(RenderPipeline& pipeline): RPObject("StageManager"), impl_(std::make_unique<Impl>(*this, pipeline))
@@ -357,15 +801,16 @@ const StageManager::DefinesType& StageManager::get_defines() const
 
 void StageManager::add_input(const ShaderInput& inp)
 {
-    impl_->inputs_.insert_or_assign(inp.get_name()->get_name(), inp);
+    impl_->resources_[impl_->intern(inp.get_name()->get_name())].input = inp;
 }
 
 const ShaderInput& StageManager::get_pipe(const std::string& pipe_name) const
 {
-    if (impl_->pipes_.find(pipe_name) == impl_->pipes_.end())
+    const int id = impl_->find_id(pipe_name);
+    if (id < 0 || !impl_->resources_[id].pipe)
         return ShaderInput::get_blank();
     else
-        return impl_->pipes_.at(pipe_name);
+        return *impl_->resources_[id].pipe;
 }
 
 void StageManager::add_input_blocks(const std::shared_ptr<SimpleInputBlock>& input_block)
@@ -387,7 +832,7 @@ void StageManager::add_stage(RenderStage* stage)
 {
     trace(fmt::format("Adding stage ({}) ...", stage->get_debug_name()));
 
-    if (std::find(impl_->stage_order_.begin(), impl_->stage_order_.end(), stage->get_stage_id()) == std::end(impl_->stage_order_))
+    if (impl_->stage_order_index_.find(stage->get_stage_id()) == impl_->stage_order_index_.end())
     {
         error(fmt::format("The stage type {} is not registered yet! Please add it to the StageManager!", stage->get_debug_name()));
         return;
@@ -408,7 +853,12 @@ void StageManager::remove_stage(RenderStage* stage)
 
     auto found = std::find(impl_->stages_.begin(), impl_->stages_.end(), stage);
     if (found != std::end(impl_->stages_))
+    {
         impl_->stages_.erase(found);
+        impl_->culled_stages_.erase(stage);
+        if (impl_->created_)
+            impl_->reset_stage_timings();
+    }
 }
 
 RenderStage* StageManager::get_stage(boost::string_view stage_id) const
@@ -427,34 +877,361 @@ void StageManager::setup()
     // Convert input blocks so we can access them in a better way
     for (const auto& block: impl_->input_block_list_)
     {
-        boost::apply_visitor([this](const auto& block) {
-            const auto& block_name = block->get_name();
-            impl_->input_blocks_.insert_or_assign(block_name, std::move(block));
-        }, block);
+        const auto& block_name = boost::apply_visitor([](const auto& block) { return block->get_name(); }, block);
+        impl_->resources_[impl_->intern(block_name)].block = block;
     }
     impl_->input_block_list_.clear();
 
+    impl_->common_inputs_.clear();
+    if (!impl_->pipeline_.is_stereo_mode())
+    {
+        impl_->common_inputs_.push_back(impl_->intern("mainCam"));
+        impl_->common_inputs_.push_back(impl_->intern("mainRender"));
+    }
+    impl_->common_inputs_.push_back(impl_->intern("MainSceneData"));
+    impl_->common_inputs_.push_back(impl_->intern("TimeOfDay"));
+
     impl_->prepare_stages();
 
     for (auto&& stage: impl_->stages_)
     {
         debug(fmt::format("Creating stage ({}) ...", stage->get_debug_name()));
+        ResourceRegistry::OwnerScope owner_scope(fmt::format("{}:{}", stage->get_plugin_id(), stage->get_stage_id()));
         stage->create();
 
         trace(fmt::format("Stage ({}) handles window re-sizing.", stage->get_debug_name()));
         stage->handle_window_resize();
 
+        alias_stage_targets(stage);
+    }
+
+    // Produced pipes are known only after the stages are created.
+    const bool valid_graph = impl_->build_stage_graph();
+
+    for (const auto& node: impl_->stage_graph_)
+    {
+        // Apply the inputs to each target at once, instead of creating a state per input.
+        node.stage->defer_shader_inputs();
+
         // Rely on the methods to print an appropriate error message
-        if (!impl_->bind_pipes_to_stage(stage))
-            continue;
-        if (!impl_->bind_inputs_to_stage(stage))
-            continue;
+        const bool bound = impl_->bind_pipes_to_stage(node) && impl_->bind_inputs_to_stage(node);
 
-        impl_->register_stage_result(stage);
+        node.stage->commit_shader_inputs();
+
+        if (bound)
+            impl_->register_stage_result(node);
     }
 
     impl_->create_previous_pipes();
     impl_->apply_future_bindings();
+
+    // Culling an incomplete graph would disable stages which are actually used.
+    if (valid_graph)
+        impl_->cull_unused_stages();
+
+    impl_->reset_stage_timings();
+    impl_->collect_grouped_blocks();
+
+    const auto& pool_stats = RenderTarget::get_pool_stats();
+    debug(fmt::format("Transient targets: {} targets in {} allocations, {:.1f} MiB allocated "
+        "(requested {:.1f} MiB, peak {:.1f} MiB)",
+        pool_stats.num_targets, pool_stats.num_allocations,
+        pool_stats.allocated_bytes / 1048576.0, pool_stats.requested_bytes / 1048576.0,
+        pool_stats.peak_bytes / 1048576.0));
+
+    trace(dump_stage_graph());
+}
+
+std::vector<RenderStage*> StageManager::rebuild_stages(const std::vector<RenderStage*>& stages)
+{
+    std::vector<RenderStage*> rebuilt_stages;
+    if (!impl_->created_)
+    {
+        error("Cannot rebuild stages, stages are not created yet!");
+        return rebuilt_stages;
+    }
+
+    for (const auto& node: impl_->stage_graph_)
+    {
+        if (std::find(stages.begin(), stages.end(), node.stage) != stages.end())
+            rebuilt_stages.push_back(node.stage);
+    }
+
+    if (rebuilt_stages.empty())
+        return rebuilt_stages;
+
+    const std::unordered_set<RenderStage*> rebuilt_set(rebuilt_stages.begin(), rebuilt_stages.end());
+
+    // Sorts of the targets of all stages including the previous pipes.
+    std::set<int> all_sorts;
+    for (const auto& stage: impl_->stages_)
+    {
+        const auto& sorts = get_target_sorts(stage);
+        all_sorts.insert(sorts.begin(), sorts.end());
+    }
+
+    // The stage of the previous pipes is not a part of the graph.
+    if (impl_->prev_stage_)
+        impl_->stages_.erase(std::remove(impl_->stages_.begin(), impl_->stages_.end(), impl_->prev_stage_.get()), impl_->stages_.end());
+
+    // All results are registered again in the stage order below.
+    bool previous_pipes_changed = false;
+    for (const auto& node: impl_->stage_graph_)
+    {
+        impl_->unregister_stage_result(node);
+
+        if (rebuilt_set.find(node.stage) == rebuilt_set.end())
+            continue;
+
+        for (const auto& name: node.outputs)
+        {
+            const int id = impl_->find_id(name);
+            if (id >= 0 && impl_->previous_pipes_.find(id) != impl_->previous_pipes_.end())
+                previous_pipes_changed = true;
+        }
+    }
+
+    for (auto&& stage: rebuilt_stages)
+    {
+        debug(fmt::format("Rebuilding stage ({}) ...", stage->get_debug_name()));
+
+        // New targets take the sorts up to the first target of the next stage.
+        const auto& old_sorts = get_target_sorts(stage);
+
+        const bool active = stage->get_active();
+        stage->remove_all_targets();
+        {
+            ResourceRegistry::OwnerScope owner_scope(fmt::format("{}:{}", stage->get_plugin_id(), stage->get_stage_id()));
+            stage->create();
+            stage->handle_window_resize();
+        }
+        stage->set_active(active);
+
+        if (!old_sorts.empty())
+        {
+            auto next_sort = all_sorts.upper_bound(*old_sorts.rbegin());
+            move_target_sorts(stage, *old_sorts.begin(), next_sort == all_sorts.end() ? RenderTarget::CURRENT_SORT + 20 : *next_sort);
+        }
+
+        alias_stage_targets(stage);
+    }
+
+    const bool valid_graph = impl_->build_stage_graph();
+
+    // Bind again the rebuilt stages and the stages using their results.
+    const size_t previous_pipe_count = impl_->previous_pipes_.size();
+    impl_->future_bindings_.clear();
+    std::vector<std::string> rebound_stages;
+    for (const auto& node: impl_->stage_graph_)
+    {
+        bool bound = true;
+        if (rebuilt_set.find(node.stage) != rebuilt_set.end() ||
+            std::any_of(node.producers.begin(), node.producers.end(), [&](size_t producer) {
+                return rebuilt_set.find(impl_->stage_graph_[producer].stage) != rebuilt_set.end();
+            }))
+        {
+            node.stage->defer_shader_inputs();
+            bound = impl_->bind_pipes_to_stage(node) && impl_->bind_inputs_to_stage(node);
+            node.stage->commit_shader_inputs();
+            rebound_stages.push_back(node.stage->get_stage_id());
+        }
+
+        if (bound)
+            impl_->register_stage_result(node);
+    }
+
+    // The previous pipes copy the textures of the rebuilt stages.
+    if (previous_pipes_changed || impl_->previous_pipes_.size() != previous_pipe_count)
+    {
+        impl_->prev_stage_.reset();
+        impl_->create_previous_pipes();
+        if (impl_->prev_stage_)
+            impl_->prev_stage_->reload_shaders();
+    }
+    else if (impl_->prev_stage_)
+    {
+        impl_->stages_.push_back(impl_->prev_stage_.get());
+    }
+
+    impl_->apply_future_bindings();
+
+    if (valid_graph)
+        impl_->cull_unused_stages();
+
+    impl_->reset_stage_timings();
+    impl_->collect_grouped_blocks();
+
+    write_autoconfig();
+    for (auto&& stage: rebuilt_stages)
+        stage->reload_shaders();
+
+    debug(fmt::format("Rebuilt {} stages, bound again {} stages: {}",
+        rebuilt_stages.size(), rebound_stages.size(), boost::algorithm::join(rebound_stages, ", ")));
+
+    return rebuilt_stages;
+}
+
+std::string StageManager::dump_stage_graph() const
+{
+    std::string output = "digraph StageGraph {\n";
+    for (size_t k = 0, k_end = impl_->stage_graph_.size(); k < k_end; ++k)
+    {
+        const auto& node = impl_->stage_graph_[k];
+        output += fmt::format("    s{} [label=\"{}\\n{}\"{}{}];\n",
+            k,
+            node.stage->get_stage_id(),
+            boost::algorithm::join(node.outputs, "\\n"),
+            node.sink ? " shape=box" : "",
+            node.alive ? "" : " style=dashed");
+
+        for (const size_t producer: node.producers)
+            output += fmt::format("    s{} -> s{};\n", producer, k);
+    }
+    output += "}\n";
+    return output;
+}
+
+std::string StageManager::dump_frame_graph() const
+{
+    // Transient targets in the same pool slot share their attachments, so each
+    // attachment is counted once by { pool slot or target, attachment name }.
+    std::set<std::tuple<int, const RenderTarget*, std::string>> counted_attachments;
+    size_t total_bytes = 0;
+
+    std::string stages;
+    for (size_t k = 0, k_end = impl_->stage_graph_.size(); k < k_end; ++k)
+    {
+        const auto& node = impl_->stage_graph_[k];
+
+        std::vector<std::string> required_pipes;
+        for (const auto& pipe: node.required_pipes)
+        {
+            const std::string prefix = pipe.frame == Impl::PipeFrame::previous ? Impl::previous_frame_prefix :
+                pipe.frame == Impl::PipeFrame::future ? Impl::future_pipe_prefix : "";
+            required_pipes.push_back(prefix + impl_->names_[pipe.id]);
+        }
+
+        std::vector<std::string> required_inputs;
+        for (const size_t id: node.required_inputs)
+            required_inputs.push_back(impl_->names_[id]);
+
+        std::vector<std::string> produced_pipes;
+        for (const auto& data: node.produced_pipes)
+            produced_pipes.push_back(get_produce_name(data));
+
+        std::vector<std::string> produced_inputs;
+        for (const auto& data: node.produced_inputs)
+            produced_inputs.push_back(get_produce_name(data));
+
+        std::vector<std::pair<std::string, std::string>> produced_defines(node.produced_defines.begin(), node.produced_defines.end());
+        std::sort(produced_defines.begin(), produced_defines.end());
+        std::string defines;
+        for (const auto& define: produced_defines)
+            defines += fmt::format("{}\"{}\": \"{}\"", defines.empty() ? "" : ", ", escape_json(define.first), escape_json(define.second));
+
+        std::vector<std::pair<std::string, const RenderTarget*>> targets;
+        for (const auto& kv: node.stage->get_targets())
+            targets.emplace_back(kv.first, kv.second.get());
+        std::sort(targets.begin(), targets.end(), [](const auto& lhs, const auto& rhs) {
+            const int lhs_sort = lhs.second->get_sort().value_or(0);
+            const int rhs_sort = rhs.second->get_sort().value_or(0);
+            return lhs_sort != rhs_sort ? lhs_sort < rhs_sort : lhs.first < rhs.first;
+        });
+
+        size_t stage_bytes = 0;
+        std::string targets_json;
+        for (const auto& kv: targets)
+        {
+            const RenderTarget* target = kv.second;
+
+            // Bytes are estimated from the attachments, because headless targets
+            // have no bound textures whose formats are known.
+            const auto& attachment_bytes = target->get_estimated_attachment_bytes();
+            std::vector<std::pair<std::string, size_t>> attachments(attachment_bytes.begin(), attachment_bytes.end());
+            std::sort(attachments.begin(), attachments.end());
+
+            const auto& textures = target->get_targets();
+            const int pool_slot = target->get_pool_slot();
+
+            size_t bytes = 0;
+            std::string textures_json;
+            for (const auto& attachment: attachments)
+            {
+                bytes += attachment.second;
+                if (counted_attachments.emplace(pool_slot, pool_slot < 0 ? target : nullptr, attachment.first).second)
+                    stage_bytes += attachment.second;
+
+                auto found = textures.find(attachment.first);
+                textures_json += fmt::format("{}\n            {{\"attachment\": \"{}\", \"texture\": {}}}",
+                    textures_json.empty() ? "" : ",", attachment.first,
+                    found == textures.end() ? "null" : format_texture_json(found->second, attachment.second));
+            }
+
+            targets_json += fmt::format("{}\n        {{\"name\": \"{}\", \"active\": {}, \"sort\": {}, \"transient\": {}, "
+                "\"pool_slot\": {}, \"shared_buffer\": {}, \"bytes\": {}, \"attachments\": [{}\n        ]}}",
+                targets_json.empty() ? "" : ",",
+                escape_json(kv.first), target->get_active(),
+                target->get_sort() ? std::to_string(*target->get_sort()) : "null",
+                target->is_transient(), pool_slot, target->is_buffer_shared(), bytes, textures_json);
+        }
+        total_bytes += stage_bytes;
+
+        std::string producers;
+        for (const size_t producer: node.producers)
+            producers += fmt::format("{}{}", producers.empty() ? "" : ", ", producer);
+
+        stages += fmt::format("{}\n    {{\"index\": {}, \"id\": \"{}\", \"plugin\": \"{}\", \"active\": {}, \"alive\": {}, \"sink\": {}, "
+            "\"producers\": [{}],\n      \"required_pipes\": {},\n      \"required_inputs\": {},\n"
+            "      \"produced_pipes\": {},\n      \"produced_inputs\": {},\n      \"produced_defines\": {{{}}},\n"
+            "      \"bytes\": {},\n      \"targets\": [{}\n      ]}}",
+            stages.empty() ? "" : ",",
+            k, escape_json(node.stage->get_stage_id()), escape_json(node.stage->get_plugin_id()),
+            node.stage->get_active(), node.alive, node.sink, producers,
+            format_string_list_json(required_pipes), format_string_list_json(required_inputs),
+            format_string_list_json(produced_pipes), format_string_list_json(produced_inputs),
+            defines, stage_bytes, targets_json);
+    }
+
+    std::vector<std::pair<std::string, const Texture*>> previous_textures;
+    for (const auto& kv: impl_->previous_pipes_)
+        previous_textures.emplace_back(impl_->names_[kv.first], kv.second->get_texture());
+    std::sort(previous_textures.begin(), previous_textures.end());
+
+    std::string previous_pipes;
+    for (const auto& kv: previous_textures)
+    {
+        const size_t bytes = ResourceRegistry::compute_texture_bytes(kv.second);
+        total_bytes += bytes;
+        previous_pipes += fmt::format("{}\n    {{\"pipe\": \"{}\", \"texture\": {}}}",
+            previous_pipes.empty() ? "" : ",", escape_json(kv.first), format_texture_json(kv.second, bytes));
+    }
+
+    std::vector<std::pair<std::string, std::string>> sorted_defines(impl_->defines_.begin(), impl_->defines_.end());
+    std::sort(sorted_defines.begin(), sorted_defines.end());
+    std::string defines;
+    for (const auto& define: sorted_defines)
+        defines += fmt::format("{}\n    \"{}\": \"{}\"", defines.empty() ? "" : ",", escape_json(define.first), escape_json(define.second));
+
+    std::string frame_cycles;
+    if (const TaskScheduler* scheduler = impl_->pipeline_.get_task_scheduler())
+    {
+        for (size_t k = 0, k_end = scheduler->get_num_frames(); k < k_end; ++k)
+            frame_cycles += fmt::format("{}\n      {}", frame_cycles.empty() ? "" : ",", format_string_list_json(scheduler->get_frame_task_names(k)));
+    }
+
+    return fmt::format("{{\n  \"total_bytes\": {},\n  \"stages\": [{}\n  ],\n  \"previous_pipes\": [{}\n  ],\n"
+        "  \"defines\": {{{}\n  }},\n  \"scheduling\": {{\n    \"frame_cycles\": [{}\n    ]\n  }}\n}}\n",
+        total_bytes, stages, previous_pipes, defines, frame_cycles);
+}
+
+bool StageManager::write_frame_graph(const Filename& path) const
+{
+    auto file = rppanda::open_write_file(path, false, true);
+    if (!file || !(*file))
+        return false;
+
+    (*file) << dump_frame_graph();
+    return file->good();
 }
 
 void StageManager::reload_shaders()
@@ -464,13 +1241,284 @@ void StageManager::reload_shaders()
         stage->reload_shaders();
 }
 
-void StageManager::update()
+static bool is_identifier_char(char c)
 {
+    return std::isalnum(static_cast<unsigned char>(c)) || c == '_';
+}
+
+/** Skips spaces and tabs from @p pos, and returns the new position. */
+static size_t skip_blanks(const std::string& content, size_t pos)
+{
+    while (pos < content.size() && (content[pos] == ' ' || content[pos] == '\t'))
+        ++pos;
+    return pos;
+}
+
+/**
+ * Parses '#pragma include "path"' or '#pragma include <path>' at @p pos, which is
+ * the position of '#'. Returns an empty string if the line is not an include.
+ */
+static std::string parse_include_directive(const std::string& content, size_t pos)
+{
+    static const std::string pragma = "pragma";
+    static const std::string include = "include";
+
+    pos = skip_blanks(content, pos + 1);
+    if (content.compare(pos, pragma.size(), pragma) != 0)
+        return "";
+
+    pos = skip_blanks(content, pos + pragma.size());
+    if (content.compare(pos, include.size(), include) != 0)
+        return "";
+
+    pos = skip_blanks(content, pos + include.size());
+    if (pos >= content.size() || (content[pos] != '"' && content[pos] != '<'))
+        return "";
+
+    const char closing = content[pos] == '"' ? '"' : '>';
+    const size_t path_end = content.find_first_of(std::string(1, closing) + "\n", pos + 1);
+    if (path_end == std::string::npos || content[path_end] != closing)
+        return "";
+
+    return content.substr(pos + 1, path_end - pos - 1);
+}
+
+/**
+ * Parses the arguments of a macro invocation at @p pos, which is the position
+ * after the macro name. Returns false if there is no argument list of identifiers.
+ */
+static bool parse_macro_arguments(const std::string& content, size_t pos, std::vector<std::string>& arguments)
+{
+    pos = skip_blanks(content, pos);
+    if (pos >= content.size() || content[pos] != '(')
+        return false;
+
+    const size_t args_end = content.find(')', pos + 1);
+    if (args_end == std::string::npos)
+        return false;
+
+    boost::split(arguments, content.substr(pos + 1, args_end - pos - 1), boost::is_any_of(","));
+    for (auto& argument: arguments)
+    {
+        boost::trim(argument);
+        if (argument.empty() || !std::all_of(argument.begin(), argument.end(), is_identifier_char))
+            return false;
+    }
+
+    return true;
+}
+
+/**
+ * Adds the identifiers which a macro of render_pipeline_base.inc.glsl pastes from
+ * its arguments, e.g. GET_SETTING(ao, blur_quality) reads the define 'ao_blur_quality'.
+ * @p pos is the position after the macro name.
+ */
+static void add_pasted_identifiers(const std::string& content, size_t pos, const std::string& macro,
+    std::unordered_set<std::string>& identifiers)
+{
+    static const std::unordered_set<std::string> pasting_macros = {
+        "HAVE_PLUGIN", "MODE_ACTIVE", "SPECIAL_MODE_ACTIVE", "GET_SETTING", "GET_ENUM_VALUE", "ENUM_V_ACTIVE" };
+
+    std::vector<std::string> args;
+    if (pasting_macros.find(macro) == pasting_macros.end() || !parse_macro_arguments(content, pos, args))
+        return;
+
+    if (args.size() == 1 && macro == "HAVE_PLUGIN")
+    {
+        identifiers.insert("HAVE_PLUGIN_" + args[0]);
+    }
+    else if (args.size() == 1 && (macro == "MODE_ACTIVE" || macro == "SPECIAL_MODE_ACTIVE"))
+    {
+        identifiers.insert("_RM_" + args[0]);
+    }
+    else if (args.size() == 2 && macro == "GET_SETTING")
+    {
+        identifiers.insert(args[0] + "_" + args[1]);
+    }
+    else if (args.size() == 3 && macro == "GET_ENUM_VALUE")
+    {
+        identifiers.insert("enum_" + args[0] + "_" + args[1] + "_" + args[2]);
+    }
+    else if (args.size() == 3 && macro == "ENUM_V_ACTIVE")
+    {
+        identifiers.insert("HAVE_PLUGIN_" + args[0]);
+        identifiers.insert(args[0] + "_" + args[1]);
+        identifiers.insert("enum_" + args[0] + "_" + args[1] + "_" + args[2]);
+    }
+}
+
+/**
+ * Returns whether the shader file or one of its includes uses any of the defines.
+ *
+ * The shader configuration is skipped, because it contains all defines.
+ * @p in_progress holds the files being scanned to terminate include cycles.
+ * A result which depends on a file being scanned is not final, so it is stored
+ * in @p cache only if @p complete stays true.
+ */
+static bool shader_uses_defines(const Filename& path, const std::unordered_set<std::string>& defines,
+    std::unordered_map<std::string, bool>& cache, std::unordered_set<std::string>& in_progress, bool& complete)
+{
+    static const std::string shader_config_path = "/$$rptemp/$$pipeline_shader_config.inc.glsl";
+
+    const std::string& fullpath = path.get_fullpath();
+    if (fullpath == shader_config_path)
+        return false;
+
+    auto found = cache.find(fullpath);
+    if (found != cache.end())
+        return found->second;
+
+    if (in_progress.find(fullpath) != in_progress.end())
+    {
+        complete = false;
+        return false;
+    }
+
+    VirtualFileSystem* vfs = VirtualFileSystem::get_global_ptr();
+    std::string content;
+    if (!vfs->read_file(path, content, true))
+    {
+        // Unknown content, so assume that it is used.
+        cache[fullpath] = true;
+        return true;
+    }
+
+    std::unordered_set<std::string> identifiers;
+    std::vector<std::string> includes;
+    for (size_t pos = 0, pos_end = content.size(); pos < pos_end;)
+    {
+        if (content[pos] == '#')
+        {
+            std::string include = parse_include_directive(content, pos);
+            if (!include.empty())
+                includes.push_back(std::move(include));
+            ++pos;
+            continue;
+        }
+
+        if (!is_identifier_char(content[pos]) || std::isdigit(static_cast<unsigned char>(content[pos])))
+        {
+            ++pos;
+            continue;
+        }
+
+        size_t end = pos;
+        while (end < pos_end && is_identifier_char(content[end]))
+            ++end;
+
+        std::string identifier = content.substr(pos, end - pos);
+        add_pasted_identifiers(content, end, identifier, identifiers);
+        identifiers.insert(std::move(identifier));
+        pos = end;
+    }
+
+    bool used = std::any_of(defines.begin(), defines.end(), [&](const std::string& define) {
+        return identifiers.find(define) != identifiers.end();
+    });
+
+    bool local_complete = true;
+    if (!used && !includes.empty())
+    {
+        in_progress.insert(fullpath);
+
+        DSearchPath search_path(path.get_dirname());
+        search_path.append_path(get_model_path().get_value());
+
+        for (const auto& include: includes)
+        {
+            Filename include_path(include);
+            if (vfs->resolve_filename(include_path, search_path))
+                used = shader_uses_defines(include_path, defines, cache, in_progress, local_complete);
+            if (used)
+                break;
+        }
+
+        in_progress.erase(fullpath);
+    }
+
+    // Without any file being scanned, the whole include tree is known.
+    if (used || local_complete || in_progress.empty())
+        cache[fullpath] = used;
+    else
+        complete = false;
+
+    return used;
+}
+
+std::vector<RenderStage*> StageManager::reload_shaders(const std::unordered_set<std::string>& changed_defines,
+    const std::unordered_set<RenderStage*>& skip_stages)
+{
+    write_autoconfig();
+
+    std::vector<RenderStage*> reloaded_stages;
+    if (changed_defines.empty())
+        return reloaded_stages;
+
+    std::unordered_map<std::string, bool> cache;
+    std::unordered_set<std::string> in_progress;
     for (const auto& stage: impl_->stages_)
     {
-        if (stage->get_active())
+        if (skip_stages.find(stage) != skip_stages.end())
+            continue;
+
+        const auto& shader_files = stage->get_shader_files();
+        bool used = shader_files.empty();
+        for (const auto& path: shader_files)
+        {
+            if (used)
+                break;
+            bool complete = true;
+            used = shader_uses_defines(path, changed_defines, cache, in_progress, complete);
+        }
+
+        if (used)
+        {
+            stage->reload_shaders();
+            reloaded_stages.push_back(stage);
+        }
+    }
+
+    debug(fmt::format("Reloaded shaders of {} of {} stages", reloaded_stages.size(), impl_->stages_.size()));
+
+    return reloaded_stages;
+}
+
+void StageManager::update()
+{
+    // weight of the current frame in the moving average
+    static constexpr double average_weight = 0.05;
+
+    for (size_t k = 0, k_end = impl_->stages_.size(); k < k_end; ++k)
+    {
+        RenderStage* stage = impl_->stages_[k];
+        auto& timing = impl_->stage_timings_[k];
+
+        timing.active = stage->get_active();
+        if (!timing.active)
+        {
+            timing.update_time = 0;
+            continue;
+        }
+
+        const auto& start_time = std::chrono::steady_clock::now();
+        {
+            PStatTimer timer(impl_->stage_collectors_[k]);
             stage->update();
+        }
+        const std::chrono::duration<double, std::milli>& duration = std::chrono::steady_clock::now() - start_time;
+
+        timing.update_time = duration.count();
+        timing.average_time += (timing.update_time - timing.average_time) * average_weight;
     }
+
+    // Inputs of the blocks are updated by managers, plugins and stages until now.
+    for (const auto& block: impl_->grouped_blocks_)
+        block->flush();
+}
+
+const std::vector<StageManager::StageTiming>& StageManager::get_stage_timings() const
+{
+    return impl_->stage_timings_;
 }
 
 void StageManager::handle_window_resize()
@@ -491,14 +1539,8 @@ void StageManager::write_autoconfig()
     for (const auto& key_val: impl_->defines_)
         output += std::string("#define ") + key_val.first + " " + key_val.second + "\n";
 
-    try
-    {
-        (*rppanda::open_write_file("/$$rptemp/$$pipeline_shader_config.inc.glsl", false, true)) << output;
-    }
-    catch (const std::exception& err)
-    {
-        error(fmt::format("Error writing shader autoconfig: {}", err.what()));
-    }
+    if (!MountManager::write_temp_file("/$$rptemp/$$pipeline_shader_config.inc.glsl", output))
+        error("Error writing shader autoconfig");
 }
 
 }
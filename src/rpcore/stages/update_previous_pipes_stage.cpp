@@ -22,7 +22,7 @@
 
 #include "render_pipeline/rpcore/stages/update_previous_pipes_stage.hpp"
 
-#include "render_pipeline/rppanda/stdpy/file.hpp"
+#include "render_pipeline/rpcore/mount_manager.hpp"
 #include "render_pipeline/rpcore/render_target.hpp"
 #include "render_pipeline/rpcore/globals.hpp"
 
@@ -115,14 +115,11 @@ void UpdatePreviousPipesStage::reload_shaders()
     fragment += "}\n";
 
     // Write the shader
-    const std::string shader_dest("/$$rptemp/$$update_previous_pipes.frag.glsl");
-    try
+    const Filename shader_dest = MountManager::store_cache_file("update_previous_pipes", fragment, ".frag.glsl");
+    if (shader_dest.empty())
     {
-        (*rppanda::open_write_file(shader_dest, false, true)) << fragment;
-    }
-    catch (const std::exception& err)
-    {
-        error(std::string("Error writing shader autoconfig: ") + err.what());
+        error("Error writing shader autoconfig");
+        return;
     }
 
     // Load it back again
@@ -0,0 +1,128 @@
+/**
+ * Render Pipeline C++
+ *
+ * Copyright (c) 2014-2016 tobspr <tobias.springer1@gmail.com>
+ * Copyright (c) 2016-2017 Center of Human-centered Interaction for Coexistence.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+ * and associated documentation files (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial
+ * portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT
+ * LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "render_pipeline/rpcore/util/camera_matrices.hpp"
+
+namespace rpcore {
+
+int CameraMatrices::update(size_t eye, const LMatrix4f& view_mat, const LMatrix4f& proj_mat, bool compute_frustum)
+{
+    static const LVecBase2f points[4] = { LVecBase2f(-1, -1), LVecBase2f(1, -1), LVecBase2f(-1, 1), LVecBase2f(1, 1) };
+
+    Eye& e = eyes_[eye];
+    int changed = CF_none;
+
+    // The matrices of the previous update become the last matrices.
+    if (e.valid && e.last_view_proj_mat_no_jitter != e.view_proj_mat_no_jitter)
+    {
+        e.last_view_proj_mat_no_jitter = e.view_proj_mat_no_jitter;
+        e.last_inv_view_proj_mat_no_jitter = e.inv_view_proj_mat_no_jitter;
+        changed |= CF_last_view_projection;
+    }
+
+    const bool view_changed = !e.valid || view_mat != e.view_mat;
+    const bool proj_changed = !e.valid || proj_mat != e.proj_mat;
+    if (!view_changed && !proj_changed)
+        return changed;
+
+    bool no_jitter_changed = view_changed;
+
+    if (view_changed)
+    {
+        e.view_mat = view_mat;
+
+        // The view matrix is a rigid transform (without projection).
+        e.view_mat_inv.invert_affine_from(view_mat);
+
+        // Compute the view matrix, but with a z-up coordinate system
+        e.view_mat_z_up = view_mat * LMatrix4f::z_to_y_up_mat();
+
+        // Compute the view matrix without the camera rotation
+        e.view_mat_billboard = view_mat;
+        e.view_mat_billboard.set_row(0, LVecBase3f(1, 0, 0));
+        e.view_mat_billboard.set_row(1, LVecBase3f(0, 1, 0));
+        e.view_mat_billboard.set_row(2, LVecBase3f(0, 0, 1));
+
+        e.camera_pos = e.view_mat_inv.get_row3(3);
+
+        changed |= CF_view;
+    }
+
+    if (proj_changed)
+    {
+        e.proj_mat = proj_mat;
+        e.proj_mat_inv.invert_from(proj_mat);
+
+        // Convert the projection matrix to the correct coordinate system.
+        // The inverse of y_to_z_up_mat is z_to_y_up_mat.
+        e.proj_mat_z_up = LMatrix4f::y_to_z_up_mat() * proj_mat;
+        e.inv_proj_mat_z_up = e.proj_mat_inv * LMatrix4f::z_to_y_up_mat();
+
+        // Remove jitter. The result only changes when the lens changes.
+        LMatrix4f proj_mat_no_jitter(proj_mat);
+        proj_mat_no_jitter.set_cell(1, 0, 0.0f);
+        proj_mat_no_jitter.set_cell(1, 1, 0.0f);
+        if (!e.valid || proj_mat_no_jitter != e.proj_mat_no_jitter)
+        {
+            e.proj_mat_no_jitter = proj_mat_no_jitter;
+            e.proj_mat_no_jitter_inv.invert_from(proj_mat_no_jitter);
+            no_jitter_changed = true;
+        }
+
+        changed |= CF_projection;
+    }
+
+    // inverse(V * P) = inverse(P) * inverse(V)
+    e.view_proj_mat = e.view_mat * e.proj_mat;
+    e.view_proj_mat_inv = e.proj_mat_inv * e.view_mat_inv;
+
+    if (no_jitter_changed)
+    {
+        e.view_proj_mat_no_jitter = e.view_mat * e.proj_mat_no_jitter;
+        e.inv_view_proj_mat_no_jitter = e.proj_mat_no_jitter_inv * e.view_mat_inv;
+    }
+
+    if (compute_frustum)
+    {
+        const LMatrix4f& zup_conversion = LMatrix4f::z_to_y_up_mat();
+        for (int i = 0; i < 4; ++i)
+        {
+            const LVecBase4f& result = e.proj_mat_inv.xform(LVecBase4f(points[i][0], points[i][1], 1.0f, 1.0f));
+            const LVecBase3f& vs_dir = zup_conversion.xform(result).get_xyz().normalized();
+            e.vs_frustum_directions.set_row(i, LVecBase4f(vs_dir, 1));
+            e.ws_frustum_directions.set_row(i, e.view_mat_inv.xform(LVecBase4f(result.get_xyz(), 0)));
+        }
+    }
+
+    // At first, there is no previous frame.
+    if (!e.valid)
+    {
+        e.last_view_proj_mat_no_jitter = e.view_proj_mat_no_jitter;
+        e.last_inv_view_proj_mat_no_jitter = e.inv_view_proj_mat_no_jitter;
+        e.valid = true;
+        changed |= CF_last_view_projection;
+    }
+
+    return changed;
+}
+
+}
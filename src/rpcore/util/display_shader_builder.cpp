@@ -28,6 +28,7 @@
 
 #include "render_pipeline/rppanda/stdpy/file.hpp"
 #include "render_pipeline/rpcore/loader.hpp"
+#include "render_pipeline/rpcore/mount_manager.hpp"
 #include "render_pipeline/rpcore/image.hpp"
 
 namespace rpcore {
@@ -48,14 +49,8 @@ PT(Shader) DisplayShaderBuilder::build(Texture* texture, int view_width, int vie
     {
         const std::string& fragment_shader = build_fragment_shader(texture, view_width, view_height);
 
-        try
-        {
-            (*rppanda::open_write_file(cache_key, false, true)) << fragment_shader;
-        }
-        catch (const std::exception& err)
-        {
-            RPObject::global_error("DisplayShaderBuilder", std::string("Error writing processed shader: ") + err.what());
-        }
+        if (!MountManager::write_temp_file(cache_key, fragment_shader))
+            RPObject::global_error("DisplayShaderBuilder", "Error writing processed shader");
     }
 
     return RPLoader::load_shader({"/$$rp/shader/default_gui_shader.vert.glsl", cache_key});
@@ -110,11 +105,13 @@ std::pair<std::string, std::string> DisplayShaderBuilder::generate_sampling_code
 
     std::vector<Texture::ComponentType> float_types = { Texture::T_float, Texture::T_unsigned_byte };
     std::vector<Texture::ComponentType> int_types = { Texture::T_int, Texture::T_unsigned_short, Texture::T_unsigned_int_24_8 };
+    std::vector<Texture::ComponentType> uint_types = { Texture::T_unsigned_int };
 
     std::pair<std::string, std::string> result = {"result = vec3(1, 0, 1);", "sampler2D"};
 
     if (std::find(float_types.begin(), float_types.end(), comp_type) == float_types.end() &&
-        std::find(int_types.begin(), int_types.end(), comp_type) == int_types.end())
+        std::find(int_types.begin(), int_types.end(), comp_type) == int_types.end() &&
+        std::find(uint_types.begin(), uint_types.end(), comp_type) == uint_types.end())
         RPObject::global_warn("DisplayShaderBuilder", std::string("Unkown texture component type: ") + std::to_string(comp_type));
 
 
@@ -140,6 +137,8 @@ std::pair<std::string, std::string> DisplayShaderBuilder::generate_sampling_code
                 result = {range_check("result = texelFetch(p3d_Texture0, int_index).xyz;"), "samplerBuffer"};
             else if (IS_IN(comp_type, int_types))
                 result = {range_check("result = texelFetch(p3d_Texture0, int_index).xyz / 10.0;"), "isamplerBuffer"};
+            else if (IS_IN(comp_type, uint_types))
+                result = {range_check("result = vec3(texelFetch(p3d_Texture0, int_index).xyz & 0xFFu) / 255.0;"), "usamplerBuffer"};
             break;
         }
     // 3D Textures
@@ -24,6 +24,8 @@
 
 #include <load_dso.h>
 
+#include <fmt/format.h>
+
 #include "render_pipeline/rppanda/util/filesystem.hpp"
 #include "render_pipeline/rplibs/py_to_cpp.hpp"
 #include "render_pipeline/rpcore/rpobject.hpp"
@@ -43,6 +45,28 @@ LVecBase3 rgb_from_string(const std::string& text, PN_stdfloat min_brightness)
     return ((rgb / 255) * neg_inf) + min_brightness;
 }
 
+std::string escape_json(const std::string& value)
+{
+    std::string result;
+    result.reserve(value.size());
+    for (const char c: value)
+    {
+        switch (c)
+        {
+        case '"': result += "\\\""; break;
+        case '\\': result += "\\\\"; break;
+        case '\n': result += "\\n"; break;
+        case '\t': result += "\\t"; break;
+        default:
+            if (static_cast<unsigned char>(c) < 0x20)
+                result += fmt::format("\\u{:04x}", int(c));
+            else
+                result += c;
+        }
+    }
+    return result;
+}
+
 void snap_shadow_map(const LMatrix4& mvp, NodePath cam_node, int resolution)
 {
     auto _mvp = mvp;
@@ -28,6 +28,7 @@
 #include <omniBoundingVolume.h>
 #include <orthographicLens.h>
 #include <graphicsOutput.h>
+#include <shaderAttrib.h>
 
 namespace rpcore {
 
@@ -67,6 +68,26 @@ PostProcessRegion::PostProcessRegion(GraphicsOutput* internal_buffer, const LVec
     init_function_pointers();
 }
 
+void PostProcessRegion::set_shader_inputs(const std::vector<ShaderInput>& inputs, bool override_input)
+{
+    if (inputs.empty())
+        return;
+
+    PandaNode* target = (override_input ? node : geom_np_).node();
+
+    CPT(RenderAttrib) attrib = target->get_attrib(ShaderAttrib::get_class_slot());
+    int priority = 0;
+    if (attrib)
+        priority = target->get_state()->get_override(ShaderAttrib::get_class_slot());
+    else
+        attrib = ShaderAttrib::make();
+
+    // Derive the attrib once for all inputs instead of once per input.
+    attrib = DCAST(ShaderAttrib, attrib)->set_shader_inputs(pvector<ShaderInput>(inputs.begin(), inputs.end()));
+
+    target->set_attrib(attrib, priority);
+}
+
 void PostProcessRegion::init_function_pointers()
 {
     using namespace std::placeholders;
@@ -0,0 +1,443 @@
+/**
+ * Render Pipeline C++
+ *
+ * Copyright (c) 2018 Center of Human-centered Interaction for Coexistence.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+ * and associated documentation files (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial
+ * portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT
+ * LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "render_pipeline/rpcore/util/raw_texture_file.hpp"
+
+#include <cstring>
+#include <fstream>
+
+#include <virtualFileSystem.h>
+#include <virtualFileSimple.h>
+#include <virtualFileMountSystem.h>
+
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+
+#include <fmt/format.h>
+
+#include "render_pipeline/rpcore/rpobject.hpp"
+
+namespace rpcore {
+
+/** Serialized size of RawTextureFile::Header. */
+static constexpr size_t HEADER_SIZE = 48;
+
+/** Serialized size of the header without the checksum, which is the last field. */
+static constexpr size_t HEADER_CHECKED_SIZE = 40;
+
+/** Serialized size of RawTextureFile::MipmapEntry. */
+static constexpr size_t MIPMAP_ENTRY_SIZE = 16;
+
+static const char* RAW_TEXTURE_CONTEXT = "RawTextureFile";
+
+// The file stores the index in these tables instead of the values of Panda3D,
+// so that the format does not depend on the version of Panda3D.
+// Append new values only at the end.
+
+static const Texture::TextureType FILE_TEXTURE_TYPES[] = {
+    Texture::TT_1d_texture,
+    Texture::TT_2d_texture,
+    Texture::TT_3d_texture,
+    Texture::TT_2d_texture_array,
+    Texture::TT_cube_map,
+    Texture::TT_cube_map_array,
+    Texture::TT_1d_texture_array,
+};
+
+static const Texture::ComponentType FILE_COMPONENT_TYPES[] = {
+    Texture::T_unsigned_byte,
+    Texture::T_unsigned_short,
+    Texture::T_float,
+    Texture::T_unsigned_int_24_8,
+    Texture::T_int,
+    Texture::T_byte,
+    Texture::T_short,
+    Texture::T_half_float,
+    Texture::T_unsigned_int,
+};
+
+static const Texture::Format FILE_FORMATS[] = {
+    Texture::F_depth_stencil,
+    Texture::F_red,
+    Texture::F_green,
+    Texture::F_blue,
+    Texture::F_alpha,
+    Texture::F_rgb,
+    Texture::F_rgb5,
+    Texture::F_rgb8,
+    Texture::F_rgb12,
+    Texture::F_rgb332,
+    Texture::F_rgba,
+    Texture::F_rgbm,
+    Texture::F_rgba4,
+    Texture::F_rgba5,
+    Texture::F_rgba8,
+    Texture::F_rgba12,
+    Texture::F_luminance,
+    Texture::F_luminance_alpha,
+    Texture::F_luminance_alphamask,
+    Texture::F_rgba16,
+    Texture::F_rgba32,
+    Texture::F_depth_component,
+    Texture::F_depth_component16,
+    Texture::F_depth_component24,
+    Texture::F_depth_component32,
+    Texture::F_r16,
+    Texture::F_rg16,
+    Texture::F_rgb16,
+    Texture::F_srgb,
+    Texture::F_srgb_alpha,
+    Texture::F_sluminance,
+    Texture::F_sluminance_alpha,
+    Texture::F_r32i,
+    Texture::F_r32,
+    Texture::F_rg32,
+    Texture::F_rgb32,
+    Texture::F_r8i,
+    Texture::F_rg8i,
+    Texture::F_rgb8i,
+    Texture::F_rgba8i,
+    Texture::F_r11_g11_b10,
+    Texture::F_rgb9_e5,
+    Texture::F_rgb10_a2,
+    Texture::F_rg,
+    Texture::F_r16i,
+};
+
+/** Get the value in the file of the Panda3D enum. Returns false if the value is not supported. */
+template <class T, size_t N>
+static bool to_file_value(const T (&table)[N], T value, uint32_t& file_value)
+{
+    for (size_t k = 0; k < N; ++k)
+    {
+        if (table[k] == value)
+        {
+            file_value = static_cast<uint32_t>(k);
+            return true;
+        }
+    }
+    return false;
+}
+
+/** Get the Panda3D enum of the value in the file. Returns false if the value is unknown. */
+template <class T, size_t N>
+static bool from_file_value(const T (&table)[N], uint32_t file_value, T& value)
+{
+    if (file_value >= N)
+        return false;
+    value = table[file_value];
+    return true;
+}
+
+static void write_le(unsigned char* dest, uint64_t value, size_t size)
+{
+    for (size_t k = 0; k < size; ++k)
+        dest[k] = static_cast<unsigned char>(value >> (8 * k));
+}
+
+static uint64_t read_le(const unsigned char* src, size_t size)
+{
+    uint64_t value = 0;
+    for (size_t k = 0; k < size; ++k)
+        value |= static_cast<uint64_t>(src[k]) << (8 * k);
+    return value;
+}
+
+static void serialize_header(const RawTextureFile::Header& header, unsigned char* dest)
+{
+    const uint32_t fields[] = {
+        header.magic, header.version, header.texture_type, header.component_type, header.format,
+        header.x_size, header.y_size, header.z_size, header.num_mipmap_levels, header.reserved };
+    for (size_t k = 0; k < 10; ++k)
+        write_le(dest + k * 4, fields[k], 4);
+    write_le(dest + HEADER_CHECKED_SIZE, header.checksum, 8);
+}
+
+static RawTextureFile::Header deserialize_header(const unsigned char* src)
+{
+    RawTextureFile::Header header;
+    uint32_t* fields[] = {
+        &header.magic, &header.version, &header.texture_type, &header.component_type, &header.format,
+        &header.x_size, &header.y_size, &header.z_size, &header.num_mipmap_levels, &header.reserved };
+    for (size_t k = 0; k < 10; ++k)
+        *fields[k] = static_cast<uint32_t>(read_le(src + k * 4, 4));
+    header.checksum = read_le(src + HEADER_CHECKED_SIZE, 8);
+    return header;
+}
+
+/** Get a path on the physical file system for @p filename, or an empty path. */
+static Filename get_physical_filename(const Filename& filename)
+{
+    VirtualFileSystem* vfs = VirtualFileSystem::get_global_ptr();
+    PT(VirtualFile) vfile = vfs->get_file(filename, true);
+    if (!vfile || !vfile->is_of_type(VirtualFileSimple::get_class_type()))
+        return Filename();
+
+    auto simple = DCAST(VirtualFileSimple, vfile);
+    if (!simple->get_mount()->is_of_type(VirtualFileMountSystem::get_class_type()))
+        return Filename();
+
+    return Filename(DCAST(VirtualFileMountSystem, simple->get_mount())->get_physical_filename(), simple->get_local_filename());
+}
+
+static PT(Texture) parse_raw_texture(const Filename& filename, const unsigned char* data, size_t size)
+{
+    using Header = RawTextureFile::Header;
+    using MipmapEntry = RawTextureFile::MipmapEntry;
+
+    if (size < HEADER_SIZE)
+    {
+        RPObject::global_error(RAW_TEXTURE_CONTEXT, fmt::format("'{}' is too small.", filename.to_os_specific()));
+        return nullptr;
+    }
+    const Header header = deserialize_header(data);
+
+    if (header.magic != RawTextureFile::MAGIC)
+    {
+        RPObject::global_error(RAW_TEXTURE_CONTEXT, fmt::format("'{}' is not a raw texture file.", filename.to_os_specific()));
+        return nullptr;
+    }
+
+    if (header.version != RawTextureFile::VERSION)
+    {
+        RPObject::global_error(RAW_TEXTURE_CONTEXT, fmt::format("'{}' has unsupported version {} (expected {}).",
+            filename.to_os_specific(), header.version, RawTextureFile::VERSION));
+        return nullptr;
+    }
+
+    if (header.num_mipmap_levels == 0 || header.num_mipmap_levels > (size - HEADER_SIZE) / MIPMAP_ENTRY_SIZE)
+    {
+        RPObject::global_error(RAW_TEXTURE_CONTEXT, fmt::format("'{}' has invalid mipmap table.", filename.to_os_specific()));
+        return nullptr;
+    }
+    const size_t payload_offset = HEADER_SIZE + header.num_mipmap_levels * MIPMAP_ENTRY_SIZE;
+
+    // The checksum covers the header without itself, the mipmap table and the payload.
+    uint64_t checksum = RawTextureFile::compute_checksum(data, HEADER_CHECKED_SIZE);
+    checksum = RawTextureFile::compute_checksum(data + HEADER_SIZE, payload_offset - HEADER_SIZE, checksum);
+
+    std::vector<MipmapEntry> entries(header.num_mipmap_levels);
+    for (size_t level = 0, level_end = entries.size(); level < level_end; ++level)
+    {
+        const unsigned char* src = data + HEADER_SIZE + level * MIPMAP_ENTRY_SIZE;
+        auto& entry = entries[level];
+        entry.offset = read_le(src, 8);
+        entry.size = read_le(src + 8, 8);
+
+        if (entry.offset < payload_offset || entry.size > size || entry.offset > size - entry.size)
+        {
+            RPObject::global_error(RAW_TEXTURE_CONTEXT, fmt::format("'{}' is truncated.", filename.to_os_specific()));
+            return nullptr;
+        }
+        checksum = RawTextureFile::compute_checksum(data + entry.offset, entry.size, checksum);
+    }
+
+    if (checksum != header.checksum)
+    {
+        RPObject::global_error(RAW_TEXTURE_CONTEXT, fmt::format("'{}' has invalid checksum.", filename.to_os_specific()));
+        return nullptr;
+    }
+
+    if (header.x_size == 0 || header.y_size == 0 || header.z_size == 0)
+    {
+        RPObject::global_error(RAW_TEXTURE_CONTEXT, fmt::format("'{}' has invalid size.", filename.to_os_specific()));
+        return nullptr;
+    }
+
+    Texture::TextureType texture_type;
+    Texture::ComponentType component_type;
+    Texture::Format format;
+    if (!from_file_value(FILE_TEXTURE_TYPES, header.texture_type, texture_type) ||
+        !from_file_value(FILE_COMPONENT_TYPES, header.component_type, component_type) ||
+        !from_file_value(FILE_FORMATS, header.format, format))
+    {
+        RPObject::global_error(RAW_TEXTURE_CONTEXT, fmt::format("'{}' has unknown texture type ({}), component type ({}) or format ({}).",
+            filename.to_os_specific(), header.texture_type, header.component_type, header.format));
+        return nullptr;
+    }
+
+    // Texture::setup_texture() asserts the dimensions of the texture type.
+    bool valid_size;
+    switch (texture_type)
+    {
+    case Texture::TT_1d_texture:
+        valid_size = header.y_size == 1 && header.z_size == 1;
+        break;
+    case Texture::TT_2d_texture:
+    case Texture::TT_1d_texture_array:
+        valid_size = header.z_size == 1;
+        break;
+    case Texture::TT_cube_map:
+        valid_size = header.x_size == header.y_size && header.z_size == 6;
+        break;
+    case Texture::TT_cube_map_array:
+        valid_size = header.x_size == header.y_size && header.z_size % 6 == 0;
+        break;
+    default:
+        valid_size = true;
+        break;
+    }
+    if (!valid_size)
+    {
+        RPObject::global_error(RAW_TEXTURE_CONTEXT, fmt::format("'{}' has invalid size {}x{}x{} for its texture type.",
+            filename.to_os_specific(), header.x_size, header.y_size, header.z_size));
+        return nullptr;
+    }
+
+    PT(Texture) texture = new Texture(filename.get_basename_wo_extension());
+    texture->setup_texture(texture_type, header.x_size, header.y_size, header.z_size, component_type, format);
+    texture->set_fullpath(filename);
+
+    if (int(entries.size()) > texture->get_expected_num_mipmap_levels())
+    {
+        RPObject::global_error(RAW_TEXTURE_CONTEXT, fmt::format("'{}' has {} mipmap levels, but at most {} are expected.",
+            filename.to_os_specific(), entries.size(), texture->get_expected_num_mipmap_levels()));
+        return nullptr;
+    }
+
+    for (size_t level = 0, level_end = entries.size(); level < level_end; ++level)
+    {
+        const size_t expected_size = texture->get_expected_ram_mipmap_image_size(int(level));
+        if (entries[level].size != expected_size)
+        {
+            RPObject::global_error(RAW_TEXTURE_CONTEXT, fmt::format("'{}' has {} bytes in mipmap level {}, but {} bytes are expected.",
+                filename.to_os_specific(), entries[level].size, level, expected_size));
+            return nullptr;
+        }
+    }
+
+    for (size_t level = 0, level_end = entries.size(); level < level_end; ++level)
+    {
+        PTA_uchar image = PTA_uchar::empty_array(entries[level].size);
+        std::memcpy(image.p(), data + entries[level].offset, entries[level].size);
+        if (level == 0)
+            texture->set_ram_image(image);
+        else
+            texture->set_ram_mipmap_image(int(level), image);
+    }
+
+    return texture;
+}
+
+PT(Texture) RawTextureFile::read(const Filename& filename)
+{
+    const Filename physical_filename = get_physical_filename(filename);
+    if (!physical_filename.empty())
+    {
+        try
+        {
+            boost::interprocess::file_mapping mapping(physical_filename.to_os_specific().c_str(), boost::interprocess::read_only);
+            boost::interprocess::mapped_region region(mapping, boost::interprocess::read_only);
+            region.advise(boost::interprocess::mapped_region::advice_sequential);
+            return parse_raw_texture(filename, static_cast<const unsigned char*>(region.get_address()), region.get_size());
+        }
+        catch (const boost::interprocess::interprocess_exception& err)
+        {
+            RPObject::global_warn(RAW_TEXTURE_CONTEXT, fmt::format("Failed to map '{}' ({}), so it will be read from VFS.",
+                physical_filename.to_os_specific(), err.what()));
+        }
+    }
+
+    vector_uchar data;
+    if (!VirtualFileSystem::get_global_ptr()->read_file(filename, data, true))
+    {
+        RPObject::global_error(RAW_TEXTURE_CONTEXT, fmt::format("Failed to read '{}'.", filename.to_os_specific()));
+        return nullptr;
+    }
+
+    return parse_raw_texture(filename, data.data(), data.size());
+}
+
+bool RawTextureFile::write(const Filename& filename, Texture* texture)
+{
+    const int num_levels = texture->get_num_ram_mipmap_images();
+    if (num_levels == 0 || texture->get_ram_image_compression() != Texture::CM_off)
+    {
+        RPObject::global_error(RAW_TEXTURE_CONTEXT, fmt::format("Texture '{}' does not have uncompressed RAM image.", texture->get_name()));
+        return false;
+    }
+
+    Header header;
+    header.magic = MAGIC;
+    header.version = VERSION;
+    if (!to_file_value(FILE_TEXTURE_TYPES, texture->get_texture_type(), header.texture_type) ||
+        !to_file_value(FILE_COMPONENT_TYPES, texture->get_component_type(), header.component_type) ||
+        !to_file_value(FILE_FORMATS, texture->get_format(), header.format))
+    {
+        RPObject::global_error(RAW_TEXTURE_CONTEXT, fmt::format("Texture '{}' has unsupported texture type, component type or format.",
+            texture->get_name()));
+        return false;
+    }
+    header.x_size = static_cast<uint32_t>(texture->get_x_size());
+    header.y_size = static_cast<uint32_t>(texture->get_y_size());
+    header.z_size = static_cast<uint32_t>(texture->get_z_size());
+    header.num_mipmap_levels = static_cast<uint32_t>(num_levels);
+    header.reserved = 0;
+
+    std::vector<CPTA_uchar> images;
+    std::vector<unsigned char> table(num_levels * MIPMAP_ENTRY_SIZE);
+    uint64_t offset = HEADER_SIZE + table.size();
+    for (int level = 0; level < num_levels; ++level)
+    {
+        images.push_back(texture->get_ram_mipmap_image(level));
+        write_le(table.data() + level * MIPMAP_ENTRY_SIZE, offset, 8);
+        write_le(table.data() + level * MIPMAP_ENTRY_SIZE + 8, images.back().size(), 8);
+        offset += images.back().size();
+    }
+
+    unsigned char header_data[HEADER_SIZE];
+    header.checksum = 0;
+    serialize_header(header, header_data);
+
+    header.checksum = compute_checksum(header_data, HEADER_CHECKED_SIZE);
+    header.checksum = compute_checksum(table.data(), table.size(), header.checksum);
+    for (const auto& image: images)
+        header.checksum = compute_checksum(image.p(), image.size(), header.checksum);
+    serialize_header(header, header_data);
+
+    Filename binary_filename = filename;
+    binary_filename.set_binary();
+    std::ofstream file;
+    if (!binary_filename.open_write(file, true))
+    {
+        RPObject::global_error(RAW_TEXTURE_CONTEXT, fmt::format("Failed to open '{}'.", filename.to_os_specific()));
+        return false;
+    }
+
+    file.write(reinterpret_cast<const char*>(header_data), HEADER_SIZE);
+    file.write(reinterpret_cast<const char*>(table.data()), table.size());
+    for (const auto& image: images)
+        file.write(reinterpret_cast<const char*>(image.p()), image.size());
+
+    return file.good();
+}
+
+uint64_t RawTextureFile::compute_checksum(const unsigned char* data, size_t size, uint64_t hash)
+{
+    for (size_t k = 0; k < size; ++k)
+    {
+        hash ^= data[k];
+        hash *= 0x100000001b3ull;
+    }
+    return hash;
+}
+
+}
@@ -22,7 +22,8 @@
 
 #include "render_pipeline/rpcore/util/shader_input_blocks.hpp"
 
-#include <regex>
+#include <algorithm>
+#include <cstring>
 
 #include <fmt/format.h>
 
@@ -43,8 +44,55 @@ int GroupedInputBlock::UBO_BINDING_INDEX = 0;
 
 const std::vector<std::string> GroupedInputBlock::PTA_MAPPINGS = { "int", "float", "vec2", "ivec2", "vec3", "vec4", "mat3", "mat4", };
 
+namespace {
+
+/** Returns the std140 base size and alignment of a type, in bytes. */
+std::pair<size_t, size_t> get_std140_size_alignment(GroupedInputBlock::PTA_ID type)
+{
+    switch (type)
+    {
+    case GroupedInputBlock::PTA_ID::PTA_int:
+    case GroupedInputBlock::PTA_ID::PTA_float:
+        return { 4, 4 };
+    case GroupedInputBlock::PTA_ID::PTA_LVecBase2f:
+    case GroupedInputBlock::PTA_ID::PTA_LVecBase2i:
+        return { 8, 8 };
+    case GroupedInputBlock::PTA_ID::PTA_LVecBase3f:
+        return { 12, 16 };
+    case GroupedInputBlock::PTA_ID::PTA_LVecBase4f:
+        return { 16, 16 };
+    case GroupedInputBlock::PTA_ID::PTA_LMatrix3f:
+        // 3 columns of vec3 with the alignment of vec4
+        return { 48, 16 };
+    case GroupedInputBlock::PTA_ID::PTA_LMatrix4f:
+        return { 64, 16 };
+    default:
+        throw std::out_of_range("Invalid type");
+    }
+}
+
+size_t align_to(size_t offset, size_t alignment)
+{
+    return (offset + alignment - 1) / alignment * alignment;
+}
+
+/** Copies the bytes if they differ from the destination. */
+void copy_if_changed(unsigned char* dest, const void* src, size_t size, bool& changed)
+{
+    if (std::memcmp(dest, src, size) != 0)
+    {
+        std::memcpy(dest, src, size);
+        changed = true;
+    }
+}
+
+}
+
 GroupedInputBlock::GroupedInputBlock(const std::string& name): RPObject("GroupedInputBlock"), name_(name)
 {
+    packed_data_ = PTA_LVecBase4f::empty_array(0);
+    packed_int_data_ = PTA_LVecBase4i::empty_array(0);
+
     use_ubo_ = bool(TypeRegistry::ptr()->find_type("GLUniformBufferContext"));
 
     // Acquire a unique index for each UBO to store its binding
@@ -68,23 +116,25 @@ void GroupedInputBlock::register_pta(const std::string& name, const std::string&
     int array_size = 1;
     std::string uniform_name = name;
 
-    static const std::regex array_size_regex("\\[([0-9]+)\\]");
-    std::smatch match;
-    std::regex_search(name, match, array_size_regex);
-    if (match.size() > 2)
-    {
-        warn(std::string("Invalid uniform array syntax: ") + name);
-        return;
-    }
-    else if (match.size() == 2)
+    // parse "name[size]" syntax
+    const size_t bracket_begin = name.find('[');
+    if (bracket_begin != std::string::npos)
     {
-        array_size = std::stoi(match[1].str());
+        const size_t bracket_end = name.find(']', bracket_begin);
+        if (bracket_end == std::string::npos || bracket_end + 1 != name.size() || bracket_end == bracket_begin + 1 ||
+            name.find_first_not_of("0123456789", bracket_begin + 1) != bracket_end)
+        {
+            warn(std::string("Invalid uniform array syntax: ") + name);
+            return;
+        }
+
+        array_size = std::stoi(name.substr(bracket_begin + 1, bracket_end - bracket_begin - 1));
         if (array_size <= 0)
         {
             warn(std::string("Invalid uniform array size: ") + name);
             return;
         }
-        uniform_name = match.prefix().str();
+        uniform_name = name.substr(0, bracket_begin);
     }
 
     try
@@ -107,7 +157,13 @@ void GroupedInputBlock::register_pta(const std::string& name, const std::string&
     catch (const std::out_of_range&)
     {
         nout << "Invalid Panda3D type for shader input: [" << input_type << "]" << std::endl;
+        return;
     }
+
+    if (std::find(input_names_.begin(), input_names_.end(), uniform_name) == input_names_.end())
+        input_names_.push_back(uniform_name);
+
+    update_layout();
 }
 
 const std::string& GroupedInputBlock::pta_to_glsl_type(PTA_ID which) const
@@ -139,12 +195,16 @@ GroupedInputBlock::PTA_ID GroupedInputBlock::glsl_type_to_pta(const std::string&
 
 void GroupedInputBlock::bind_to(RenderStage* target) const
 {
-    std::string name_prefix = name_;
-    if (use_ubo_)
-        name_prefix += "_UBO.";
-    else
-        name_prefix += ".";
+    if (!use_ubo_)
+    {
+        if (layout_size_ > 0)
+            target->set_shader_input(ShaderInput(name_ + "_UBO_DATA", packed_data_));
+        if (has_int_members_)
+            target->set_shader_input(ShaderInput(name_ + "_UBO_IDATA", packed_int_data_));
+        return;
+    }
 
+    const std::string name_prefix = name_ + "_UBO.";
     for (const auto& pta_name_handle: ptas_)
     {
         const std::string& input_name = name_prefix + pta_name_handle.first;
@@ -155,121 +215,268 @@ void GroupedInputBlock::bind_to(RenderStage* target) const
     }
 }
 
-std::string GroupedInputBlock::generate_shader_code() const
+bool GroupedInputBlock::flush()
 {
-    std::string content("#pragma once\n\n");
-    content += "// Autogenerated by the render pipeline\n";
-    content += "// Do not edit! Your changes will be lost.\n\n";
-
-    std::unordered_map<std::string, std::vector<std::string>> structs;
-    std::vector<std::string> inputs;
+    bool changed = false;
+    unsigned char* data = reinterpret_cast<unsigned char*>(packed_data_.p());
+    unsigned char* int_data = reinterpret_cast<unsigned char*>(packed_int_data_.p());
 
-    for (const auto& key_val: ptas_)
+    for (const auto& member: layout_)
     {
-        const std::string& input_name = key_val.first;
-        const auto& handle = key_val.second;
-        int array_size = 1;
-
-        switch (static_cast<PTA_ID>(handle.which()))
+        const auto& handle = ptas_.at(member.name);
+        for (size_t k = 0; k < member.array_size; ++k)
         {
-        case PTA_ID::PTA_int:
-            array_size = boost::get<const PTA_int&>(handle).size();
-            break;
-        case PTA_ID::PTA_float:
-            array_size = boost::get<const PTA_float&>(handle).size();
-            break;
-        case PTA_ID::PTA_LVecBase2f:
-            array_size = boost::get<const PTA_LVecBase2f&>(handle).size();
-            break;
-        case PTA_ID::PTA_LVecBase2i:
-            array_size = boost::get<const PTA_LVecBase2i&>(handle).size();
-            break;
-        case PTA_ID::PTA_LVecBase3f:
-            array_size = boost::get<const PTA_LVecBase3f&>(handle).size();
-            break;
-        case PTA_ID::PTA_LVecBase4f:
-            array_size = boost::get<const PTA_LVecBase4f&>(handle).size();
-            break;
-        case PTA_ID::PTA_LMatrix3f:
-            array_size = boost::get<const PTA_LMatrix3f&>(handle).size();
-            break;
-        case PTA_ID::PTA_LMatrix4f:
-            array_size = boost::get<const PTA_LMatrix4f&>(handle).size();
-            break;
-        default:
-            throw std::out_of_range("Invalid type");
+            const size_t offset = member.offset + k * member.array_stride;
+            unsigned char* dest = data + offset;
+            switch (member.type)
+            {
+            // Integers are stored in the separate integer array, because the bits
+            // of small integers are denormal floats which GPUs may flush to zero.
+            case PTA_ID::PTA_int:
+                copy_if_changed(int_data + offset, &boost::get<const PTA_int&>(handle)[k], 4, changed);
+                break;
+            case PTA_ID::PTA_float:
+                copy_if_changed(dest, &boost::get<const PTA_float&>(handle)[k], 4, changed);
+                break;
+            case PTA_ID::PTA_LVecBase2f:
+                copy_if_changed(dest, boost::get<const PTA_LVecBase2f&>(handle)[k].get_data(), 8, changed);
+                break;
+            case PTA_ID::PTA_LVecBase2i:
+                copy_if_changed(int_data + offset, boost::get<const PTA_LVecBase2i&>(handle)[k].get_data(), 8, changed);
+                break;
+            case PTA_ID::PTA_LVecBase3f:
+                copy_if_changed(dest, boost::get<const PTA_LVecBase3f&>(handle)[k].get_data(), 12, changed);
+                break;
+            case PTA_ID::PTA_LVecBase4f:
+                copy_if_changed(dest, boost::get<const PTA_LVecBase4f&>(handle)[k].get_data(), 16, changed);
+                break;
+            case PTA_ID::PTA_LMatrix3f:
+            {
+                // The rows of Panda3D matrix are the columns in GLSL, and each column is aligned as vec4.
+                const float* rows = boost::get<const PTA_LMatrix3f&>(handle)[k].get_data();
+                for (int row = 0; row < 3; ++row)
+                    copy_if_changed(dest + row * 16, rows + row * 3, 12, changed);
+                break;
+            }
+            case PTA_ID::PTA_LMatrix4f:
+                copy_if_changed(dest, boost::get<const PTA_LMatrix4f&>(handle)[k].get_data(), 64, changed);
+                break;
+            default:
+                break;
+            }
         }
+    }
 
-        const std::regex dot_re("[.]");
-        std::vector<std::string> parts(std::sregex_token_iterator(input_name.begin(), input_name.end(), dot_re, -1), std::sregex_token_iterator());
+    return changed;
+}
 
-        // Single input, simply add it to the input list
-        if (parts.size() == 1)
+void GroupedInputBlock::update_layout()
+{
+    // Inputs in a struct (like scattering.sun_color) are placed together at the
+    // position of the first input of the struct.
+    std::vector<std::vector<std::string>> groups;
+    std::unordered_map<std::string, size_t> struct_groups;
+    for (const auto& input_name: input_names_)
+    {
+        const size_t dot_pos = input_name.find('.');
+        if (dot_pos == std::string::npos)
         {
-            if (array_size == 1)
-                inputs.push_back(pta_to_glsl_type(static_cast<PTA_ID>(handle.which())) + " " + input_name + ";");
-            else
-                inputs.push_back(pta_to_glsl_type(static_cast<PTA_ID>(handle.which())) + " " + input_name + "[" + std::to_string(array_size) + "];");
+            groups.push_back({ input_name });
+            continue;
         }
-        // Nested input, like scattering.sun_color
-        else if (parts.size() == 2)
+
+        // Nested input, like scattering.some_setting.sun_color, not supported yet
+        if (input_name.find('.', dot_pos + 1) != std::string::npos)
+            continue;
+
+        const auto result = struct_groups.insert({ input_name.substr(0, dot_pos), groups.size() });
+        if (result.second)
+            groups.push_back({});
+        groups[result.first->second].push_back(input_name);
+    }
+
+    layout_.clear();
+    size_t offset = 0;
+    for (const auto& group: groups)
+    {
+        const bool is_struct = group.front().find('.') != std::string::npos;
+
+        // A struct has the alignment of vec4, and its size is rounded up to it.
+        if (is_struct)
+            offset = align_to(offset, 16);
+
+        for (const auto& input_name: group)
         {
-            const std::string& struct_name = parts[0];
-            const std::string& actual_input_name = parts[1];
+            const auto& handle = ptas_.at(input_name);
+
+            LayoutMember member;
+            member.name = input_name;
+            member.type = static_cast<PTA_ID>(handle.which());
+            member.array_size = boost::apply_visitor([](const auto& pta) { return pta.size(); }, handle);
+
+            const auto size_alignment = get_std140_size_alignment(member.type);
+            size_t alignment = size_alignment.second;
+            member.array_stride = size_alignment.first;
 
-            if (structs.find(struct_name) == structs.end())
+            // The elements of an array have the alignment of vec4.
+            if (member.array_size > 1)
             {
-                // Construct a new struct and add it to the list of inputs
-                inputs.push_back(struct_name + "_UBOSTRUCT " + struct_name + ";");
+                alignment = 16;
+                member.array_stride = align_to(member.array_stride, 16);
             }
-            //else    Struct is already defined, add member definition
 
-            if (array_size == 1)
-                structs[struct_name].push_back(pta_to_glsl_type(static_cast<PTA_ID>(handle.which())) + " " + actual_input_name + ";");
-            else
-                structs[struct_name].push_back(pta_to_glsl_type(static_cast<PTA_ID>(handle.which())) + " " + actual_input_name + "[" + std::to_string(array_size) + "];");
+            member.offset = align_to(offset, alignment);
+            offset = member.offset + member.array_stride * member.array_size;
+
+            layout_.push_back(member);
         }
-        // Nested input, like scattering.some_setting.sun_color, not supported yet
-        else
+
+        if (is_struct)
+            offset = align_to(offset, 16);
+    }
+
+    layout_size_ = align_to(offset, 16);
+    packed_data_.resize(layout_size_ / 16);
+
+    has_int_members_ = std::any_of(layout_.begin(), layout_.end(), [](const LayoutMember& member) {
+        return member.type == PTA_ID::PTA_int || member.type == PTA_ID::PTA_LVecBase2i;
+    });
+    packed_int_data_.resize(has_int_members_ ? layout_size_ / 16 : 0);
+}
+
+std::string GroupedInputBlock::generate_shader_code() const
+{
+    std::string content("#pragma once\n\n");
+    content += "// Autogenerated by the render pipeline\n";
+    content += "// Do not edit! Your changes will be lost.\n\n";
+
+    const auto make_declaration = [this](const LayoutMember& member, const std::string& name) {
+        std::string declaration = pta_to_glsl_type(member.type) + " " + name;
+        if (member.array_size > 1)
+            declaration += "[" + std::to_string(member.array_size) + "]";
+        return declaration + ";";
+    };
+
+    // Declarations of the inputs and the structs (in the order of the layout)
+    std::vector<std::string> inputs;
+    std::string structs;
+    for (size_t k = 0, k_end = layout_.size(); k < k_end;)
+    {
+        const LayoutMember& member = layout_[k];
+        const size_t dot_pos = member.name.find('.');
+
+        // Single input, simply add it to the input list
+        if (dot_pos == std::string::npos)
         {
-            warn(std::string("Structure definition too nested, not supported (yet): ") + input_name);
+            inputs.push_back(fmt::format("{:<48}// offset {}", make_declaration(member, member.name), member.offset));
+            ++k;
+            continue;
         }
+
+        // Nested input, like scattering.sun_color
+        const std::string struct_name = member.name.substr(0, dot_pos);
+        const std::string struct_prefix = struct_name + ".";
+        inputs.push_back(fmt::format("{:<48}// offset {}", struct_name + "_UBOSTRUCT " + struct_name + ";", member.offset));
+        structs += std::string("struct ") + struct_name + "_UBOSTRUCT {\n";
+        for (; k < k_end && layout_[k].name.compare(0, struct_prefix.size(), struct_prefix) == 0; ++k)
+            structs += std::string(4, ' ') + make_declaration(layout_[k], layout_[k].name.substr(struct_prefix.size())) + "\n";
+        structs += "};\n\n";
     }
 
-    // Add structures
-    for (const auto& key_val: structs)
+    for (const auto& input_name: input_names_)
     {
-        content += std::string("struct ") + key_val.first + "_UBOSTRUCT {\n";
-        for (const auto& member: key_val.second)
-            content += std::string(4, ' ') + member + "\n";
-        content += "};\n\n";
+        if (std::count(input_name.begin(), input_name.end(), '.') > 1)
+            warn(std::string("Structure definition too nested, not supported (yet): ") + input_name);
     }
 
+    content += structs;
+
     // Add actual inputs
     if (inputs.size() < 1)
     {
         debug(std::string("No UBO inputs present for ") + name_);
     }
+    else if (use_ubo_)
+    {
+        content += fmt::format("// std140 layout, {} bytes\n", layout_size_);
+        content += fmt::format(
+            "layout(std140, binding={}) uniform {}_UBO {{\n",
+            bind_id_,
+            name_
+        );
+        for (const auto& ipt: inputs)
+            content += std::string(4, ' ') + ipt + "\n";
+        content += std::string("} ") + name_ + ";\n";
+    }
     else
     {
-        if (use_ubo_)
-        {
-            content += fmt::format(
-                "layout(shared, binding={}) uniform {}_UBO {{\n",
-                bind_id_,
-                name_
-            );
-            for (const auto& ipt: inputs)
-                content += std::string(4, ' ') + ipt + "\n";
-            content += std::string("} ") + name_ + ";\n";
-        }
-        else
+        // The inputs are packed with std140 layout into an array of vec4,
+        // and unpacked to a struct which has the name of the block.
+        // Integers are at the same offsets in a separate array of ivec4.
+        content += fmt::format("// std140 layout, {} bytes\n", layout_size_);
+        content += std::string("struct ") + name_ + "_UBOSTRUCT {\n";
+        for (const auto& ipt: inputs)
+            content += std::string(4, ' ') + ipt + "\n";
+        content += "};\n\n";
+
+        content += fmt::format("uniform vec4 {}_UBO_DATA[{}];\n", name_, layout_size_ / 16);
+        if (has_int_members_)
+            content += fmt::format("uniform ivec4 {}_UBO_IDATA[{}];\n", name_, layout_size_ / 16);
+        content += "\n";
+
+        content += fmt::format("{0}_UBOSTRUCT {0}_unpack() {{\n", name_);
+        content += std::string(4, ' ') + name_ + "_UBOSTRUCT block;\n";
+        for (const auto& member: layout_)
         {
-            content += "uniform struct {\n";
-            for (const auto& ipt: inputs)
-                content += std::string(4, ' ') + ipt + "\n";
-            content += std::string("} ") + name_ + ";\n";
+            for (size_t k = 0; k < member.array_size; ++k)
+            {
+                const size_t offset = member.offset + k * member.array_stride;
+                const size_t slot = offset / 16;
+                const std::string swizzle = std::string("xyzw").substr((offset % 16) / 4);
+                const auto data = [&](size_t index) { return fmt::format("{}_UBO_DATA[{}]", name_, slot + index); };
+                const auto int_data = fmt::format("{}_UBO_IDATA[{}]", name_, slot);
+
+                std::string value;
+                switch (member.type)
+                {
+                case PTA_ID::PTA_int:
+                    value = int_data + "." + swizzle.substr(0, 1);
+                    break;
+                case PTA_ID::PTA_float:
+                    value = data(0) + "." + swizzle.substr(0, 1);
+                    break;
+                case PTA_ID::PTA_LVecBase2f:
+                    value = data(0) + "." + swizzle.substr(0, 2);
+                    break;
+                case PTA_ID::PTA_LVecBase2i:
+                    value = int_data + "." + swizzle.substr(0, 2);
+                    break;
+                case PTA_ID::PTA_LVecBase3f:
+                    value = data(0) + ".xyz";
+                    break;
+                case PTA_ID::PTA_LVecBase4f:
+                    value = data(0);
+                    break;
+                case PTA_ID::PTA_LMatrix3f:
+                    value = fmt::format("mat3({}.xyz, {}.xyz, {}.xyz)", data(0), data(1), data(2));
+                    break;
+                case PTA_ID::PTA_LMatrix4f:
+                    value = fmt::format("mat4({}, {}, {}, {})", data(0), data(1), data(2), data(3));
+                    break;
+                default:
+                    break;
+                }
+
+                std::string target = "block." + member.name;
+                if (member.array_size > 1)
+                    target += "[" + std::to_string(k) + "]";
+                content += std::string(4, ' ') + target + " = " + value + ";\n";
+            }
         }
+        content += std::string(4, ' ') + "return block;\n";
+        content += "}\n\n";
+
+        content += fmt::format("#define {0} {0}_unpack()\n", name_);
     }
 
     content += "\n";
@@ -87,7 +87,7 @@ std::string SmoothConnectedCurve::serialize() const
 
     for (const auto& point: _cv_points)
     {
-        result += fmt::format("[{{{:5.10f}}},{{{:5.10f}}}]", point[0], point[1]);
+        result += fmt::format("[{:5.10f},{:5.10f}]", point[0], point[1]);
         result += ",";
     }
 
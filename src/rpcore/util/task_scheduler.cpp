@@ -24,36 +24,135 @@
 
 #include <filename.h>
 
-#include <numeric>
 #include <algorithm>
 
 #include "rplibs/yaml.hpp"
 
 namespace rpcore {
 
+namespace {
+
+template <class Func>
+void for_each_bit(uint64_t bits, size_t word, const Func& func)
+{
+    for (int bit = 0; bits != 0; ++bit, bits >>= 1)
+    {
+        if (bits & 1u)
+            func(static_cast<TaskScheduler::TaskId>(word * 64 + bit));
+    }
+}
+
+}
+
 TaskScheduler::TaskScheduler(): RPObject("TaskScheduler")
 {
     frame_index_ = 0;
+    words_per_frame_ = 0;
+    num_frames_ = 0;
+    num_tasks_ = 0;
 
     load_config();
 }
 
+TaskScheduler::TaskId TaskScheduler::get_task_id(const std::string& task_name)
+{
+    const TaskId task_id = find_task_id(task_name);
+    if (task_id != INVALID_TASK_ID)
+        return task_id;
+
+    error(std::string("Task '") + task_name + "' is never scheduled and thus will never run!");
+
+    // Register the task, so that the handle is valid. It is never set in the frame masks.
+    const TaskId new_task_id = static_cast<TaskId>(task_ids_.size());
+    task_ids_.insert({ task_name, new_task_id });
+    return new_task_id;
+}
+
 bool TaskScheduler::is_scheduled(const std::string& task_name) const
 {
-    check_missing_schedule(task_name);
-    return std::find(tasks_[frame_index_].cbegin(), tasks_[frame_index_].cend(), task_name) != tasks_[frame_index_].cend();
+    const TaskId task_id = find_task_id(task_name);
+    if (task_id == INVALID_TASK_ID)
+    {
+        error(std::string("Task '") + task_name + "' is never scheduled and thus will never run!");
+        return false;
+    }
+    return is_scheduled(task_id);
 }
 
-void TaskScheduler::step()
+void TaskScheduler::step(double last_frame_time)
 {
-    frame_index_ = (frame_index_ + 1) % tasks_.size();
+    if (num_frames_ == 0)
+        return;
+
+    frame_index_ = (frame_index_ + 1) % num_frames_;
+
+    const bool over_budget = adaptive_ && last_frame_time > frame_budget_;
+    if (over_budget)
+        ++adaptive_stats_.over_budget_frames;
+
+    update_active_tasks(over_budget);
 }
 
 size_t TaskScheduler::get_num_tasks() const
 {
-    return std::accumulate(tasks_.begin(), tasks_.end(), size_t(0), [](const size_t& sum, const std::vector<std::string>& tasks) {
-        return sum + tasks.size();
-    });
+    return num_tasks_;
+}
+
+std::vector<std::string> TaskScheduler::get_frame_task_names(size_t frame_index) const
+{
+    std::vector<std::pair<TaskId, std::string>> tasks;
+    if (frame_index < num_frames_)
+    {
+        for (const auto& name_id: task_ids_)
+        {
+            const TaskId task_id = name_id.second;
+            if (static_cast<size_t>(task_id) / 64 < words_per_frame_ &&
+                (frame_masks_[frame_index * words_per_frame_ + task_id / 64] >> (task_id % 64)) & 1u)
+                tasks.push_back({ task_id, name_id.first });
+        }
+    }
+
+    // in the order of the configuration
+    std::sort(tasks.begin(), tasks.end());
+
+    std::vector<std::string> task_names;
+    for (auto& task: tasks)
+        task_names.push_back(std::move(task.second));
+    return task_names;
+}
+
+void TaskScheduler::set_adaptive(bool enabled)
+{
+    if (adaptive_ == enabled)
+        return;
+
+    adaptive_ = enabled;
+    debug(std::string("Adaptive mode is ") + (adaptive_ ? "enabled" : "disabled"));
+}
+
+void TaskScheduler::set_deferrable(TaskId task_id, bool deferrable)
+{
+    if (task_id < 0 || static_cast<size_t>(task_id) / 64 >= words_per_frame_)
+        return;
+
+    const uint64_t bit = uint64_t(1) << (task_id % 64);
+    if (deferrable)
+        deferrable_mask_[task_id / 64] |= bit;
+    else
+        deferrable_mask_[task_id / 64] &= ~bit;
+}
+
+void TaskScheduler::add_chain(const std::vector<TaskId>& chain)
+{
+    std::vector<TaskId> valid_chain;
+    for (const TaskId task_id: chain)
+    {
+        if (task_id >= 0 && static_cast<size_t>(task_id) / 64 < words_per_frame_)
+            valid_chain.push_back(task_id);
+    }
+
+    if (valid_chain.size() > 1)
+        chains_.push_back(std::move(valid_chain));
 }
 
 void TaskScheduler::load_config()
@@ -62,34 +161,143 @@ void TaskScheduler::load_config()
     if (!rplibs::load_yaml_file("/$$rpconfig/task-scheduler.yaml", config_node))
         return;
 
+    // Intern the task names, and collect the tasks of each frame.
+    std::vector<std::vector<TaskId>> frames;
     for (const auto& frame_node: config_node["frame_cycles"])
     {
         // add frame
-        tasks_.push_back({});
+        frames.push_back({});
 
         // XXX: omap of yaml-cpp is list.
         for (const auto& frame_name_tasks: frame_node)
         {
             for (const auto& task_name: frame_name_tasks.second)
-                tasks_.back().push_back(task_name.as<std::string>());
+            {
+                auto result = task_ids_.insert({ task_name.as<std::string>(), static_cast<TaskId>(task_ids_.size()) });
+                frames.back().push_back(result.first->second);
+            }
         }
     }
+
+    // Precompile the frame cycles into bitsets.
+    words_per_frame_ = (task_ids_.size() + 63) / 64;
+    num_frames_ = frames.size();
+    frame_masks_.assign(num_frames_ * words_per_frame_, 0);
+    num_tasks_ = 0;
+    for (size_t frame_index = 0; frame_index < num_frames_; ++frame_index)
+    {
+        for (const TaskId task_id: frames[frame_index])
+            frame_masks_[frame_index * words_per_frame_ + task_id / 64] |= uint64_t(1) << (task_id % 64);
+        num_tasks_ += frames[frame_index].size();
+    }
+
+    active_mask_.assign(words_per_frame_, 0);
+    deferred_mask_.assign(words_per_frame_, 0);
+    deferrable_mask_.assign(words_per_frame_, 0);
+    deferred_frames_.assign(task_ids_.size(), 0);
+
+    if (const auto& adaptive_node = config_node["adaptive"])
+    {
+        adaptive_ = adaptive_node["enabled"].as<bool>(false);
+        frame_budget_ = adaptive_node["frame_budget"].as<double>(frame_budget_);
+        max_deferral_ = adaptive_node["max_deferral"].as<int>(max_deferral_);
+
+        for (const auto& task_name_node: adaptive_node["deferrable"])
+        {
+            const std::string& task_name = task_name_node.as<std::string>();
+            const TaskId task_id = find_task_id(task_name);
+            if (task_id == INVALID_TASK_ID)
+                warn(std::string("Deferrable task '") + task_name + "' is never scheduled.");
+            else
+                set_deferrable(task_id, true);
+        }
+
+        for (const auto& chain_node: adaptive_node["chains"])
+        {
+            std::vector<TaskId> chain;
+            for (const auto& task_name_node: chain_node)
+            {
+                const std::string& task_name = task_name_node.as<std::string>();
+                const TaskId task_id = find_task_id(task_name);
+                if (task_id == INVALID_TASK_ID)
+                    warn(std::string("Chained task '") + task_name + "' is never scheduled.");
+                else
+                    chain.push_back(task_id);
+            }
+            add_chain(chain);
+        }
+    }
+
+    update_active_tasks(false);
+}
+
+TaskScheduler::TaskId TaskScheduler::find_task_id(const std::string& task_name) const
+{
+    auto found = task_ids_.find(task_name);
+    return found == task_ids_.end() ? INVALID_TASK_ID : found->second;
 }
 
-void TaskScheduler::check_missing_schedule(const std::string& task_name) const
+void TaskScheduler::update_active_tasks(bool over_budget)
 {
-    bool found = false;
-    for (const auto& tasks: tasks_)
+    num_active_tasks_ = 0;
+    num_deferred_tasks_ = 0;
+
+    for (size_t word = 0; word < words_per_frame_; ++word)
     {
-        if (std::find(tasks.cbegin(), tasks.cend(), task_name) != tasks.cend())
+        // Tasks of this frame and tasks which were deferred in previous frames.
+        const uint64_t due = frame_masks_[frame_index_ * words_per_frame_ + word] | deferred_mask_[word];
+
+        uint64_t deferred = 0;
+        if (over_budget)
         {
-            found = true;
-            break;
+            // Run tasks which reached the maximum deferral, even if over budget.
+            deferred = due & deferrable_mask_[word];
+            for_each_bit(deferred, word, [&](TaskId task_id) {
+                if (deferred_frames_[task_id] >= max_deferral_)
+                    deferred &= ~(uint64_t(1) << (task_id % 64));
+            });
         }
+
+        active_mask_[word] = due;
+        deferred_mask_[word] = deferred;
     }
 
-    if (!found)
-        error(std::string("Task '") + task_name + "' is never scheduled and thus will never run!");
+    // A task of a chain uses the results of the previous tasks, so it waits
+    // until the deferred previous tasks are run.
+    if (over_budget)
+    {
+        for (const auto& chain: chains_)
+        {
+            bool pending = false;
+            for (const TaskId task_id: chain)
+            {
+                const size_t word = task_id / 64;
+                const uint64_t bit = uint64_t(1) << (task_id % 64);
+                if (pending && (active_mask_[word] & bit))
+                    deferred_mask_[word] |= bit;
+                pending = pending || (deferred_mask_[word] & bit);
+            }
+        }
+    }
+
+    for (size_t word = 0; word < words_per_frame_; ++word)
+    {
+        active_mask_[word] &= ~deferred_mask_[word];
+
+        for_each_bit(active_mask_[word], word, [&](TaskId task_id) {
+            if (over_budget && deferred_frames_[task_id] >= max_deferral_)
+                ++adaptive_stats_.forced_tasks;
+            deferred_frames_[task_id] = 0;
+            ++num_active_tasks_;
+        });
+
+        for_each_bit(deferred_mask_[word], word, [&](TaskId task_id) {
+            const int frames = ++deferred_frames_[task_id];
+            adaptive_stats_.max_staleness = (std::max)(adaptive_stats_.max_staleness, frames);
+            ++adaptive_stats_.deferred_tasks;
+            ++num_deferred_tasks_;
+        });
+    }
 }
 
 }
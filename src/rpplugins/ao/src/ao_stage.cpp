@@ -43,14 +43,14 @@ void AOStage::create()
 {
     stereo_mode_ = pipeline_.is_stereo_mode();
 
-    target_ = create_target("Sample");
+    target_ = create_target("Sample", true);
     target_->set_size(-2);
     target_->add_color_attachment(LVecBase4i(8, 0, 0, 0));
     if (stereo_mode_)
         target_->set_layers(2);
     target_->prepare_buffer();
 
-    target_upscale_ = create_target("Upscale");
+    target_upscale_ = create_target("Upscale", true);
     target_upscale_->add_color_attachment(LVecBase4i(8, 0, 0, 0));
     if (stereo_mode_)
         target_upscale_->set_layers(2);
@@ -59,7 +59,7 @@ void AOStage::create()
     target_upscale_->set_shader_input(ShaderInput("SourceTex", target_->get_color_tex()));
     target_upscale_->set_shader_input(ShaderInput("upscaleWeights", LVecBase2f(0.001f, 0.001f)));
 
-    target_detail_ao_ = create_target("DetailAO");
+    target_detail_ao_ = create_target("DetailAO", true);
     target_detail_ao_->add_color_attachment(LVecBase4i(8, 0, 0, 0));
     if (stereo_mode_)
         target_detail_ao_->set_layers(2);
@@ -94,13 +94,13 @@ void AOStage::create()
 
     for (int i = 0; i < blur_passes; ++i)
     {
-        auto target_blur_v = create_target(std::string("BlurV-") + std::to_string(i));
+        auto target_blur_v = create_target(std::string("BlurV-") + std::to_string(i), true);
         target_blur_v->add_color_attachment(LVecBase4i(8, 0, 0, 0));
         if (stereo_mode_)
             target_blur_v->set_layers(2);
         target_blur_v->prepare_buffer();
 
-        auto target_blur_h = create_target(std::string("BlurH-") + std::to_string(i));
+        auto target_blur_h = create_target(std::string("BlurH-") + std::to_string(i), true);
         target_blur_h->add_color_attachment(LVecBase4i(8, 0, 0, 0));
         if (stereo_mode_)
             target_blur_h->set_layers(2);
@@ -47,6 +47,7 @@ Plugin::RequrieType& Plugin::get_required_plugins() const
 void Plugin::on_stage_setup()
 {
     auto stage = std::make_unique<AOStage>(pipeline_);
+    stage_ = stage.get();
 
     stage->set_quality(get_setting<rpcore::EnumType>("blur_quality"));
 
@@ -56,4 +57,10 @@ void Plugin::on_stage_setup()
     rpcore::AmbientStage::get_global_required_pipes().push_back("AmbientOcclusion");
 }
 
+bool Plugin::on_stage_rebuild(const std::unordered_set<std::string>& changed_settings)
+{
+    stage_->set_quality(get_setting<rpcore::EnumType>("blur_quality"));
+    return true;
+}
+
 }
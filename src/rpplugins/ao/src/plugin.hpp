@@ -39,9 +39,12 @@ public:
     RENDER_PIPELINE_PLUGIN_DOWNCAST();
 
     void on_stage_setup() final;
+    bool on_stage_rebuild(const std::unordered_set<std::string>& changed_settings) final;
 
 private:
     static RequrieType require_plugins;
+
+    AOStage* stage_;
 };
 
 }
@@ -45,7 +45,7 @@ void BloomStage::create()
 
     if (_remove_fireflies)
     {
-        _target_firefly = create_target("RemoveFireflies");
+        _target_firefly = create_target("RemoveFireflies", true);
         _target_firefly->add_color_attachment(16);
         if (stereo_mode_)
             _target_firefly->set_layers(2);
@@ -71,6 +71,7 @@ void BloomStage::create()
         _target_extract->set_shader_input(ShaderInput("ShadedScene", _target_firefly->get_color_tex(), 1000));
 
     // Downsample passes
+    _downsample_targets.clear();
     for (int i = 0; i < _num_mips; ++i)
     {
         int scale_multiplier = std::pow(2, 1 + i);
@@ -84,6 +85,7 @@ void BloomStage::create()
     }
 
     // Upsample passes
+    _upsample_targets.clear();
     for (int i = 0; i < _num_mips; ++i)
     {
         int scale_multiplier = std::pow(2, _num_mips - i - 1);
@@ -43,6 +43,17 @@ void Plugin::on_stage_setup()
     bloom_stage_ = bloom_stage.get();
     add_stage(std::move(bloom_stage));
 
+    apply_stage_settings();
+}
+
+bool Plugin::on_stage_rebuild(const std::unordered_set<std::string>& changed_settings)
+{
+    apply_stage_settings();
+    return true;
+}
+
+void Plugin::apply_stage_settings()
+{
     bloom_stage_->set_num_mips(get_setting<rpcore::IntType>("num_mipmaps"));
     bloom_stage_->set_remove_fireflies(get_setting<rpcore::BoolType>("remove_fireflies"));
 }
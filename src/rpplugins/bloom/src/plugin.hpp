@@ -38,8 +38,11 @@ public:
 
     void on_stage_setup() final;
     void on_pipeline_created() final;
+    bool on_stage_rebuild(const std::unordered_set<std::string>& changed_settings) final;
 
 private:
+    void apply_stage_settings();
+
     static RequrieType require_plugins;
 
     BloomStage* bloom_stage_;
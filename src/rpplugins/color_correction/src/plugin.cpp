@@ -75,7 +75,14 @@ void Plugin::on_stage_setup()
 void Plugin::load_lut()
 {
     std::string lut_path = get_resource(get_setting<rpcore::PathType>("color_lut"));
-    PT(Texture) lut = rpcore::RPLoader::load_sliced_3d_texture(lut_path, 64);
+    PT(Texture) lut;
+    if (Filename(lut_path).get_extension() == "rptex")
+        lut = rpcore::RPLoader::load_raw_texture(lut_path);
+    else
+        lut = rpcore::RPLoader::load_sliced_3d_texture(lut_path, 64);
+    if (!lut)
+        return;
+
     lut->set_wrap_u(SamplerState::WM_clamp);
     lut->set_wrap_v(SamplerState::WM_clamp);
     lut->set_wrap_w(SamplerState::WM_clamp);
@@ -38,37 +38,37 @@ DoFStage::ProduceType DoFStage::get_produced_pipes() const
 
 void DoFStage::create()
 {
-    target_prefilter_ = create_target("PrefilterDoF");
+    target_prefilter_ = create_target("PrefilterDoF", true);
     //target_prefilter_->set_size("50%");
     target_prefilter_->add_color_attachment(16, true);
     target_prefilter_->prepare_buffer();
 
     const int tile_size = 32;
-    tile_target_ = create_target("FetchVertDOF");
+    tile_target_ = create_target("FetchVertDOF", true);
     tile_target_->set_size(-1, -tile_size);
     tile_target_->add_color_attachment(LVecBase3i(16, 16, 0));
     tile_target_->prepare_buffer();
     tile_target_->set_shader_input(ShaderInput("PrecomputedCoC", target_prefilter_->get_color_tex()));
 
-    tile_target_horiz_ = create_target("FetchHorizDOF");
+    tile_target_horiz_ = create_target("FetchHorizDOF", true);
     tile_target_horiz_->set_size(-tile_size);
     tile_target_horiz_->add_color_attachment(LVecBase3i(16, 16, 0));
     tile_target_horiz_->prepare_buffer();
     tile_target_horiz_->set_shader_input(ShaderInput("SourceTex", tile_target_->get_color_tex()));
 
-    minmax_target_ = create_target("DoFNeighborMinMax");
+    minmax_target_ = create_target("DoFNeighborMinMax", true);
     minmax_target_->set_size(-tile_size);
     minmax_target_->add_color_attachment(LVecBase3i(16, 16, 0));
     minmax_target_->prepare_buffer();
     minmax_target_->set_shader_input(ShaderInput("TileMinMax", tile_target_horiz_->get_color_tex()));
 
-    presort_target_ = create_target("DoFPresort");
+    presort_target_ = create_target("DoFPresort", true);
     presort_target_->add_color_attachment(LVecBase3i(11, 11, 10));
     presort_target_->prepare_buffer();
     presort_target_->set_shader_input(ShaderInput("TileMinMax", minmax_target_->get_color_tex()));
     presort_target_->set_shader_input(ShaderInput("PrecomputedCoC", target_prefilter_->get_color_tex()));
 
-    target_ = create_target("ComputeDoF");
+    target_ = create_target("ComputeDoF", true);
     // target_->set_size("50%");
     target_->add_color_attachment(16, true);
     target_->prepare_buffer();
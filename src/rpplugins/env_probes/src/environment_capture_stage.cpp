@@ -61,6 +61,12 @@ void EnvironmentCaptureStage::create()
     setup_camera_rig();
     create_store_targets();
     create_filter_targets();
+
+    rpcore::TaskScheduler* task_scheduler = pipeline_.get_task_scheduler();
+    _task_capture_faces.clear();
+    for (size_t i = 0, i_end = regions.size(); i < i_end; ++i)
+        _task_capture_faces.push_back(task_scheduler->get_task_id(std::string("envprobes_capture_envmap_face") + std::to_string(i)));
+    _task_filter_and_store = task_scheduler->get_task_id("envprobes_filter_and_store_envmap");
 }
 
 void EnvironmentCaptureStage::setup_camera_rig()
@@ -157,13 +163,15 @@ void EnvironmentCaptureStage::update()
     for (const auto& id_target: get_targets())
         id_target.second->set_active(false);
 
+    const rpcore::TaskScheduler* task_scheduler = pipeline_.get_task_scheduler();
+
     // Check for updated faces
     for (size_t i = 0, i_end=regions.size(); i < i_end; ++i)
-        if (pipeline_.get_task_scheduler()->is_scheduled(std::string("envprobes_capture_envmap_face") + std::to_string(i)))
+        if (task_scheduler->is_scheduled(_task_capture_faces[i]))
             regions[i]->set_active(true);
 
     // Check for filtering
-    if (pipeline_.get_task_scheduler()->is_scheduled("envprobes_filter_and_store_envmap"))
+    if (task_scheduler->is_scheduled(_task_filter_and_store))
     {
         _target_store->set_active(true);
         _target_store_diff->set_active(true);
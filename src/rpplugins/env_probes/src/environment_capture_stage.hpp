@@ -25,6 +25,7 @@
 #include <nodePath.h>
 
 #include <render_pipeline/rpcore/render_stage.hpp>
+#include <render_pipeline/rpcore/util/task_scheduler.hpp>
 
 namespace rpcore {
 class Image;
@@ -92,6 +93,9 @@ private:
     rpcore::RenderTarget* _target_store_diff;
     rpcore::RenderTarget* _filter_diffuse_target;
     std::vector<rpcore::RenderTarget*> _filter_targets;
+
+    std::vector<rpcore::TaskScheduler::TaskId> _task_capture_faces;
+    rpcore::TaskScheduler::TaskId _task_filter_and_store;
 };
 
 inline void EnvironmentCaptureStage::set_resolution(int resolution)
@@ -39,10 +39,22 @@ Plugin::Plugin(rpcore::RenderPipeline& pipeline): rpcore::BasePlugin(pipeline, R
 void Plugin::on_stage_setup()
 {
     auto stage = std::make_unique<MotionBlurStage>(pipeline_);
-    stage->set_tile_size(get_setting<rpcore::IntType>("tile_size"));
-    stage->set_per_object_blur(get_setting<rpcore::BoolType>("enable_object_blur"));
+    stage_ = stage.get();
+    apply_stage_settings();
 
     add_stage(std::move(stage));
 }
 
+bool Plugin::on_stage_rebuild(const std::unordered_set<std::string>& changed_settings)
+{
+    apply_stage_settings();
+    return true;
+}
+
+void Plugin::apply_stage_settings()
+{
+    stage_->set_tile_size(get_setting<rpcore::IntType>("tile_size"));
+    stage_->set_per_object_blur(get_setting<rpcore::BoolType>("enable_object_blur"));
+}
+
 }
@@ -26,6 +26,8 @@
 
 namespace rpplugins {
 
+class MotionBlurStage;
+
 class Plugin : public rpcore::BasePlugin
 {
 public:
@@ -35,9 +37,14 @@ public:
     RENDER_PIPELINE_PLUGIN_DOWNCAST();
 
     void on_stage_setup() final;
+    bool on_stage_rebuild(const std::unordered_set<std::string>& changed_settings) final;
 
 private:
+    void apply_stage_settings();
+
     static RequrieType require_plugins;
+
+    MotionBlurStage* stage_;
 };
 
 }
@@ -95,6 +95,12 @@ void PSSMDistShadowStage::create()
 
     // Register shadow camera
     pipeline_.get_tag_mgr()->register_camera("shadow", _camera);
+
+    rpcore::TaskScheduler* task_scheduler = pipeline_.get_task_scheduler();
+    _task_distant_shadows = task_scheduler->get_task_id("pssm_distant_shadows");
+    _task_convert_to_esm = task_scheduler->get_task_id("pssm_convert_distant_to_esm");
+    _task_blur_vert = task_scheduler->get_task_id("pssm_blur_distant_vert");
+    _task_blur_horiz = task_scheduler->get_task_id("pssm_blur_distant_horiz");
 }
 
 void PSSMDistShadowStage::update()
@@ -106,8 +112,10 @@ void PSSMDistShadowStage::update()
 
     const auto& mvp = get_mvp();
 
+    const rpcore::TaskScheduler* task_scheduler = pipeline_.get_task_scheduler();
+
     // Query scheduled tasks
-    if (pipeline_.get_task_scheduler()->is_scheduled("pssm_distant_shadows"))
+    if (task_scheduler->is_scheduled(_task_distant_shadows))
     {
         _target->set_active(true);
 
@@ -120,13 +128,13 @@ void PSSMDistShadowStage::update()
         rpcore::snap_shadow_map(mvp, _cam_node, _resolution);
     }
 
-    if (pipeline_.get_task_scheduler()->is_scheduled("pssm_convert_distant_to_esm"))
+    if (task_scheduler->is_scheduled(_task_convert_to_esm))
         _target_convert->set_active(true);
 
-    if (pipeline_.get_task_scheduler()->is_scheduled("pssm_blur_distant_vert"))
+    if (task_scheduler->is_scheduled(_task_blur_vert))
         _target_blur_v->set_active(true);
 
-    if (pipeline_.get_task_scheduler()->is_scheduled("pssm_blur_distant_horiz"))
+    if (task_scheduler->is_scheduled(_task_blur_horiz))
     {
         _target_blur_h->set_active(true);
 
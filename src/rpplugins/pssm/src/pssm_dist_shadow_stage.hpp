@@ -23,6 +23,7 @@
 #pragma once
 
 #include <render_pipeline/rpcore/render_stage.hpp>
+#include <render_pipeline/rpcore/util/task_scheduler.hpp>
 
 #include <camera.h>
 #include <orthographicLens.h>
@@ -75,6 +76,11 @@ private:
     rpcore::RenderTarget* _target_convert;
     rpcore::RenderTarget* _target_blur_v;
     rpcore::RenderTarget* _target_blur_h;
+
+    rpcore::TaskScheduler::TaskId _task_distant_shadows;
+    rpcore::TaskScheduler::TaskId _task_convert_to_esm;
+    rpcore::TaskScheduler::TaskId _task_blur_vert;
+    rpcore::TaskScheduler::TaskId _task_blur_horiz;
 };
 
 inline void PSSMDistShadowStage::set_resolution(int resolution)
@@ -23,6 +23,7 @@
 #pragma once
 
 #include <render_pipeline/rpcore/render_stage.hpp>
+#include <render_pipeline/rpcore/util/task_scheduler.hpp>
 
 #include <boost/optional.hpp>
 
@@ -83,6 +84,8 @@ private:
     NodePath _cam_node;
 
     rpcore::RenderTarget* _target;
+
+    rpcore::TaskScheduler::TaskId _task_scene_shadows;
 };
 
 inline void PSSMSceneShadowStage::set_resolution(int resolution)
@@ -49,6 +49,8 @@ set(${PROJECT_NAME}_source_root
     "${PROJECT_SOURCE_DIR}/src/plugin.cpp"
     "${PROJECT_SOURCE_DIR}/src/scenegraph_window.cpp"
     "${PROJECT_SOURCE_DIR}/src/scenegraph_window.hpp"
+    "${PROJECT_SOURCE_DIR}/src/stage_timing_window.cpp"
+    "${PROJECT_SOURCE_DIR}/src/stage_timing_window.hpp"
     "${PROJECT_SOURCE_DIR}/src/texture_window.cpp"
     "${PROJECT_SOURCE_DIR}/src/texture_window.hpp"
     "${PROJECT_SOURCE_DIR}/src/window_interface.cpp"
@@ -75,6 +75,12 @@ void DayManagerWindow::draw_contents()
         // sync GUI
         std::memcpy(formatted_time_, manager_->get_formatted_time().c_str(), std::extent<decltype(formatted_time_)>::value - 1);
     }
+
+    bool paused = manager_->is_paused();
+    if (ImGui::Checkbox("Paused", &paused))
+        manager_->set_paused(paused);
+
+    ImGui::Text("Skipped updates: %zu", manager_->get_skipped_updates());
 }
 
 void DayManagerWindow::show()
@@ -50,6 +50,7 @@
 #include "texture_window.hpp"
 #include "day_manager_window.hpp"
 #include "actor_window.hpp"
+#include "stage_timing_window.hpp"
 
 #include "rpplugins/rpstat/gui_interface.hpp"
 
@@ -100,6 +101,7 @@ void RPStatPlugin::on_pipeline_created()
     windows_.push_back(std::make_unique<MaterialWindow>(*this, pipeline_));
     windows_.push_back(std::make_unique<TextureWindow>(*this, pipeline_));
     windows_.push_back(std::make_unique<DayManagerWindow>(*this, pipeline_));
+    windows_.push_back(std::make_unique<StageTimingWindow>(*this, pipeline_));
 
     imgui_plugin_ = static_cast<ImGuiPlugin*>(pipeline_.get_plugin_mgr()->get_instance("imgui")->downcast());
     accept(ImGuiPlugin::DROPFILES_EVENT_NAME, [this](auto) { file_dropped_ = true; });
@@ -219,7 +221,7 @@ void RPStatPlugin::draw_main_menu_bar()
     {
         if (ImGui::BeginMenu("Windows"))
         {
-            for (const auto& window_title: {"Scenegraph", "NodePath", "Actor", "Material", "Texture", "Day Manager"})
+            for (const auto& window_title: {"Scenegraph", "NodePath", "Actor", "Material", "Texture", "Day Manager", "Stage Timings"})
             {
                 if (ImGui::MenuItem(window_title))
                 {
@@ -0,0 +1,122 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2018 Younguk Kim (bluekyu)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "stage_timing_window.hpp"
+
+#include <algorithm>
+#include <numeric>
+
+#include <fmt/format.h>
+
+#include <render_pipeline/rpcore/render_pipeline.hpp>
+#include <render_pipeline/rpcore/stage_manager.hpp>
+
+namespace rpplugins {
+
+StageTimingWindow::StageTimingWindow(RPStatPlugin& plugin, rpcore::RenderPipeline& pipeline) : WindowInterface(plugin, pipeline, "Stage Timings", "###Stage Timings")
+{
+    manager_ = pipeline_.get_stage_mgr();
+}
+
+StageTimingWindow::~StageTimingWindow() = default;
+
+void StageTimingWindow::draw_contents()
+{
+    const auto& timings = manager_->get_stage_timings();
+
+    sorted_indices_.resize(timings.size());
+    std::iota(sorted_indices_.begin(), sorted_indices_.end(), size_t(0));
+    std::stable_sort(sorted_indices_.begin(), sorted_indices_.end(), [&](size_t lhs, size_t rhs) {
+        if (sort_descending_)
+            std::swap(lhs, rhs);
+
+        switch (sort_column_)
+        {
+        case SortColumn::stage:
+            return timings[lhs].stage_id < timings[rhs].stage_id;
+        case SortColumn::update_time:
+            return timings[lhs].update_time < timings[rhs].update_time;
+        case SortColumn::average_time:
+            return timings[lhs].average_time < timings[rhs].average_time;
+        default:
+            return lhs < rhs;
+        }
+    });
+
+    double total_time = 0;
+    for (const auto& timing: timings)
+        total_time += timing.update_time;
+    ImGui::Text("Total: %.3f ms", total_time);
+
+    ImGui::Columns(4, "stage_timings");
+    draw_header("#", SortColumn::order);
+    draw_header("Stage", SortColumn::stage);
+    draw_header("Update (ms)", SortColumn::update_time);
+    draw_header("Average (ms)", SortColumn::average_time);
+    ImGui::Separator();
+
+    for (const size_t index: sorted_indices_)
+    {
+        const auto& timing = timings[index];
+        if (!timing.active)
+            ImGui::PushStyleColor(ImGuiCol_Text, ImGui::GetStyle().Colors[ImGuiCol_TextDisabled]);
+
+        ImGui::Text("%d", static_cast<int>(index));
+        ImGui::NextColumn();
+        ImGui::TextUnformatted(timing.stage_id.c_str());
+        ImGui::NextColumn();
+        ImGui::Text("%.3f", timing.update_time);
+        ImGui::NextColumn();
+        ImGui::Text("%.3f", timing.average_time);
+        ImGui::NextColumn();
+
+        if (!timing.active)
+            ImGui::PopStyleColor();
+    }
+
+    ImGui::Columns(1);
+}
+
+void StageTimingWindow::draw_header(const char* label, SortColumn column)
+{
+    const std::string& text = sort_column_ == column ?
+        fmt::format("{} {}", label, sort_descending_ ? "v" : "^") :
+        std::string(label);
+
+    if (ImGui::Selectable(text.c_str(), sort_column_ == column))
+    {
+        if (sort_column_ == column)
+        {
+            sort_descending_ = !sort_descending_;
+        }
+        else
+        {
+            sort_column_ = column;
+            sort_descending_ = column == SortColumn::update_time || column == SortColumn::average_time;
+        }
+    }
+    ImGui::NextColumn();
+}
+
+}
@@ -0,0 +1,63 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2018 Younguk Kim (bluekyu)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#pragma once
+
+#include <vector>
+
+#include "window_interface.hpp"
+
+namespace rpcore {
+class StageManager;
+}
+
+namespace rpplugins {
+
+class StageTimingWindow : public WindowInterface
+{
+public:
+    StageTimingWindow(RPStatPlugin& plugin, rpcore::RenderPipeline& pipeline);
+    ~StageTimingWindow() override;
+
+    void draw_contents() final;
+
+private:
+    enum class SortColumn: int
+    {
+        order = 0,
+        stage,
+        update_time,
+        average_time,
+    };
+
+    void draw_header(const char* label, SortColumn column);
+
+    rpcore::StageManager* manager_;
+
+    SortColumn sort_column_ = SortColumn::order;
+    bool sort_descending_ = false;
+    std::vector<size_t> sorted_indices_;
+};
+
+}
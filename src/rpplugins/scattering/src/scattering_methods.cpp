@@ -60,6 +60,10 @@ void ScatteringMethodEricBruneton::load()
 void ScatteringMethodEricBruneton::exec_compute_shader(const Shader* shader_obj, const std::vector<ShaderInput>& shader_inputs,
     const LVecBase3i& exec_size, const LVecBase3i& workgroup_size)
 {
+    // There is no GPU to run compute shaders in headless mode.
+    if (rpcore::Globals::headless)
+        return;
+
     const int ntx = int(std::ceil(float(exec_size[0]) / workgroup_size[0]));
     const int nty = int(std::ceil(float(exec_size[1]) / workgroup_size[1]));
     const int ntz = int(std::ceil(float(exec_size[2]) / workgroup_size[2]));
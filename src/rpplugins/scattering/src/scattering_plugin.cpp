@@ -48,6 +48,8 @@ public:
     ScatteringStage* display_stage_;
     ScatteringEnvmapStage* envmap_stage_;
     std::unique_ptr<ScatteringMethod> scattering_model_;
+
+    rpcore::TaskScheduler::TaskId task_update_envmap_;
 };
 
 ScatteringPlugin::RequrieType ScatteringPlugin::Impl::require_plugins_;
@@ -80,6 +82,7 @@ void ScatteringPlugin::on_stage_setup()
     auto envmap_stage = std::make_unique<ScatteringEnvmapStage>(pipeline_);
     impl_->envmap_stage_ = envmap_stage.get();
     add_stage(std::move(envmap_stage));
+    impl_->task_update_envmap_ = pipeline_.get_task_scheduler()->get_task_id("scattering_update_envmap");
 
     if (get_setting<rpcore::BoolType>("enable_godrays"))
     {
@@ -107,7 +110,7 @@ void ScatteringPlugin::on_stage_setup()
 
 void ScatteringPlugin::on_pre_render_update()
 {
-    impl_->envmap_stage_->set_active(pipeline_.get_task_scheduler()->is_scheduled("scattering_update_envmap"));
+    impl_->envmap_stage_->set_active(pipeline_.get_task_scheduler()->is_scheduled(impl_->task_update_envmap_));
 }
 
 void ScatteringPlugin::on_shader_reload()
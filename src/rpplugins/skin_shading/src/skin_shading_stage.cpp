@@ -43,7 +43,7 @@ void SkinShadingStage::create()
 
     for (int i = 0; i < 3; ++i)
     {
-        auto target_h = create_target(std::string("BlurH-") + std::to_string(i));
+        auto target_h = create_target(std::string("BlurH-") + std::to_string(i), true);
         target_h->add_color_attachment(16);
         target_h->prepare_buffer();
         target_h->set_shader_input(ShaderInput("direction", LVecBase2i(1, 0)));
@@ -51,7 +51,8 @@ void SkinShadingStage::create()
             target_h->set_shader_input(ShaderInput("ShadedScene", current_tex), true);
         current_tex = target_h->get_color_tex();
 
-        auto target_v = create_target(std::string("BlurV-") + std::to_string(i));
+        // The last target produces ShadedScene.
+        auto target_v = create_target(std::string("BlurV-") + std::to_string(i), i < 2);
         target_v->add_color_attachment(16);
         target_v->prepare_buffer();
         target_v->set_shader_input(ShaderInput("ShadedScene", current_tex), true);
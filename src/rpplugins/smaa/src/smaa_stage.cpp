@@ -63,7 +63,7 @@ void SMAAStage::create()
     stereo_mode_ = pipeline_.is_stereo_mode();
 
     // Edge detection
-    edge_target_ = create_target("EdgeDetection");
+    edge_target_ = create_target("EdgeDetection", true);
     edge_target_->add_color_attachment();
     if (stereo_mode_)
         edge_target_->set_layers(2);
@@ -71,7 +71,7 @@ void SMAAStage::create()
     edge_target_->set_clear_color(LColor(0, 0, 0, 0));
 
     // Weight blending
-    blend_target_ = create_target("BlendWeights");
+    blend_target_ = create_target("BlendWeights", true);
     blend_target_->add_color_attachment(8, true);
     if (stereo_mode_)
         blend_target_->set_layers(2);
@@ -50,16 +50,16 @@ void SSRStage::create()
     _target->get_color_tex()->set_minfilter(SamplerState::FT_nearest);
     _target->get_color_tex()->set_magfilter(SamplerState::FT_nearest);
 
-    _target_velocity = create_target("ReflectionVelocity");
+    _target_velocity = create_target("ReflectionVelocity", true);
     _target_velocity->add_color_attachment(LVecBase4i(16, 16, 0, 0));
     _target_velocity->prepare_buffer();
     _target_velocity->set_shader_input(ShaderInput("TraceResult", _target->get_color_tex()));
 
-    _target_reproject_lighting = create_target("CopyLighting");
+    _target_reproject_lighting = create_target("CopyLighting", true);
     _target_reproject_lighting->add_color_attachment(16, true);
     _target_reproject_lighting->prepare_buffer();
 
-    _target_upscale = create_target("UpscaleSSR");
+    _target_upscale = create_target("UpscaleSSR", true);
     _target_upscale->add_color_attachment(16, true);
     _target_upscale->prepare_buffer();
     _target_upscale->set_shader_input(ShaderInput("SourceTex", _target->get_color_tex()));
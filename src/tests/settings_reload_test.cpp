@@ -0,0 +1,192 @@
+/**
+ * Render Pipeline C++
+ *
+ * Copyright (c) 2018 Center of Human-centered Interaction for Coexistence.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+ * and associated documentation files (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial
+ * portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT
+ * LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * Creates a headless pipeline, changes the plugin settings in plugins.yaml and
+ * checks which stages are rebuilt or reloaded by PluginManager::reload_setting_overrides.
+ *
+ * Usage: rptest_settings_reload --config-dir <dir> [--base-path <dir>]
+ *
+ * The config directory needs 'pipeline.headless: true'. The base path is the
+ * installed data directory of the pipeline, which contains the plugins.
+ *
+ * Returns non-zero if any check fails.
+ */
+
+#include <algorithm>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <fmt/format.h>
+#include <yaml-cpp/yaml.h>
+
+#include <shaderInput.h>
+
+#include <render_pipeline/rpcore/mount_manager.hpp>
+#include <render_pipeline/rpcore/render_pipeline.hpp>
+#include <render_pipeline/rpcore/render_stage.hpp>
+#include <render_pipeline/rpcore/stage_manager.hpp>
+#include <render_pipeline/rpcore/pluginbase/manager.hpp>
+
+static int failures = 0;
+
+static void check(bool condition, const std::string& message)
+{
+    if (!condition)
+    {
+        std::cerr << "FAILED: " << message << std::endl;
+        ++failures;
+    }
+}
+
+static bool contains(const std::vector<std::string>& values, const std::string& value)
+{
+    return std::find(values.begin(), values.end(), value) != values.end();
+}
+
+static size_t get_target_count(rpcore::StageManager* stage_mgr, const std::string& stage_id)
+{
+    const rpcore::RenderStage* stage = stage_mgr->get_stage(stage_id);
+    return stage ? stage->get_targets().size() : 0;
+}
+
+/** Writes plugins.yaml of @p config_dir modified by @p modify to @p path, and reloads it. */
+static rpcore::PluginManager::SettingsReloadResult reload_settings(rpcore::RenderPipeline& pipeline,
+    const std::string& config_dir, const std::string& path, const std::function<void(YAML::Node&)>& modify)
+{
+    YAML::Node overrides = YAML::LoadFile(config_dir + "/plugins.yaml");
+    modify(overrides);
+
+    {
+        std::ofstream file(path);
+        file << overrides;
+    }
+
+    return pipeline.get_plugin_mgr()->reload_setting_overrides(Filename::from_os_specific(path));
+}
+
+int main(int argc, char* argv[])
+{
+    std::string config_dir;
+    std::string base_path;
+    for (int k = 1; k < argc; ++k)
+    {
+        const std::string arg = argv[k];
+        if (arg == "--config-dir" && k + 1 < argc)
+            config_dir = argv[++k];
+        else if (arg == "--base-path" && k + 1 < argc)
+            base_path = argv[++k];
+    }
+
+    if (config_dir.empty())
+    {
+        std::cerr << "Usage: rptest_settings_reload --config-dir <dir> [--base-path <dir>]" << std::endl;
+        return 1;
+    }
+
+    auto pipeline = std::make_unique<rpcore::RenderPipeline>();
+    if (!base_path.empty())
+        pipeline->get_mount_mgr()->set_base_path(Filename::from_os_specific(base_path));
+    pipeline->get_mount_mgr()->set_config_dir(Filename::from_os_specific(config_dir));
+    if (!pipeline->create())
+    {
+        std::cerr << "Failed to create the pipeline." << std::endl;
+        return 1;
+    }
+
+    auto stage_mgr = pipeline->get_stage_mgr();
+    const std::string override_path = config_dir + "/plugins_reload.yaml";
+
+    // The same settings change nothing.
+    {
+        const auto& result = reload_settings(*pipeline, config_dir, override_path, [](YAML::Node&) {});
+        check(result.changed_settings.empty(), "unchanged settings are reported as changed");
+        check(result.rebuilt_stages.empty() && result.reloaded_stages.empty(), "unchanged settings rebuild or reload stages");
+    }
+
+    Texture* ao_tex = stage_mgr->get_pipe("AmbientOcclusion").get_texture();
+
+    // Mipmaps of bloom are applied when BloomStage is created.
+    {
+        const auto& result = reload_settings(*pipeline, config_dir, override_path, [](YAML::Node& overrides) {
+            overrides["overrides"]["bloom"]["num_mipmaps"] = 4;
+        });
+        check(!result.requires_restart, "bloom:num_mipmaps requires to restart");
+        check(result.rebuilt_stages == std::vector<std::string>{ "BloomStage" },
+            fmt::format("bloom:num_mipmaps rebuilds {} stages instead of BloomStage", result.rebuilt_stages.size()));
+
+        // ExtractBrightSpots, ApplyBloom and a downsample and upsample target per mipmap.
+        check(get_target_count(stage_mgr, "BloomStage") == 2 + 2 * 4,
+            fmt::format("BloomStage has {} targets after the rebuild", get_target_count(stage_mgr, "BloomStage")));
+        check(stage_mgr->get_pipe("AmbientOcclusion").get_texture() == ao_tex, "AOStage is rebuilt by bloom:num_mipmaps");
+    }
+
+    // The blur quality changes the blur targets of AOStage, and keeps BloomStage.
+    {
+        const auto& result = reload_settings(*pipeline, config_dir, override_path, [](YAML::Node& overrides) {
+            overrides["overrides"]["bloom"]["num_mipmaps"] = 4;
+            overrides["overrides"]["ao"]["blur_quality"] = "HIGH";
+        });
+        check(!result.requires_restart, "ao:blur_quality requires to restart");
+        check(result.rebuilt_stages == std::vector<std::string>{ "AOStage" },
+            fmt::format("ao:blur_quality rebuilds {} stages instead of AOStage", result.rebuilt_stages.size()));
+        check(stage_mgr->get_pipe("AmbientOcclusion").get_texture() != ao_tex, "AmbientOcclusion is not created again");
+        check(get_target_count(stage_mgr, "BloomStage") == 2 + 2 * 4, "BloomStage is changed by ao:blur_quality");
+    }
+
+    // Shader runtime settings only reload the shaders using them.
+    {
+        const auto& result = reload_settings(*pipeline, config_dir, override_path, [](YAML::Node& overrides) {
+            overrides["overrides"]["bloom"]["num_mipmaps"] = 4;
+            overrides["overrides"]["ao"]["blur_quality"] = "HIGH";
+            overrides["overrides"]["bloom"]["bloom_strength"] = 0.5;
+        });
+        check(!result.requires_restart, "bloom:bloom_strength requires to restart");
+        check(result.rebuilt_stages.empty(), "bloom:bloom_strength rebuilds stages");
+        check(contains(result.reloaded_stages, "BloomStage"), "BloomStage is not reloaded by bloom:bloom_strength");
+        check(!contains(result.reloaded_stages, "AOStage"), "AOStage is reloaded by bloom:bloom_strength");
+    }
+
+    // PSSM does not create its stages again.
+    {
+        const auto& result = reload_settings(*pipeline, config_dir, override_path, [](YAML::Node& overrides) {
+            overrides["overrides"]["bloom"]["num_mipmaps"] = 4;
+            overrides["overrides"]["ao"]["blur_quality"] = "HIGH";
+            overrides["overrides"]["bloom"]["bloom_strength"] = 0.5;
+            overrides["overrides"]["pssm"]["resolution"] = 512;
+        });
+        check(result.requires_restart, "pssm:resolution does not require to restart");
+        check(result.rebuilt_stages.empty(), "pssm:resolution rebuilds stages");
+    }
+
+    pipeline.reset();
+
+    if (failures)
+        std::cerr << failures << " checks failed." << std::endl;
+    else
+        std::cout << "All checks passed." << std::endl;
+
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,210 @@
+/**
+ * Render Pipeline C++
+ *
+ * Copyright (c) 2018 Center of Human-centered Interaction for Coexistence.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+ * and associated documentation files (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial
+ * portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT
+ * LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * Creates a headless pipeline with the shipped plugins.yaml and daytime.yaml,
+ * modifies some settings, saves them with PluginManager::save_overrides and
+ * PluginManager::save_daytime_overrides, and loads the saved files again.
+ *
+ * Usage: rptest_settings_save --config-dir <dir> [--base-path <dir>]
+ *
+ * The config directory needs 'pipeline.headless: true'. The base path is the
+ * installed data directory of the pipeline, which contains the plugins.
+ *
+ * Returns non-zero if any check fails.
+ */
+
+#include <iostream>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <fmt/format.h>
+#include <yaml-cpp/yaml.h>
+
+#include <render_pipeline/rpcore/mount_manager.hpp>
+#include <render_pipeline/rpcore/render_pipeline.hpp>
+#include <render_pipeline/rpcore/pluginbase/day_setting_types.hpp>
+#include <render_pipeline/rpcore/pluginbase/manager.hpp>
+#include <render_pipeline/rpcore/pluginbase/setting_types.hpp>
+
+static int failures = 0;
+
+static void check(bool condition, const std::string& message)
+{
+    if (!condition)
+    {
+        std::cerr << "FAILED: " << message << std::endl;
+        ++failures;
+    }
+}
+
+/** Returns the serialized curves of all day time settings, by "plugin:setting". */
+static std::unordered_map<std::string, std::string> get_day_settings(rpcore::PluginManager* plugin_mgr)
+{
+    std::unordered_map<std::string, std::string> values;
+    for (const auto& plugin_id: plugin_mgr->get_plugin_ids())
+    {
+        for (const auto& setting_handle: plugin_mgr->get_day_settings(plugin_id)->get<0>())
+            values[plugin_id + ":" + setting_handle.key] = setting_handle.value->serialize();
+    }
+    return values;
+}
+
+int main(int argc, char* argv[])
+{
+    std::string config_dir;
+    std::string base_path;
+    for (int k = 1; k < argc; ++k)
+    {
+        const std::string arg = argv[k];
+        if (arg == "--config-dir" && k + 1 < argc)
+            config_dir = argv[++k];
+        else if (arg == "--base-path" && k + 1 < argc)
+            base_path = argv[++k];
+    }
+
+    if (config_dir.empty())
+    {
+        std::cerr << "Usage: rptest_settings_save --config-dir <dir> [--base-path <dir>]" << std::endl;
+        return 1;
+    }
+
+    auto pipeline = std::make_unique<rpcore::RenderPipeline>();
+    if (!base_path.empty())
+        pipeline->get_mount_mgr()->set_base_path(Filename::from_os_specific(base_path));
+    pipeline->get_mount_mgr()->set_config_dir(Filename::from_os_specific(config_dir));
+    if (!pipeline->create())
+    {
+        std::cerr << "Failed to create the pipeline." << std::endl;
+        return 1;
+    }
+
+    auto plugin_mgr = pipeline->get_plugin_mgr();
+    const YAML::Node shipped_overrides = YAML::LoadFile(config_dir + "/plugins.yaml")["overrides"];
+    const std::string settings_path = config_dir + "/plugins_saved.yaml";
+    const std::string daytime_path = config_dir + "/daytime_saved.yaml";
+
+    // Modify a setting and a scalar day time setting, whose curve values need all decimals.
+    auto occlusion_strength = plugin_mgr->get_setting_handle("ao", "occlusion_strength");
+    check(occlusion_strength != nullptr, "ao:occlusion_strength does not exist");
+    if (occlusion_strength)
+        occlusion_strength->set_value(YAML::Node(1.2345f));
+
+    auto camera_iso = plugin_mgr->get_day_settings("color_correction")->get<1>().find("camera_iso");
+    check(camera_iso->value->get_num_components() == 1, "color_correction:camera_iso is not a scalar");
+    camera_iso->value->set_control_points({ { LVecBase2(0.123456789f, 0.987654321f), LVecBase2(0.75f, 0.0000012f) } });
+
+    // The values of the settings in the shipped file and of the modified setting.
+    std::unordered_map<std::string, std::string> settings;
+    for (const auto& id_settings: shipped_overrides)
+    {
+        const std::string plugin_id = id_settings.first.as<std::string>();
+        for (const auto& id_value: id_settings.second)
+        {
+            const std::string setting_id = id_value.first.as<std::string>();
+            if (auto handle = plugin_mgr->get_setting_handle(plugin_id, setting_id))
+                settings[plugin_id + ":" + setting_id] = handle->get_value_as_string();
+        }
+    }
+    settings["ao:occlusion_strength"] = occlusion_strength ? occlusion_strength->get_value_as_string() : "";
+    const auto& day_settings = get_day_settings(plugin_mgr);
+
+    plugin_mgr->save_overrides(Filename::from_os_specific(settings_path));
+    plugin_mgr->save_daytime_overrides(Filename::from_os_specific(daytime_path));
+    plugin_mgr->wait_for_saves();
+
+    YAML::Node saved_settings;
+    YAML::Node saved_day_settings;
+    try
+    {
+        saved_settings = YAML::LoadFile(settings_path);
+        saved_day_settings = YAML::LoadFile(daytime_path);
+    }
+    catch (const YAML::Exception& err)
+    {
+        std::cerr << "FAILED: saved overrides are not valid YAML: " << err.what() << std::endl;
+        return 1;
+    }
+
+    // Only the settings which differ from the defaults are saved.
+    for (const auto& id_value: settings)
+    {
+        const auto separator = id_value.first.find(':');
+        const std::string plugin_id = id_value.first.substr(0, separator);
+        const std::string setting_id = id_value.first.substr(separator + 1);
+
+        const bool is_default = plugin_mgr->get_setting_handle(plugin_id, setting_id)->is_default();
+        const bool saved = saved_settings["overrides"][plugin_id] && saved_settings["overrides"][plugin_id][setting_id];
+        check(saved != is_default, fmt::format("{} is {}saved, but {}default", id_value.first, saved ? "" : "not ", is_default ? "" : "not "));
+    }
+
+    for (const auto& plugin_id: plugin_mgr->get_plugin_ids())
+    {
+        for (const auto& setting_handle: plugin_mgr->get_day_settings(plugin_id)->get<0>())
+        {
+            const bool is_default = setting_handle.value->is_default();
+            const bool saved = saved_day_settings["control_points"][plugin_id] && saved_day_settings["control_points"][plugin_id][setting_handle.key];
+            check(saved != is_default, fmt::format("Day time setting {}:{} is {}saved, but {}default",
+                plugin_id, setting_handle.key, saved ? "" : "not ", is_default ? "" : "not "));
+        }
+    }
+
+    const YAML::Node saved_camera_iso = saved_day_settings["control_points"]["color_correction"]["camera_iso"];
+    check(saved_camera_iso && saved_camera_iso.size() == 1, "color_correction:camera_iso is not saved with one curve");
+
+    // Reset the settings and load the saved files.
+    for (const auto& plugin_id: plugin_mgr->get_plugin_ids())
+    {
+        plugin_mgr->reset_plugin_settings(plugin_id);
+
+        for (const auto& setting_handle: plugin_mgr->get_day_settings(plugin_id)->get<0>())
+        {
+            if (!setting_handle.value->is_default())
+                setting_handle.value->set_control_points(std::vector<std::vector<LVecBase2>>(
+                    setting_handle.value->get_num_components(), { LVecBase2(0.5f, 0.5f) }));
+        }
+    }
+
+    plugin_mgr->load_setting_overrides(Filename::from_os_specific(settings_path));
+    plugin_mgr->load_daytime_overrides(Filename::from_os_specific(daytime_path));
+
+    for (const auto& id_value: settings)
+    {
+        const auto separator = id_value.first.find(':');
+        const auto handle = plugin_mgr->get_setting_handle(id_value.first.substr(0, separator), id_value.first.substr(separator + 1));
+        check(handle->get_value_as_string() == id_value.second, fmt::format("{} is {} after reloading instead of {}",
+            id_value.first, handle->get_value_as_string(), id_value.second));
+    }
+
+    for (const auto& id_value: get_day_settings(plugin_mgr))
+        check(id_value.second == day_settings.at(id_value.first), fmt::format("Day time setting {} is changed after reloading", id_value.first));
+
+    pipeline.reset();
+
+    if (failures)
+        std::cerr << failures << " checks failed." << std::endl;
+    else
+        std::cout << "All checks passed." << std::endl;
+
+    return failures ? 1 : 0;
+}
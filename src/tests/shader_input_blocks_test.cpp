@@ -0,0 +1,215 @@
+/**
+ * Render Pipeline C++
+ *
+ * Copyright (c) 2018 Center of Human-centered Interaction for Coexistence.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+ * and associated documentation files (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial
+ * portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT
+ * LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * Checks the std140 layout and the packed data of GroupedInputBlock, and
+ * that the generated GLSL reads every input at its offset in the layout.
+ *
+ * Returns non-zero if any check fails.
+ */
+
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <regex>
+#include <set>
+#include <sstream>
+#include <string>
+
+#include <fmt/format.h>
+
+#include <render_pipeline/rpcore/util/shader_input_blocks.hpp>
+
+static int failures = 0;
+
+static void check(bool condition, const std::string& message)
+{
+    if (!condition)
+    {
+        std::cerr << "FAILED: " << message << std::endl;
+        ++failures;
+    }
+}
+
+static void check_member(const rpcore::GroupedInputBlock& block, const std::string& name, size_t offset, size_t array_stride)
+{
+    for (const auto& member: block.get_layout())
+    {
+        if (member.name != name)
+            continue;
+
+        check(member.offset == offset, fmt::format("offset of {} is {}, expected {}", name, member.offset, offset));
+        check(member.array_stride == array_stride,
+            fmt::format("array stride of {} is {}, expected {}", name, member.array_stride, array_stride));
+        return;
+    }
+
+    check(false, fmt::format("{} is not in the layout", name));
+}
+
+static void check_float(const rpcore::GroupedInputBlock& block, size_t offset, float expected)
+{
+    float value;
+    std::memcpy(&value, reinterpret_cast<const unsigned char*>(block.get_packed_data().p()) + offset, sizeof(value));
+    check(value == expected, fmt::format("packed float at {} is {}, expected {}", offset, value, expected));
+}
+
+/**
+ * Checks the "// offset N" comments of the declarations and the unpack code of
+ * the generated GLSL against the layout.
+ *
+ * Without UBO support, each element is unpacked like
+ * "block.name[k] = Name_UBO_DATA[slot].swizzle;", so its byte offset is
+ * slot * 16 + 4 * (index of the first swizzle component).
+ */
+static void check_shader_code(const rpcore::GroupedInputBlock& block)
+{
+    const std::string code = block.generate_shader_code();
+    const std::string& name = block.get_name();
+
+    // declarations of the top level members: "<type> <name>[<size>]; // offset <N>"
+    const std::regex declaration_regex(R"(^\s*(\w+) (\w+)(?:\[\d+\])?;\s*// offset (\d+)$)");
+    const std::regex unpack_regex("^\\s*block\\.([\\w.]+)(?:\\[(\\d+)\\])? = .*?" + name +
+        "_UBO_(I?)DATA\\[(\\d+)\\](?:\\.([xyzw]+))?");
+
+    std::map<std::string, size_t> declared_offsets;
+    std::map<std::pair<std::string, size_t>, std::pair<size_t, bool>> unpacked_offsets;
+
+    std::istringstream lines(code);
+    std::string line;
+    std::smatch match;
+    while (std::getline(lines, line))
+    {
+        if (std::regex_search(line, match, declaration_regex))
+        {
+            declared_offsets[match[2]] = std::stoul(match[3]);
+        }
+        else if (std::regex_search(line, match, unpack_regex))
+        {
+            const size_t index = match[2].matched ? std::stoul(match[2]) : 0;
+            const size_t component = match[5].matched ? std::string("xyzw").find(match[5].str().front()) : 0;
+            unpacked_offsets[{ match[1], index }] = { std::stoul(match[4]) * 16 + component * 4, match[3].length() > 0 };
+        }
+    }
+
+    // With UBO support, the block is declared as uniform block and nothing is unpacked.
+    const bool packed = code.find(name + "_UBO_DATA[") != std::string::npos;
+
+    std::set<std::string> checked_declarations;
+    for (const auto& member: block.get_layout())
+    {
+        // A struct is declared at the offset of its first member.
+        const size_t dot_pos = member.name.find('.');
+        const std::string declared_name = dot_pos == std::string::npos ? member.name : member.name.substr(0, dot_pos);
+        const auto declared = declared_offsets.find(declared_name);
+        if (declared == declared_offsets.end())
+            check(false, fmt::format("{} is not declared in the generated code", declared_name));
+        else if (checked_declarations.insert(declared_name).second)
+            check(declared->second == member.offset, fmt::format("declared offset of {} is {}, expected {}",
+                declared_name, declared->second, member.offset));
+
+        if (!packed)
+            continue;
+
+        const bool is_int = member.type == rpcore::GroupedInputBlock::PTA_ID::PTA_int ||
+            member.type == rpcore::GroupedInputBlock::PTA_ID::PTA_LVecBase2i;
+        for (size_t k = 0; k < member.array_size; ++k)
+        {
+            const size_t expected = member.offset + k * member.array_stride;
+            const auto unpacked = unpacked_offsets.find({ member.name, k });
+            if (unpacked == unpacked_offsets.end())
+            {
+                check(false, fmt::format("{}[{}] is not unpacked in the generated code", member.name, k));
+                continue;
+            }
+
+            check(unpacked->second.first == expected, fmt::format("unpacked offset of {}[{}] is {}, expected {}",
+                member.name, k, unpacked->second.first, expected));
+            check(unpacked->second.second == is_int, fmt::format("{}[{}] is unpacked from the {} array",
+                member.name, k, unpacked->second.second ? "integer" : "float"));
+        }
+    }
+}
+
+int main()
+{
+    rpcore::GroupedInputBlock block("TestBlock");
+    block.register_pta("a", "float");
+    block.register_pta("b", "vec3");
+    block.register_pta("c", "float");
+    block.register_pta("d", "mat4");
+    block.register_pta("e", "vec2");
+    block.register_pta("f[2]", "float");
+    block.register_pta("g", "vec3");
+    block.register_pta("h", "int");
+    block.register_pta("s.x", "float");
+    block.register_pta("s.y", "vec3");
+    block.register_pta("m", "mat3");
+
+    // A scalar is packed after a vec3, and a struct starts and ends at vec4 alignment.
+    check_member(block, "a", 0, 4);
+    check_member(block, "b", 16, 12);
+    check_member(block, "c", 28, 4);
+    check_member(block, "d", 32, 64);
+    check_member(block, "e", 96, 8);
+    check_member(block, "f", 112, 16);
+    check_member(block, "g", 144, 12);
+    check_member(block, "h", 156, 4);
+    check_member(block, "s.x", 160, 4);
+    check_member(block, "s.y", 176, 12);
+    check_member(block, "m", 192, 48);
+    check(block.get_layout_size() == 240, fmt::format("layout size is {}, expected 240", block.get_layout_size()));
+    check(block.get_packed_data().size() == 240 / 16, "packed data does not cover the layout");
+
+    block.update_input("c", 5.0f);
+    block.update_input("d", LMatrix4f(1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16));
+    block.update_input("f", 7.0f, 1);
+    block.update_input("h", 42);
+    block.update_input("s.y", LVecBase3f(1, 2, 3));
+    block.update_input("m", LMatrix3f(1, 2, 3, 4, 5, 6, 7, 8, 9));
+
+    check(block.flush(), "first flush does not report a change");
+    check(!block.flush(), "second flush reports a change");
+
+    check_float(block, 28, 5.0f);
+    check_float(block, 32, 1.0f);
+    check_float(block, 92, 16.0f);
+    check_float(block, 128, 7.0f);
+    check_float(block, 180, 2.0f);
+
+    // Integers are packed at the same offset in the integer array.
+    check(block.get_packed_int_data().size() == block.get_packed_data().size(), "packed int data does not cover the layout");
+    int int_value;
+    std::memcpy(&int_value, reinterpret_cast<const unsigned char*>(block.get_packed_int_data().p()) + 156, sizeof(int_value));
+    check(int_value == 42, fmt::format("packed int is {}, expected 42", int_value));
+
+    // Each row of mat3 is padded to vec4.
+    check_float(block, 192, 1.0f);
+    check_float(block, 208, 4.0f);
+    check_float(block, 232, 9.0f);
+
+    check_shader_code(block);
+
+    if (failures == 0)
+        std::cout << "All checks passed." << std::endl;
+
+    return failures == 0 ? 0 : 1;
+}
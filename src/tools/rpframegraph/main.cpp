@@ -0,0 +1,96 @@
+/**
+ * Render Pipeline C++
+ *
+ * Copyright (c) 2018 Center of Human-centered Interaction for Coexistence.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+ * and associated documentation files (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial
+ * portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT
+ * LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+/**
+ * Creates the pipeline and writes the resolved frame graph as JSON.
+ *
+ * Usage: rpframegraph <output.json> [--config-dir <dir>]
+ *
+ * The output contains the stages in execution order, their pipes, inputs, defines
+ * and render targets with formats, sizes and bytes, and the frame cycles of
+ * the task scheduler. Use a config directory with 'pipeline.headless: true'
+ * to export the graph without a window or GPU. Headless mode still creates
+ * a GSG (the software renderer if there is no GPU) and 1x1 stub buffers for
+ * the targets, so the bytes are estimated from the requested attachments.
+ */
+
+#include <iostream>
+#include <memory>
+#include <string>
+
+#include <fmt/format.h>
+
+#include <render_pipeline/rpcore/mount_manager.hpp>
+#include <render_pipeline/rpcore/render_pipeline.hpp>
+#include <render_pipeline/rpcore/stage_manager.hpp>
+
+static void print_usage()
+{
+    std::cerr << "Usage: rpframegraph <output.json> [--config-dir <dir>]" << std::endl;
+}
+
+int main(int argc, char* argv[])
+{
+    std::string output_path;
+    std::string config_dir;
+
+    for (int k = 1; k < argc; ++k)
+    {
+        const std::string arg = argv[k];
+        if (arg == "--config-dir" && k + 1 < argc)
+        {
+            config_dir = argv[++k];
+        }
+        else if (output_path.empty() && !arg.empty() && arg.front() != '-')
+        {
+            output_path = arg;
+        }
+        else
+        {
+            print_usage();
+            return 1;
+        }
+    }
+
+    if (output_path.empty())
+    {
+        print_usage();
+        return 1;
+    }
+
+    auto pipeline = std::make_unique<rpcore::RenderPipeline>();
+    if (!config_dir.empty())
+        pipeline->get_mount_mgr()->set_config_dir(Filename::from_os_specific(config_dir));
+    if (!pipeline->create())
+    {
+        std::cerr << "Failed to create the pipeline." << std::endl;
+        return 1;
+    }
+
+    if (!pipeline->get_stage_mgr()->write_frame_graph(Filename::from_os_specific(output_path)))
+    {
+        std::cerr << fmt::format("Failed to write '{}'.", output_path) << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
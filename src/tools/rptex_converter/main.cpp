@@ -0,0 +1,108 @@
+/**
+ * Render Pipeline C++
+ *
+ * Copyright (c) 2018 Center of Human-centered Interaction for Coexistence.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+ * and associated documentation files (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial
+ * portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT
+ * LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * Converts an image to raw texture container (.rptex) without window.
+ *
+ * Usage: rptex_converter <input> <output.rptex> [--sliced <tile_size> [<num_tiles>]] [--mipmaps]
+ *
+ * With --sliced, the input image is split into tiles of <tile_size> like color LUTs
+ * and stored as 3D texture.
+ */
+
+#include <iostream>
+#include <string>
+
+#include <texturePool.h>
+
+#include <fmt/format.h>
+
+#include <render_pipeline/rpcore/loader.hpp>
+#include <render_pipeline/rpcore/util/raw_texture_file.hpp>
+
+static void print_usage()
+{
+    std::cerr << "Usage: rptex_converter <input> <output.rptex> [--sliced <tile_size> [<num_tiles>]] [--mipmaps]" << std::endl;
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc < 3)
+    {
+        print_usage();
+        return 1;
+    }
+
+    const Filename input = Filename::from_os_specific(argv[1]);
+    const Filename output = Filename::from_os_specific(argv[2]);
+    int tile_size = 0;
+    int num_tiles = 0;
+    bool generate_mipmaps = false;
+
+    for (int k = 3; k < argc; ++k)
+    {
+        const std::string arg = argv[k];
+        if (arg == "--sliced" && k + 1 < argc)
+        {
+            tile_size = std::stoi(argv[++k]);
+            num_tiles = tile_size;
+            if (k + 1 < argc && argv[k + 1][0] != '-')
+                num_tiles = std::stoi(argv[++k]);
+        }
+        else if (arg == "--mipmaps")
+        {
+            generate_mipmaps = true;
+        }
+        else
+        {
+            print_usage();
+            return 1;
+        }
+    }
+
+    PT(Texture) texture = TexturePool::load_texture(input);
+    if (!texture)
+    {
+        std::cerr << fmt::format("Failed to load '{}'.", input.to_os_specific()) << std::endl;
+        return 1;
+    }
+
+    if (tile_size > 0)
+    {
+        texture = rpcore::RPLoader::create_sliced_3d_texture(texture, tile_size, tile_size, num_tiles);
+        if (!texture)
+            return 1;
+    }
+
+    texture->uncompress_ram_image();
+    if (generate_mipmaps)
+        texture->generate_ram_mipmap_images();
+
+    if (!rpcore::RawTextureFile::write(output, texture))
+        return 1;
+
+    std::cout << fmt::format("Converted '{}' to '{}' ({}x{}x{}, {} mipmap levels).",
+        input.to_os_specific(), output.to_os_specific(),
+        texture->get_x_size(), texture->get_y_size(), texture->get_z_size(),
+        texture->get_num_ram_mipmap_images()) << std::endl;
+
+    return 0;
+}